@@ -0,0 +1,729 @@
+/*
+ * Line based commands received over UART, to configure and query a running receiver
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "uart.h"
+#include "radio.h"
+#include "dec_to_str.h"
+#include "packet_handler.h"
+#include "nmea.h"
+#include "config.h"
+#include "log.h"
+#include "survey.h"
+#include "health.h"
+#include "duty.h"
+#include "command.h"
+
+#define RAW_STREAM_BAUD		38400	// UART baud rate while streaming raw bits, 9600 bps in 7 bit groups need 13714 baud
+#define MEASURE_SENTENCES	32		// number of sentences sent for measurement
+
+struct command_stats_s command_stats;
+
+static uint8_t raw_stream_previous_baud;		// baud rate before raw stream started, in CONFIG_BAUD_UNIT
+static uint8_t log_replay;						// log replay in progress, one record per call of command_poll
+static uint8_t survey_active;					// survey in progress, one frequency per call of command_poll
+static uint8_t measure_active;					// measurement in progress, one baud rate per call of command_poll
+static uint8_t measure_next;					// index of next baud rate to measure
+static uint8_t baud_pending;					// BAUD waits for host to acknowledge this rate in CONFIG_BAUD_UNIT, 0 = not
+static uint16_t late_reset;						// late bits of all radios at last STATS RESET
+static uint8_t (*reply_part)(uint8_t part);		// multi-line reply in progress, one line per call of command_poll
+static uint8_t reply_next;						// next line of reply_part
+
+static uint8_t command_execute(char* line);
+static uint8_t measure_throughput(void);
+static uint8_t replay_record(void);
+static uint8_t survey_report(void);
+static uint8_t baud_acknowledge(void);
+
+// bits of all radios processed after next DATA_CLK edge, counters of packet handler wrap
+static uint16_t late_bits(void)
+{
+	struct ph_activity_s activity;
+	uint16_t late = 0;
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		ph_get_activity(n, &activity);
+		late += activity.late;
+	}
+	return late;
+}
+
+static void stats_reset(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < PH_CHANNELS; i++)
+		command_stats.packets[i] = 0;
+	command_stats.filtered = 0;
+	for (i = 0; i < PH_ERRORS; i++)
+		command_stats.errors[i] = 0;
+	late_reset = late_bits();
+}
+
+// apply configuration to packet handler, raw stream is not started
+static void command_apply(void)
+{
+	ph_set_channels(config.channel);
+	ph_set_hop(config.hop);
+	ph_set_tuning(config.preamble_length, config.sync_timeout, config.rssi_threshold, config.rssi_margin);
+	ph_set_xo_tune(config.xo_tune ? config.xo_tune : RADIO_XO_TUNE_DEFAULT, !config.xo_fixed);
+	if (config.output == COMMAND_OUTPUT_RAW)
+		config.output = COMMAND_OUTPUT_NMEA;
+}
+
+void command_init(void)
+{
+	command_apply();
+	uart_set_baud(config.baud * (uint32_t) CONFIG_BAUD_UNIT);	// stays at start rate if not supported
+	stats_reset();
+
+	log_replay = 0;
+	survey_active = 0;
+	measure_active = 0;
+	baud_pending = 0;
+	reply_part = 0;
+}
+
+uint8_t command_poll(void)
+{
+	uint8_t result;
+	char* line;
+	char* c;
+
+	if (reply_part) {
+		if (!reply_part(reply_next++)) {			// last line sent
+			reply_part = 0;
+			uart_send_string("ok\r\n");
+		}
+		return 1;
+	}
+	if (log_replay)
+		return replay_record();
+	if (survey_active)
+		return survey_report();
+	if (measure_active)
+		return measure_throughput();
+	if (baud_pending)
+		return baud_acknowledge();
+
+	line = uart_get_line();
+	if (!line)
+		return 0;									// all input processed
+
+	for (c = line; *c; c++)
+		if (*c >= 'a' && *c <= 'z')
+			*c -= 'a' - 'A';						// ignore case
+	result = line[0] && command_execute(line);		// empty if line was too long
+	uart_release_line();
+	if (reply_part)									// "ok" follows last line of reply
+		reply_next = 0;
+	else if (baud_pending)							// "ok" or "error" follows acknowledge
+		;
+	else if (!ph_get_raw_stream())					// no replies inside raw bit stream
+		uart_send_string(result ? "ok\r\n" : "error\r\n");
+	return 1;										// one command per call, RX interrupt posts next line
+}
+
+uint8_t command_filter(uint8_t channel, uint8_t type)
+{
+	if (!(config.channels & (1 << (channel & (PH_CHANNELS - 1)))))
+		return 0;
+	if (type > 31)
+		return 0;
+	return (config.types >> type) & 1;
+}
+
+// returns next word and advances line past it, empty string at end of line
+static char* command_word(char** line)
+{
+	char* word;
+
+	while (**line == ' ')
+		(*line)++;
+	word = *line;
+	while (**line && **line != ' ')
+		(*line)++;
+	if (**line)
+		*(*line)++ = 0;
+	return word;
+}
+
+static uint8_t command_equal(const char* a, const char* b)
+{
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+// parse decimal number up to separator (0, ',' or '-'), returns pointer to separator or 0 if not a number
+static const char* command_number(const char* text, uint32_t* value)
+{
+	const char* start = text;
+
+	*value = 0;
+	while (*text >= '0' && *text <= '9' && text - start < 9)
+		*value = *value * 10 + (*text++ - '0');
+	if (text == start || (*text && *text != ',' && *text != '-'))
+		return 0;
+	return text;
+}
+
+// channel letters like AB, A or ACD into channel bits, 0 if invalid
+static uint8_t command_channels(const char* word)
+{
+	uint8_t channels = 0;
+
+	while (*word) {
+		if (*word < 'A' || *word >= 'A' + PH_CHANNELS)
+			return 0;
+		channels |= 1 << (*word++ - 'A');
+	}
+	return channels;
+}
+
+// send unsigned number without leading zeros
+static void send_number(uint32_t value)
+{
+	char buffer[11];
+	uint8_t i = 0;
+
+	udec_to_str(buffer, 10, value);
+	buffer[10] = 0;
+	while (i < 9 && buffer[i] == '0')
+		i++;
+	uart_send_string(buffer + i);
+}
+
+static void send_counter(const char* name, uint32_t value)
+{
+	uart_send_string(name);
+	send_number(value);
+}
+
+#if DUTY_CYCLE
+// per mille as percent with one decimal, e.g. " ph=2.5%"
+static void send_permille(const char* name, uint16_t value)
+{
+	send_counter(name, value / 10);
+	uart_send_byte('.');
+	uart_send_byte('0' + value % 10);
+	uart_send_byte('%');
+}
+
+void command_send_duty(void)
+{
+	uart_send_string("duty");
+	send_permille(" ph=", duty_permille(DUTY_PH));
+	send_permille(" nmea=", duty_permille(DUTY_NMEA));
+	send_permille(" uart=", duty_permille(DUTY_UART));
+	send_permille(" main=", duty_permille(DUTY_MAIN));
+	send_permille(" sleep=", duty_permille(DUTY_SLEEP));
+	uart_send_string("\r\n");
+}
+#endif
+
+static void send_signed(const char* name, int16_t value)
+{
+	uart_send_string(name);
+	if (value < 0)
+		uart_send_byte('-');
+	send_number(value < 0 ? -value : value);
+}
+
+static void send_channels(const char* name, uint8_t channels)
+{
+	uint8_t i;
+
+	uart_send_string(name);
+	for (i = 0; i < PH_CHANNELS; i++) {
+		if (channels & (1 << i))
+			uart_send_byte('A' + i);
+	}
+}
+
+// channel table as A=<kHz>kHz/<dwell> ..
+static void send_channel_table(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < PH_CHANNELS; i++) {
+		if (i)
+			uart_send_byte(' ');
+		uart_send_byte('A' + i);
+		send_counter("=", ph_channel_khz(&config.channel[i]));
+		send_counter("kHz/", config.channel[i].dwell);
+	}
+	uart_send_string("\r\n");
+}
+
+// configuration, one line per call, returns 1 if more lines follow
+static uint8_t config_line(uint8_t line)
+{
+	static const char* const outputs[] = { "NMEA", "DEBUG", "RAW" };
+	uint8_t type;
+	char separator = '=';
+
+	switch (line) {
+	case 0:
+		send_counter("preamble=", config.preamble_length);
+		send_counter(" timeout=", config.sync_timeout);
+		send_signed(" rssi=", config.rssi_threshold);
+		send_counter(" margin=", config.rssi_margin);
+		send_counter(" xo=", ph_get_xo_tune());
+		uart_send_string(config.xo_fixed ? " xocal=OFF\r\n" : " xocal=ON\r\n");
+		return 1;
+	case 1:
+		send_counter("baud=", config.baud * (uint32_t) CONFIG_BAUD_UNIT);
+		send_channels(" hop=", config.hop);
+		uart_send_string(" output=");
+		uart_send_string(outputs[config.output]);
+		send_channels(" channels=", config.channels);
+		uart_send_string(config.log ? " log=ON\r\n" : " log=OFF\r\n");
+		return 1;
+	}
+	uart_send_string("types");
+	if (config.types == 0xffffffff)
+		uart_send_string("=ALL");
+	else {
+		for (type = 1; type <= 27; type++) {
+			if (config.types & (1UL << type)) {
+				uart_send_byte(separator);
+				send_number(type);
+				separator = ',';
+			}
+		}
+	}
+	send_counter(" saves=", config.sequence);
+	uart_send_string("\r\n");
+	return 0;
+}
+
+// statistics, one line per call, returns 1 if more lines follow
+static uint8_t stats_line(uint8_t line)
+{
+	uint8_t i;
+
+	switch (line) {
+	case 0:
+		uart_send_string("packets");
+		for (i = 0; i < PH_CHANNELS; i++) {
+			uart_send_byte(' ');
+			uart_send_byte('A' + i);
+			send_counter("=", command_stats.packets[i]);
+		}
+		send_counter(" filtered=", command_stats.filtered);
+		uart_send_string("\r\n");
+		return 1;
+	case 1:
+		send_counter("errors stuffbit=", command_stats.errors[PH_ERROR_STUFFBIT]);
+		send_counter(" noend=", command_stats.errors[PH_ERROR_NOEND]);
+		send_counter(" crc=", command_stats.errors[PH_ERROR_CRC]);
+		send_counter(" rssi=", command_stats.errors[PH_ERROR_RSSI_DROP]);
+		uart_send_string("\r\n");
+		return 1;
+	case 2:
+		uart_send_string("noise");
+		for (i = 0; i < PH_CHANNELS; i++) {
+			uart_send_byte(' ');
+			uart_send_byte('A' + i);
+			send_signed("=", ph_get_noise_floor(i));
+		}
+		uart_send_string("\r\n");
+		return 1;
+	}
+	send_counter("startup=", command_stats.startup_ms);
+	send_counter("ms radio=", command_stats.radio_ms);
+	send_counter("ms warm=", command_stats.warm_radios);
+	send_counter(" restarts=", health_stats.restarts);
+	send_counter(" configures=", health_stats.configures);
+	send_counter(" resets=", health_stats.resets);
+	send_counter(" late=", (uint16_t) (late_bits() - late_reset));
+	uart_send_string("\r\n");
+	return 0;
+}
+
+static void set_output(uint8_t output)
+{
+	if (output == COMMAND_OUTPUT_RAW && !ph_get_raw_stream()) {
+		uart_send_string("ok\r\n");					// last text before raw bits
+		raw_stream_previous_baud = uart_get_baud() / CONFIG_BAUD_UNIT;	// configured rates are multiples
+		if (uart_get_baud() < RAW_STREAM_BAUD) {
+			uart_flush();
+			uart_set_baud(RAW_STREAM_BAUD);
+		}
+		ph_set_raw_stream(1);
+	} else if (output != COMMAND_OUTPUT_RAW && ph_get_raw_stream()) {
+		ph_set_raw_stream(0);
+		uart_flush();
+		uart_set_baud(raw_stream_previous_baud * (uint32_t) CONFIG_BAUD_UNIT);
+	}
+	config.output = output;
+}
+
+// returns 1 if command was successful
+static uint8_t command_execute(char* line)
+{
+	char* command = command_word(&line);
+	char* argument = command_word(&line);
+	uint8_t value;
+
+	if (command_equal(command, "OUTPUT")) {
+		if (command_equal(argument, "NMEA"))
+			set_output(COMMAND_OUTPUT_NMEA);
+		else if (command_equal(argument, "DEBUG"))
+			set_output(COMMAND_OUTPUT_DEBUG);
+		else if (command_equal(argument, "RAW"))
+			set_output(COMMAND_OUTPUT_RAW);
+		else
+			return 0;
+		return 1;
+	}
+
+	if (ph_get_raw_stream())						// nothing else while streaming
+		return 0;
+
+	if (command_equal(command, "HOP")) {
+		value = command_channels(argument);
+		if (!value)
+			return 0;
+		ph_stop();									// channels are dealt to radios on start
+		config.hop = value;
+		command_apply();
+		ph_start();
+		return 1;
+	}
+
+	if (command_equal(command, "CHANNEL")) {
+		struct ph_channel_s channel;
+		const char* text = command_word(&line);
+		uint32_t number;
+		const char* end = command_number(text, &number);
+		if (!*argument) {
+			send_channel_table();
+			return 1;
+		}
+		value = argument[0] - 'A';					// index into channel table
+		if (argument[1] || value >= PH_CHANNELS || !end || *end || !ph_channel_pll(&channel, number))
+			return 0;
+		channel.dwell = config.channel[value].dwell;
+		text = command_word(&line);
+		if (*text) {
+			end = command_number(text, &number);
+			if (!end || *end || number < 1 || number > 255)
+				return 0;
+			channel.dwell = number;
+		}
+		ph_stop();									// ISR reads channel table
+		config.channel[value] = channel;
+		command_apply();
+		ph_start();
+		return 1;
+	}
+
+	if (command_equal(command, "FILTER")) {
+		char* list = command_word(&line);
+		if (command_equal(argument, "CHANNEL")) {
+			value = command_channels(list);
+			if (!value)
+				return 0;
+			config.channels = value;
+			return 1;
+		}
+		if (command_equal(argument, "TYPE")) {
+			const char* next = list;
+			uint32_t types = 0;
+			uint32_t type;
+			if (command_equal(list, "ALL")) {
+				config.types = 0xffffffff;
+				return 1;
+			}
+			do {
+				uint32_t last;
+				next = command_number(next, &type);
+				if (!next || type < 1 || type > 27)	// AIS message types 1 to 27
+					return 0;
+				last = type;
+				if (*next == '-') {					// range, e.g. 1-3
+					next = command_number(next + 1, &last);
+					if (!next || *next == '-' || last < type || last > 27)
+						return 0;
+				}
+				while (type <= last)
+					types |= 1UL << type++;
+			} while (*next++);
+			config.types = types;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (command_equal(command, "STATS")) {
+		if (command_equal(argument, "RESET")) {
+			stats_reset();
+			return 1;
+		}
+		if (*argument)
+			return 0;
+		reply_part = stats_line;					// lines follow with next calls of command_poll
+		return 1;
+	}
+
+	if (command_equal(command, "BAUD")) {
+		uint32_t baud;
+		const char* end = command_number(argument, &baud);
+		if (!end || *end)
+			return 0;
+		if (!uart_switch_baud(baud))				// host has to send a byte at new rate
+			return 0;
+		baud_pending = baud / CONFIG_BAUD_UNIT;		// all supported rates are multiples
+		return 1;
+	}
+
+	if (command_equal(command, "MEASURE")) {
+		ph_stop();									// nothing else may use FIFO or UART until "measure end"
+		measure_next = 0;
+		measure_active = 1;							// baud rates follow with next calls of command_poll
+		return 1;
+	}
+
+#if DUTY_CYCLE
+	if (command_equal(command, "DUTY")) {
+		command_send_duty();
+		return 1;
+	}
+#endif
+
+	if (command_equal(command, "TUNE")) {
+		const char* text = command_word(&line);
+		uint8_t negative = (*text == '-');
+		uint32_t number;
+		const char* end = command_number(text + negative, &number);
+		if (command_equal(argument, "XO") && command_equal(text, "AUTO")) {
+			config.xo_tune = ph_get_xo_tune();		// calibration continues from current value
+			config.xo_fixed = 0;
+		} else if (!end || *end)
+			return 0;
+		else if (command_equal(argument, "PREAMBLE") && !negative && number >= 2 && number <= 64)
+			config.preamble_length = number;
+		else if (command_equal(argument, "TIMEOUT") && !negative && number >= 1 && number <= 255)
+			config.sync_timeout = number;
+		else if (command_equal(argument, "RSSI") && ((negative && number >= 20 && number <= 127) || number == 0))
+			config.rssi_threshold = -(int8_t) number;
+		else if (command_equal(argument, "MARGIN") && !negative && number <= 40)
+			config.rssi_margin = number;
+		else if (command_equal(argument, "XO") && !negative && number >= 1 && number <= RADIO_XO_TUNE_MAX) {
+			config.xo_tune = number;
+			config.xo_fixed = 1;
+		} else
+			return 0;
+		ph_stop();									// radio is configured with RSSI threshold and XO_TUNE on start
+		command_apply();
+		ph_start();
+		return 1;
+	}
+
+	if (command_equal(command, "CONFIG")) {
+		reply_part = config_line;					// lines follow with next calls of command_poll
+		return 1;
+	}
+
+	if (command_equal(command, "SAVE"))
+		return config_save();
+
+	if (command_equal(command, "LOG")) {
+		if (command_equal(argument, "ON") || command_equal(argument, "OFF")) {
+			config.log = (argument[1] == 'N');
+			return 1;
+		}
+		if (command_equal(argument, "CLEAR")) {
+			log_clear();
+			return 1;
+		}
+		if (command_equal(argument, "REPLAY")) {
+			const char* text = command_word(&line);
+			uint32_t now = log_time(ph_get_seconds());
+			uint32_t age = now;						// all records by default
+			if (*text) {
+				const char* end = command_number(text, &age);
+				if (!end || *end)
+					return 0;
+			}
+			log_replay_start(age < now ? now - age : 0);
+			log_replay = 1;							// records follow with next calls of command_poll
+			return 1;
+		}
+		if (*argument)
+			return 0;
+		uart_send_string(config.log ? "log on" : "log off");
+		send_counter(" records=", log_records());
+		send_counter(" dropped=", log_dropped);
+		uart_send_string("\r\n");
+		return 1;
+	}
+
+	if (command_equal(command, "SURVEY")) {
+		uint32_t band[3] = { SURVEY_START_KHZ, SURVEY_END_KHZ, SURVEY_STEP_KHZ };
+		int8_t busy = config.rssi_threshold ? config.rssi_threshold : SURVEY_BUSY_DBM;
+		const char* text = argument;
+		uint8_t i;
+		for (i = 0; i < 3 && *text; i++) {
+			const char* end = command_number(text, &band[i]);
+			if (!end || *end)
+				return 0;
+			text = command_word(&line);
+		}
+		if (i == 1 || *text || band[2] > 0xffff)	// start needs end
+			return 0;
+		ph_stop();									// radio is used by survey until end of sweep
+		if (!survey_start(band[0], band[1], band[2], busy)) {
+			ph_start();
+			return 0;
+		}
+		send_counter("survey ", band[0]);
+		send_counter("-", band[1]);
+		send_counter("kHz step=", band[2]);
+		send_counter(" samples=", SURVEY_SAMPLES);
+		send_signed(" busy>=", busy);
+		send_signed("dBm hist=", SURVEY_BIN_DBM);
+		send_counter("+", SURVEY_BIN_DB);
+		uart_send_string("dB\r\n");
+		survey_active = 1;							// frequencies follow with next calls of command_poll
+		return 1;
+	}
+
+	if (command_equal(command, "DEFAULTS")) {
+		uint8_t baud = config.baud;
+		config_default();
+		config.baud = baud;							// BAUD changes rate, only with host acknowledge
+		ph_stop();
+		command_apply();
+		ph_start();
+		return 1;
+	}
+
+	return 0;
+}
+
+// send next record of log replay as debug line and NMEA sentence, returns 0 when replay is done
+static uint8_t replay_record(void)
+{
+	const struct log_record_s* record = log_replay_next();
+	uint32_t now;
+
+	if (!record) {
+		log_replay = 0;
+		uart_send_string("log end\r\n");
+		return 0;
+	}
+
+	now = log_time(ph_get_seconds());
+	send_counter("log ", now > record->time ? now - record->time : 0);
+	send_signed("s RSSI=", record->rssi);
+	uart_send_string("dBm\r\n");
+	nmea_send_packet(record->channel, record->payload, record->size);
+	return 1;
+}
+
+// measure and send next frequency of survey as "<kHz> <min> <mean> <max> <busy%> <histogram>", returns 0 when done
+// histogram has a digit per bin, the share of samples in tenths rounded up so any sample shows
+static uint8_t survey_report(void)
+{
+	struct survey_step_s step;
+	uint8_t i;
+
+	if (!survey_next(&step)) {
+		survey_active = 0;
+		uart_send_string("survey end\r\n");
+		ph_start();
+		return 0;
+	}
+
+	send_number(step.khz);
+	send_signed(" ", step.min);
+	send_signed(" ", step.mean);
+	send_signed(" ", step.max);
+	send_counter(" ", step.busy);
+	uart_send_byte(' ');
+	for (i = 0; i < SURVEY_BINS; i++)
+		uart_send_byte('0' + (step.hist[i] * 10 + SURVEY_SAMPLES - 1) / SURVEY_SAMPLES - (step.hist[i] == SURVEY_SAMPLES));
+	uart_send_string("\r\n");
+	return 1;
+}
+
+// measure how many NMEA sentences per second the UART sustains at next baud rate and send
+// "<baud> baud: <n> sentences/s error=<ppm>ppm", returns 0 when done
+// a typical position report (21 bytes, 50 characters) is encoded from FIFO and sent MEASURE_SENTENCES times,
+// rates other than the current one are timed with the TX pin muted so the host doesn't receive garbage
+// one check for the host's acknowledge of the new baud rate per call, packets are handled in between
+static uint8_t baud_acknowledge(void)
+{
+	uint8_t result = uart_switch_poll();
+
+	if (result == UART_SWITCH_WAIT)
+		return 1;
+	if (result == UART_SWITCH_KEPT)
+		config.baud = baud_pending;
+	baud_pending = 0;
+	uart_send_string(result == UART_SWITCH_KEPT ? "ok\r\n" : "error\r\n");	// at the rate in use now
+	return 1;										// lines may have arrived after the acknowledge
+}
+
+static uint8_t measure_throughput(void)
+{
+	static const uint8_t packet[] = { 0, 0x04, 0x3e, 0x7b, 0x6d, 0xe1, 0x3e, 0x08, 0xb0, 0x0d, 0x28, 0xb5, 0x43,
+									  0x81, 0xff, 0x65, 0xd8, 0x51, 0x50, 0x49, 0x53, 0xaa, 0x00, 0x00 };
+	uint32_t baud = uart_get_baud();
+	uint32_t rate = uart_get_baud_option(measure_next);
+	uint32_t ticks;
+	int16_t error;
+	uint8_t i;
+
+	if (!rate) {
+		measure_active = 0;
+		uart_send_string("measure end\r\n");
+		ph_start();
+		return 0;
+	}
+	measure_next++;
+
+	fifo_reset();
+	fifo_new_packet();
+	for (i = 0; i < sizeof(packet); i++)
+		fifo_write_byte(packet[i]);
+	fifo_commit_packet();
+
+	uart_flush();									// previous line must leave at host rate
+	if (rate != baud) {
+		uart_mute(1);
+		uart_set_baud(rate);
+	}
+	ticks = duty_now();								// SMCLK cycles, CPU doesn't sleep while measuring
+	for (i = 0; i < MEASURE_SENTENCES; i++)
+		nmea_process_packet();						// reads same packet again, it is not removed
+	uart_flush();
+	ticks = duty_now() - ticks;
+	error = uart_get_baud_error();
+	if (rate != baud) {
+		uart_set_baud(baud);
+		uart_mute(0);
+	}
+
+	fifo_reset();
+	send_number(rate);
+	uart_send_string(" baud: ");
+	send_number(MEASURE_SENTENCES * 16000000UL / ticks);
+	send_signed(" sentences/s error=", error);
+	uart_send_string("ppm\r\n");
+	return 1;
+}
@@ -0,0 +1,71 @@
+/*
+ * Line based commands received over UART, to configure and query a running receiver
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Commands are words separated by spaces, terminated by CR or LF, case is ignored, at most 27 characters.
+ * Bytes received while a line waits to be executed are dropped:
+ *   HOP AB|A|B|ABCD..			channels to hop between, a single channel stays on it
+ *   CHANNEL [A..D kHz [n]]		show channel table or set frequency and dwell of n reset periods of a channel
+ *   OUTPUT NMEA|DEBUG|RAW		NMEA only, NMEA with sync and error messages, raw bit stream
+ *   FILTER CHANNEL AB|A|B|..	send packets of listed channels only
+ *   FILTER TYPE ALL|n[-m][,..]	send all AIS message types or only the listed ones, e.g. 1-3,5,18,19,24
+ *   STATS [RESET]				packet and error counters since start or reset, startup time, radios warm started, recoveries, late bits
+ *   BAUD n						switch to 9600..115200 baud, host must send a byte at new rate within 2s, "ok" follows at new rate
+ *   MEASURE					max NMEA sentences per second and rate error of each baud rate
+ *   DUTY						share of time in packet handler ISR, NMEA encoding, waiting for UART, main loop and sleep,
+ *   							only built with DUTY_CYCLE 1, see duty.h
+ *   TUNE PREAMBLE|TIMEOUT n	minimum preamble length and sync timeout in bits
+ *   TUNE RSSI n				RSSI threshold in dBm, 0 ignores signal strength
+ *   TUNE MARGIN n				RSSI threshold n dB above noise floor of each channel, 0 = fixed threshold only
+ *   TUNE XO n|AUTO				fix crystal load capacitance XO_TUNE at 1..127 or calibrate it from received packets,
+ *   							AUTO needs a radio_config.h generated with AFC enabled
+ *   CONFIG						show configuration
+ *   SAVE						store configuration in flash, it is loaded at start
+ *   DEFAULTS					restore default configuration, SAVE to keep it
+ *   LOG [ON|OFF]				show log status, store received packets in flash log or stop storing
+ *   LOG REPLAY [n]				send logged packets received in the last n seconds or all, oldest first
+ *   LOG CLEAR					remove all logged packets, flash is erased in the background
+ *   SURVEY [start end [step]]	RSSI statistics of each frequency of a band in kHz, default 156000 163000 25
+ * Replies are "ok" or "error", queries reply with their result. Settings are kept in config. STATS and CONFIG
+ * reply with several lines, one per call of command_poll so NMEA sentences go out in between, then "ok".
+ * A replay sends "log <age>s RSSI=<n>dBm" and the NMEA sentences of each record, one record per call of
+ * command_poll so received packets still go out in between, and ends with "log end". A survey stops the
+ * packet handler, sends a header and "<kHz> <min> <mean> <max> <busy%> <histogram>" for one frequency per
+ * call of command_poll, ends with "survey end" and restarts the packet handler. MEASURE works the same way, one
+ * "<baud> baud: <n> sentences/s error=<ppm>ppm" per call and "measure end". DUTY reports the last window
+ * of duty.c as "duty ph=<n>% nmea=<n>% uart=<n>% main=<n>% sleep=<n>%", sent by main after each window in
+ * debug output.
+ * Include packet_handler.h before this file.
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+// output formats
+enum COMMAND_OUTPUT {
+	COMMAND_OUTPUT_NMEA = 0,			// NMEA sentences only
+	COMMAND_OUTPUT_DEBUG,				// NMEA sentences, sync and error messages
+	COMMAND_OUTPUT_RAW					// raw bit stream, see ph_set_raw_stream
+};
+
+// counters maintained by main loop, reported by STATS
+struct command_stats_s {
+	uint16_t packets[PH_CHANNELS];		// valid packets per channel of table, counters wrap at 65535
+	uint16_t filtered;					// valid packets not sent due to filter
+	uint16_t errors[PH_ERRORS];			// PH_ERROR_x, errors[PH_ERROR_NONE] is unused
+	uint16_t startup_ms;				// ms from reset to first RX, not cleared by STATS RESET
+	uint16_t radio_ms;					// part of startup_ms spent resetting and configuring radios
+	uint8_t warm_radios;				// radios that kept their configuration through the reset
+};
+
+extern struct command_stats_s command_stats;
+
+void command_init(void);				// apply configuration, reset statistics
+uint8_t command_poll(void);				// execute received line or continue a reply, returns 1 if there might be more to do
+uint8_t command_filter(uint8_t channel, uint8_t type);	// returns 1 if packet passes filters
+void command_send_duty(void);			// send duty cycle of last window, only built with DUTY_CYCLE 1
+
+#endif /* COMMAND_H_ */
@@ -0,0 +1,195 @@
+/*
+ * Persistent configuration, stored in information flash
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "flash.h"
+#include "packet_handler.h"
+#include "command.h"
+#include "config.h"
+
+// defaults if no configuration is stored
+#define CONFIG_BAUD		9600					// use 9600 for MSP430G2 LaunchPad
+#define CONFIG_OUTPUT	COMMAND_OUTPUT_DEBUG	// NMEA sentences with sync and error messages
+
+#define CONFIG_SIZE		sizeof(struct config_s)
+#define CONFIG_SLOTS	(FLASH_INFO_SEGMENT_SIZE / CONFIG_SIZE)	// records per segment
+
+struct config_s config;
+
+static uint8_t* const config_segments[2] = { FLASH_INFO_B, FLASH_INFO_C };
+static uint8_t config_segment;					// segment of current record
+static uint8_t config_slot = CONFIG_SLOTS;		// slot of current record, CONFIG_SLOTS if there is none
+
+static const struct config_s* config_record(uint8_t segment, uint8_t slot)
+{
+	return (const struct config_s*) (config_segments[segment] + slot * CONFIG_SIZE);
+}
+
+// CCITT CRC, same as AIS
+static uint16_t config_crc_byte(uint16_t crc, uint8_t data)
+{
+	uint8_t bit;
+
+	crc ^= data;
+	for (bit = 0; bit < 8; bit++) {
+		if (crc & 0x0001)
+			crc = (crc >> 1) ^ 0x8408;
+		else
+			crc >>= 1;
+	}
+	return crc;
+}
+
+// CRC seeded with version, records of other layouts don't validate
+static uint16_t config_crc(const struct config_s* record)
+{
+	const uint8_t* data = (const uint8_t*) record;
+	uint16_t size = CONFIG_SIZE - sizeof(record->crc);
+	uint16_t crc = 0xffff ^ CONFIG_VERSION;
+
+	while (size--)
+		crc = config_crc_byte(crc, *data++);
+	return crc;
+}
+
+static uint8_t config_valid(const struct config_s* record)
+{
+	return record->crc == config_crc(record);
+}
+
+static uint8_t config_blank(uint8_t segment, uint8_t slot)
+{
+	const uint8_t* data = (const uint8_t*) config_record(segment, slot);
+	uint8_t i;
+
+	for (i = 0; i < CONFIG_SIZE; i++) {
+		if (data[i] != 0xff)
+			return 0;
+	}
+	return 1;
+}
+
+void config_default(void)
+{
+	uint8_t i;
+
+	config.baud = CONFIG_BAUD / CONFIG_BAUD_UNIT;	// sequence continues, a saved default configuration becomes current
+	config.types = 0xffffffff;
+	config.preamble_length = PH_PREAMBLE_LENGTH;
+	config.sync_timeout = PH_SYNC_TIMEOUT;
+	config.rssi_threshold = PH_RSSI_THRESHOLD;
+	config.rssi_margin = PH_RSSI_MARGIN;
+	config.output = CONFIG_OUTPUT;
+	config.hop = PH_HOP_AB;
+	config.channels = 0x0f;						// all channels of table, hop policy selects received ones
+	config.log = 0;
+	config.xo_tune = 0;
+	config.xo_fixed = 1;							// radio_config.h leaves AFC off, the offset reads 0
+	for (i = 0; i < PH_CHANNELS; i++)
+		config.channel[i] = ph_default_channels[i];
+}
+
+uint8_t config_load(void)
+{
+	uint8_t segment, slot;
+
+	config_slot = CONFIG_SLOTS;
+	for (segment = 0; segment < 2; segment++) {
+		for (slot = 0; slot < CONFIG_SLOTS; slot++) {
+			const struct config_s* record = config_record(segment, slot);
+			if (!config_valid(record))
+				continue;
+			if (config_slot == CONFIG_SLOTS || (int16_t) (record->sequence - config.sequence) > 0) {
+				config = *record;					// newest so far, sequence may wrap
+				config_segment = segment;
+				config_slot = slot;
+			}
+		}
+	}
+
+	if (config_slot == CONFIG_SLOTS) {
+		config_default();
+		return 0;
+	}
+	return 1;
+}
+
+// blank slot for next record after current one, erases the other segment if current segment is full
+static void config_next(uint8_t* segment, uint8_t* slot)
+{
+	*segment = config_segment;
+	*slot = config_slot;
+
+	// a failed save may have left a broken record
+	if (*slot < CONFIG_SLOTS)
+		(*slot)++;
+	while (*slot < CONFIG_SLOTS && !config_blank(*segment, *slot))
+		(*slot)++;
+	if (*slot == CONFIG_SLOTS) {					// segment full or no record yet, continue in other segment
+		if (config_slot < CONFIG_SLOTS)
+			*segment ^= 1;
+		*slot = 0;
+		flash_erase(config_segments[*segment]);		// only holds records older than the current one
+	}
+}
+
+// make written record current if it is valid and has the sequence of active configuration
+static uint8_t config_verify(uint8_t segment, uint8_t slot)
+{
+	const struct config_s* record = config_record(segment, slot);
+
+	if (!config_valid(record) || record->sequence != config.sequence)
+		return 0;
+	config_segment = segment;
+	config_slot = slot;
+	return 1;
+}
+
+uint8_t config_save(void)
+{
+	uint8_t segment, slot;
+
+	config_next(&segment, &slot);
+	config.sequence++;
+	config.crc = config_crc(&config);
+	flash_write((uint8_t*) config_record(segment, slot), &config, CONFIG_SIZE);
+	return config_verify(segment, slot);
+}
+
+// copies current record byte by byte from flash, replacing sequence and xo_tune, so no second
+// configuration has to fit into RAM
+uint8_t config_save_xo_tune(void)
+{
+	const uint8_t* current;
+	uint8_t* record;
+	uint8_t segment, slot;
+	uint16_t crc = 0xffff ^ CONFIG_VERSION;
+	uint8_t i, data;
+
+	if (config_slot == CONFIG_SLOTS)
+		return 0;									// nothing stored yet, SAVE stores all settings
+	current = (const uint8_t*) config_record(config_segment, config_slot);
+	config_next(&segment, &slot);					// erases the other segment only, current record stays
+	record = (uint8_t*) config_record(segment, slot);
+
+	config.sequence = ((const struct config_s*) current)->sequence + 1;
+	for (i = 0; i < offsetof(struct config_s, crc); i++) {
+		data = current[i];
+		if (i == offsetof(struct config_s, xo_tune))
+			data = config.xo_tune;
+		else if (i >= offsetof(struct config_s, sequence) && i < offsetof(struct config_s, sequence) + sizeof(config.sequence))
+			data = ((const uint8_t*) &config.sequence)[i - offsetof(struct config_s, sequence)];
+		flash_write(record + i, &data, 1);
+		crc = config_crc_byte(crc, data);
+	}
+	flash_write(record + i, &crc, sizeof(crc));
+	return config_verify(segment, slot);
+}
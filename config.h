@@ -0,0 +1,47 @@
+/*
+ * Persistent configuration, stored in information flash
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Records are appended to information segments B and C, CONFIG_SLOTS per segment. The valid record
+ * with the highest sequence number is current. A new record goes into the next blank slot; only when
+ * a segment is full the other one is erased and written. The previous record stays intact until the
+ * new one is complete, so losing power during a save keeps the old configuration. Records are 32 bytes so
+ * each segment holds two: the version seeds the CRC instead of taking a field, settings are packed.
+ * Include packet_handler.h before this file.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#define CONFIG_VERSION	4				// change whenever struct config_s changes, seeds CRC
+#define CONFIG_BAUD_UNIT	2400		// unit of baud, all rates of uart.c are multiples
+
+struct config_s {
+	uint32_t types;						// AIS message types sent, bit n for type n
+	uint16_t sequence;					// incremented with every save, highest valid record is current
+	uint8_t baud;						// UART baud rate in CONFIG_BAUD_UNIT
+	uint8_t preamble_length;			// packet handler tuning, see ph_set_tuning
+	uint8_t sync_timeout;
+	int8_t rssi_threshold;
+	uint8_t rssi_margin;				// adaptive RSSI threshold above noise floor, 0 = off
+	uint8_t xo_tune;					// crystal load capacitance GLOBAL_XO_TUNE, 0 = RADIO_XO_TUNE_DEFAULT
+	uint8_t output : 2;					// COMMAND_OUTPUT_x
+	uint8_t log : 1;					// 1 to store received packets in flash log
+	uint8_t xo_fixed : 1;				// 1 to keep xo_tune, 0 to calibrate from AFC offset of received packets
+	uint8_t hop : PH_CHANNELS;			// channels to hop between, bit n for channel 'A' + n, see ph_set_hop
+	uint8_t channels : PH_CHANNELS;		// channels sent, bit n for channel 'A' + n
+	struct ph_channel_s channel[PH_CHANNELS];	// channel table, frequency as packed PLL words and dwell
+	uint16_t crc;						// CRC-16 of all preceding bytes
+};
+
+extern struct config_s config;			// active configuration, commands change it, config_save stores it
+
+void config_default(void);				// set active configuration to defaults
+uint8_t config_load(void);				// load current record, defaults if there is none, returns 1 if a record was found
+uint8_t config_save(void);				// store active configuration as new record, returns 1 if verified
+uint8_t config_save_xo_tune(void);		// store xo_tune of active configuration in a copy of the current record, 0 if there is none
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,121 @@
+/*
+ * Duty cycle instrumentation, share of time the MCU spends per activity
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "packet_handler.h"
+#include "duty.h"
+
+static volatile uint16_t duty_overflows;		// TA0 overflows, upper word of duty_now
+
+#if DUTY_CYCLE
+uint32_t duty_cycles[DUTY_SLEEP];
+
+static uint32_t duty_last;						// duty_now at last switch
+static uint32_t duty_ph_last;					// ISR cycles at last switch
+static uint8_t duty_activity = DUTY_MAIN;		// current activity of main loop
+static uint32_t duty_bits;						// bits received at start of window
+static uint16_t duty_report[DUTY_ACTIVITIES];	// last window, in 1/1000
+#endif
+
+void duty_init(void)
+{
+	duty_overflows = 0;
+	TA0CTL = TASSEL_2 | MC_2 | TACLR | TAIE;	// SMCLK, continuous mode, interrupt on overflow
+#if DUTY_CYCLE
+	duty_last = 0;
+	duty_bits = ph_get_bits();
+#endif
+}
+
+uint32_t duty_now(void)
+{
+	uint16_t gie = __get_SR_register() & GIE;
+	uint16_t overflows;
+	uint16_t ticks;
+
+	_BIC_SR(GIE);
+	ticks = TA0R;
+	overflows = duty_overflows;
+	if (TA0CTL & TAIFG) {						// overflow before or after reading, not counted yet
+		ticks = TA0R;
+		overflows++;
+	}
+	_BIS_SR(gie);
+	return ((uint32_t) overflows << 16) | ticks;
+}
+
+#if DUTY_CYCLE
+uint8_t duty_switch(uint8_t activity)
+{
+	uint16_t gie = __get_SR_register() & GIE;
+	uint8_t previous = duty_activity;
+	uint32_t now;
+	uint32_t ph;
+
+	_BIC_SR(GIE);								// ISR adds to its cycles
+	now = duty_now();
+	ph = duty_cycles[DUTY_PH];
+	if (previous != DUTY_SLEEP)					// LPM0 or other interrupts while sleeping
+		duty_cycles[previous] += (now - duty_last) - (ph - duty_ph_last);
+	duty_last = now;
+	duty_ph_last = ph;
+	duty_activity = activity;
+	_BIS_SR(gie);
+	return previous;
+}
+
+uint8_t duty_poll(void)
+{
+	uint32_t bits = ph_get_bits() - duty_bits;
+	uint32_t wall;
+	uint16_t awake = 0;
+	uint8_t i;
+
+	if (bits < DUTY_WINDOW_SECONDS * (uint32_t) DUTY_BIT_RATE)
+		return 0;
+
+	duty_switch(duty_activity);					// charge time up to now
+	wall = bits * 5 / 3;						// SMCLK cycles per mille of window, 16MHz / 9600 / 1000 per bit
+	_BIC_SR(GIE);
+	for (i = 0; i < DUTY_SLEEP; i++) {
+		uint16_t share = duty_cycles[i] / wall;
+		if (awake + share > 1000)
+			share = 1000 - awake;				// cycles counted while not receiving, e.g. SURVEY
+		duty_report[i] = share;
+		awake += share;
+	}
+	duty_report[DUTY_SLEEP] = 1000 - awake;
+	for (i = 0; i < DUTY_SLEEP; i++)
+		duty_cycles[i] = 0;
+	duty_ph_last = 0;
+	duty_bits += bits;
+	_BIS_SR(GIE);
+	return 1;
+}
+
+uint16_t duty_permille(uint8_t activity)
+{
+	return duty_report[activity];
+}
+#else
+uint8_t duty_switch(uint8_t activity)
+{
+	return DUTY_MAIN;
+}
+#endif
+
+// extends TA0 to 32 bits
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void duty_timer_isr(void)
+{
+	TA0CTL &= ~TAIFG;
+	duty_overflows++;
+}
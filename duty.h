@@ -0,0 +1,58 @@
+/*
+ * Duty cycle instrumentation, share of time the MCU spends per activity
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * TA0 counts SMCLK (16MHz) continuously, extended to 32 bits by its overflow interrupt. Main sleeps in LPM3,
+ * where SMCLK stops, so TA0 only counts while the MCU is awake (in LPM0 while streaming raw bits it keeps
+ * counting). The packet handler ISR measures itself with DUTY_ISR_START and DUTY_ISR_END. The main loop
+ * charges the time between calls of duty_switch to its current activity, less the time of the ISR in between.
+ * Other interrupts count as the activity they interrupt. Cycles while main is in DUTY_SLEEP are dropped, sleep
+ * is the rest of the wall time, which is counted in DATA_CLK cycles of the first radio (9600 per second from
+ * the radio's crystal), so windows only advance while receiving. duty_poll closes a window every
+ * DUTY_WINDOW_SECONDS.
+ *
+ * The accounting takes 39 bytes of RAM and is only built with DUTY_CYCLE 1, e.g. -DDUTY_CYCLE=1, otherwise
+ * duty_switch does nothing. TA0 and duty_now are always there, MEASURE and the baud switch of uart.c time with it.
+ */
+
+#ifndef DUTY_H_
+#define DUTY_H_
+
+#ifndef DUTY_CYCLE
+#define DUTY_CYCLE			0				// 1 to build the accounting for DUTY
+#endif
+
+#define DUTY_WINDOW_SECONDS	60				// at most 268s, cycles of an activity must fit 32 bits
+#define DUTY_BIT_RATE		9600			// DATA_CLK cycles per second
+
+// activities, DUTY_SLEEP isn't counted but reported as the rest of the window
+enum DUTY_ACTIVITY {
+	DUTY_MAIN = 0,							// main loop, e.g. commands and housekeeping
+	DUTY_NMEA,								// encoding NMEA sentences
+	DUTY_UART,								// waiting for UART to send
+	DUTY_PH,								// packet handler ISR
+	DUTY_SLEEP,
+	DUTY_ACTIVITIES
+};
+
+void duty_init(void);						// start TA0, SMCLK must run at 16MHz
+uint32_t duty_now(void);					// SMCLK cycles while awake, wraps
+uint8_t duty_switch(uint8_t activity);		// charge time since last switch to current activity, returns it
+
+#if DUTY_CYCLE
+extern uint32_t duty_cycles[DUTY_SLEEP];	// SMCLK cycles per activity in current window
+
+#define DUTY_ISR_START()	uint16_t duty_start = TA0R
+#define DUTY_ISR_END()		duty_cycles[DUTY_PH] += (uint16_t) (TA0R - duty_start)
+
+uint8_t duty_poll(void);					// returns 1 if a window was closed
+uint16_t duty_permille(uint8_t activity);	// share of activity in last window, DUTY_SLEEP is the rest
+#else
+#define DUTY_ISR_START()
+#define DUTY_ISR_END()
+#endif
+
+#endif /* DUTY_H_ */
@@ -0,0 +1,43 @@
+/*
+ * Events posted by interrupts for the main loop, which handles them by priority
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "event.h"
+
+volatile uint8_t event_flags = 0;
+
+void event_post(uint8_t event)
+{
+	_BIC_SR(GIE);
+	event_flags |= event;
+	_BIS_SR(GIE);
+}
+
+uint8_t event_take(void)
+{
+	uint8_t event;
+
+	_BIC_SR(GIE);
+	event = event_flags & -event_flags;			// lowest bit set
+	event_flags &= ~event;
+	_BIS_SR(GIE);
+	return event;
+}
+
+void event_sleep(uint8_t smclk)
+{
+	_BIC_SR(GIE);
+	if (event_flags)
+		_BIS_SR(GIE);							// event came in while working, don't sleep
+	else if (smclk)
+		_BIS_SR(LPM0_bits | GIE);				// enabling interrupts with LPM bits, no interrupt gets in between
+	else
+		_BIS_SR(LPM3_bits | GIE);				// ACLK keeps running for health tick and watchdog
+}
@@ -0,0 +1,34 @@
+/*
+ * Events posted by interrupts for the main loop, which handles them by priority
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * An interrupt posts its event with EVENT_POST and wakes the main loop. The main loop takes one event at a
+ * time, lowest bit first, and runs its task to completion. A task with more work posts its event again, so
+ * events of higher priority get in between. Commands continue with EVENT_CONTINUE, below the tick, so a long
+ * command (SURVEY, LOG REPLAY, ..) can't starve supervision and the watchdog. Work without an event
+ * (housekeeping) runs when no event is pending, and before each continuation. event_sleep disables interrupts to check for events, so an event posted right before can't be
+ * slept through.
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+// events by priority, highest first
+#define EVENT_PACKET	BIT0			// packet handler reset after packet, error or sync timeout
+#define EVENT_SYNC		BIT1			// packet handler found preamble and start flag
+#define EVENT_COMMAND	BIT2			// UART received end of line or RX buffer is almost full
+#define EVENT_TICK		BIT3			// health tick, about once per second
+#define EVENT_CONTINUE	BIT4			// command has more work, posted by main loop
+
+extern volatile uint8_t event_flags;
+
+#define EVENT_POST(event)	(event_flags |= (event))	// in interrupt service routines only
+
+void event_post(uint8_t event);			// post event from main loop
+uint8_t event_take(void);				// clear and return pending event of highest priority, 0 if none
+void event_sleep(uint8_t smclk);		// sleep in LPM3 until an event is posted, LPM0 if SMCLK must keep running
+
+#endif /* EVENT_H_ */
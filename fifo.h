@@ -6,6 +6,36 @@
 #ifndef FIFO_H_
 #define FIFO_H_
 
+#define FIFO_BUFFER_SIZE		128					// size of FIFO in bytes (must be 2^x)
+#define FIFO_PACKETS			8					// max number of individual packets in FIFO (must be 2^x, should be approx. FIFO_BUFFER_SIZE/avg message size)
+
+#if (FIFO_BUFFER_SIZE > 256)						// determine smallest data type required to hold FIFO pointers
+#define FIFO_PTR_TYPE	uint16_t					// 16 bit for FIFO larger than 256 bytes
+#else
+#define FIFO_PTR_TYPE	uint8_t						// 8 bit for FIFO smaller than 256 bytes
+#endif
+
+struct fifo_s {
+	uint8_t buffer[FIFO_BUFFER_SIZE];				// buffer to hold packet data
+	FIFO_PTR_TYPE packets[FIFO_PACKETS];			// table with start offsets of received packets
+	FIFO_PTR_TYPE bytes_in;							// counter for bytes written into current packet
+	FIFO_PTR_TYPE bytes_out;						// counter for bytes read from current packet
+	volatile uint8_t packet_in;						// table index of incoming packet
+	uint8_t packet_out;								// table index of outgoing packet
+};
+
+extern struct fifo_s fifo_default;					// FIFO of the packet handler ISR, read by NMEA encoder
+
+// functions operating on a given FIFO, e.g. one per packet handler context
+void fifo_ctx_reset(struct fifo_s* fifo);
+void fifo_ctx_new_packet(struct fifo_s* fifo);
+void fifo_ctx_write_byte(struct fifo_s* fifo, uint8_t data);
+void fifo_ctx_commit_packet(struct fifo_s* fifo);
+uint16_t fifo_ctx_get_packet(struct fifo_s* fifo);
+uint8_t fifo_ctx_read_byte(struct fifo_s* fifo);
+void fifo_ctx_remove_packet(struct fifo_s* fifo);
+
+// functions operating on default FIFO
 void fifo_reset(void);					// reset FIFO, all unread data is lost
 
 void fifo_new_packet(void);				// start a new packet, discards any non-committed data
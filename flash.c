@@ -0,0 +1,46 @@
+/*
+ * Simple flash library for MSP430G2553, erase segments and write bytes
+ * Author: Adrian Studer
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+#include "flash.h"
+
+// flash timing generator needs 257..476kHz, SMCLK 16MHz / 40 = 400kHz
+#define FLASH_DIVIDER	40
+
+void flash_erase(uint8_t* segment)
+{
+	uint16_t gie = __get_SR_register() & GIE;
+
+	_BIC_SR(GIE);									// no interrupts while flash isn't readable
+	FCTL2 = FWKEY | FSSEL_2 | (FLASH_DIVIDER - 1);	// timing generator from SMCLK
+	FCTL3 = FWKEY;									// unlock flash (LOCKA stays set)
+	FCTL1 = FWKEY | ERASE;							// segment erase
+	*segment = 0;									// dummy write starts erase, CPU is held until done
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY | LOCK;							// lock flash
+	_BIS_SR(gie);
+}
+
+void flash_write(uint8_t* address, const void* data, uint16_t size)
+{
+	const uint8_t* bytes = data;
+	uint16_t gie = __get_SR_register() & GIE;
+	uint16_t i;
+
+	_BIC_SR(GIE);
+	FCTL2 = FWKEY | FSSEL_2 | (FLASH_DIVIDER - 1);
+	FCTL3 = FWKEY;
+	FCTL1 = FWKEY | WRT;							// byte write mode
+	for (i = 0; i < size; i++) {
+		address[i] = bytes[i];						// CPU is held until byte is programmed
+		_BIS_SR(gie);								// flash is readable between bytes, serve pending interrupts
+		__no_operation();							// interrupts are accepted after instruction following EINT
+		_BIC_SR(GIE);
+	}
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY | LOCK;
+	_BIS_SR(gie);
+}
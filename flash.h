@@ -0,0 +1,29 @@
+/*
+ * Simple flash library for MSP430G2553, erase segments and write bytes
+ * Author: Adrian Studer
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#ifndef FLASH_INFO_MEMORY							// host emulation provides its own memory
+#define FLASH_INFO_MEMORY	((uint8_t*) 0x1000)		// information memory, segments D, C, B and A
+#endif
+
+#define FLASH_INFO_SEGMENT_SIZE	64
+#define FLASH_INFO_D	(FLASH_INFO_MEMORY + 0x00)
+#define FLASH_INFO_C	(FLASH_INFO_MEMORY + 0x40)
+#define FLASH_INFO_B	(FLASH_INFO_MEMORY + 0x80)
+// segment A at 0x10c0 holds DCO calibration data and is never erased by this library
+
+#ifndef FLASH_MAIN_MEMORY
+#define FLASH_MAIN_MEMORY	((uint8_t*) 0xc000)		// main memory, 16KB up to interrupt vectors
+#endif
+#define FLASH_MAIN_SEGMENT_SIZE	512
+
+// erase blocks for about 12ms with interrupts held off, i.e. the packet handler misses about 115 bits
+// write blocks for about 75us per byte, interrupts are served between bytes
+void flash_erase(uint8_t* segment);								// erase segment starting at address, all bytes 0xff
+void flash_write(uint8_t* address, const void* data, uint16_t size);	// program bytes, can only clear bits of erased flash
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,134 @@
+/*
+ * Supervision of radios and packet handler with recovery in tiers, and the watchdog
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "radio.h"
+#include "fifo.h"
+#include "packet_handler.h"
+#include "event.h"
+#include "health.h"
+
+#define HEALTH_WATCHDOG		(WDTPW | WDTCNTCL | WDTSSEL)	// watchdog mode, ACLK, 32768 cycles, clears counter
+
+// supervision of one radio
+struct health_radio_s {
+	struct ph_activity_s activity;		// counters of packet handler at last tick
+	uint16_t silent;					// ticks since last sync
+	uint8_t timeouts;					// CTS timeouts of radio at last tick
+	uint8_t stalled;					// ticks in a row with too few DATA_CLK cycles
+	uint8_t tier;						// last recovery applied, HEALTH_OK after a sync
+};
+
+struct health_stats_s health_stats;
+
+static struct health_radio_s health_radios[RADIO_DEVICES];
+
+// MCU resets survive a reset, valid if check is the complement
+#pragma DATA_SECTION(health_resets, ".noinit")
+#pragma DATA_SECTION(health_resets_check, ".noinit")
+static uint16_t health_resets;
+static uint16_t health_resets_check;
+
+void health_init(void)
+{
+	BCSCTL3 |= LFXT1S_2;						// ACLK from VLO
+	BCSCTL1 |= DIVA_3;							// divided by 8
+	WDTCTL = HEALTH_WATCHDOG;
+
+	if ((IFG1 & PORIFG) || health_resets_check != (uint16_t) ~health_resets)
+		health_resets = 0;						// power on, count starts over
+	health_resets_check = ~health_resets;
+	health_stats.resets = health_resets;
+}
+
+void health_start(void)
+{
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {		// timeouts and cycles so far don't count
+		struct health_radio_s* h = &health_radios[n];
+		ph_get_activity(n, &h->activity);
+		h->timeouts = radio_devices[n].cts_timeouts;
+		h->silent = 0;
+		h->stalled = 0;
+		h->tier = HEALTH_OK;
+	}
+	TA1CCR0 = HEALTH_TICK - 1;
+	TA1CCTL0 = CCIE;
+	TA1CTL = TASSEL_1 | MC_1 | TACLR;			// ACLK, up mode, interrupt per tick
+}
+
+static void health_recover(uint8_t radio, uint8_t tier)
+{
+	if (tier == HEALTH_RESET_MCU) {
+		health_resets++;
+		health_resets_check = ~health_resets;
+		health_stats.resets = health_resets;
+		WDTCTL = 0;								// wrong password resets MCU
+		return;
+	}
+
+	ph_stop();									// all radios, ISR doesn't use the radio anymore
+	if (tier == HEALTH_CONFIGURE) {
+		radio_configure(&radio_devices[radio]);
+		health_stats.configures++;
+	} else
+		health_stats.restarts++;
+	ph_start();
+}
+
+void health_poll(void)
+{
+	uint8_t n;
+
+	WDTCTL = HEALTH_WATCHDOG;					// timer and main loop are alive
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		struct health_radio_s* h = &health_radios[n];
+		struct ph_activity_s activity;
+		uint8_t timeouts = radio_devices[n].cts_timeouts;
+		uint8_t fault = HEALTH_OK;				// highest tier that may recover fault
+
+		if (!ph_get_activity(n, &activity)) {	// not receiving, e.g. during SURVEY or without channels
+			h->stalled = 0;
+			h->silent = 0;
+		} else {
+			if (timeouts != h->timeouts)
+				fault = HEALTH_RESET_MCU;
+			if ((uint16_t) (activity.clocks - h->activity.clocks) < HEALTH_MIN_CLOCKS) {
+				if (++h->stalled >= HEALTH_STALL_TICKS)
+					fault = HEALTH_RESET_MCU;
+			} else
+				h->stalled = 0;
+			if (activity.syncs != h->activity.syncs) {
+				h->silent = 0;
+				h->tier = HEALTH_OK;
+			} else if (++h->silent >= HEALTH_SYNC_TICKS && fault == HEALTH_OK)
+				fault = HEALTH_CONFIGURE;
+		}
+		h->activity = activity;
+		h->timeouts = timeouts;					// timeouts while recovering count for next tick
+
+		if (fault != HEALTH_OK) {
+			if (h->tier < fault)
+				h->tier++;
+			h->stalled = 0;
+			h->silent = 0;
+			health_recover(n, h->tier);
+		}
+	}
+}
+
+#pragma vector=TIMER1_A0_VECTOR
+__interrupt void health_timer_isr(void)
+{
+	EVENT_POST(EVENT_TICK);
+	__low_power_mode_off_on_exit();				// wake main loop for health_poll
+}
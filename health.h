@@ -0,0 +1,48 @@
+/*
+ * Supervision of radios and packet handler with recovery in tiers, and the watchdog
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * TA1 ticks on ACLK (VLO / 8) and posts EVENT_TICK about once per second. On each tick health_poll checks
+ * every radio the packet handler receives with:
+ *   - commands given up after a CTS timeout (hard fault)
+ *   - fewer than HEALTH_MIN_CLOCKS DATA_CLK cycles in HEALTH_STALL_TICKS ticks in a row (hard fault)
+ *   - no sync for HEALTH_SYNC_TICKS ticks (soft fault, a quiet area looks the same)
+ * Each fault applies the next recovery tier of the radio: restart RX, reset and configure the radio, reset
+ * the MCU. A sync returns the radio to the first tier. Soft faults stop at configuring the radio.
+ * The watchdog runs on ACLK too and resets the MCU if health_poll isn't called for 32768 ACLK cycles,
+ * e.g. if the main loop hangs. VLO runs at 4 to 20kHz, so ticks take 0.6 to 3s and the watchdog 13 to 65s.
+ */
+
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+#define HEALTH_TICK			1500		// ACLK cycles per tick, VLO 12kHz / 8
+#define HEALTH_MIN_CLOCKS	2400		// DATA_CLK cycles per tick, a receiving radio clocks 9600 per second
+#define HEALTH_STALL_TICKS	2			// ticks in a row with too few DATA_CLK cycles
+#define HEALTH_SYNC_TICKS	900			// ticks without sync, 15 minutes
+
+// recovery tiers
+enum HEALTH_TIER {
+	HEALTH_OK = 0,
+	HEALTH_RESTART_RX,					// stop and start packet handler, restarts RX
+	HEALTH_CONFIGURE,					// reset and configure radio, including IRCAL
+	HEALTH_RESET_MCU					// reset by watchdog, configuration of radio is checked at start
+};
+
+// recoveries, reported by STATS
+struct health_stats_s {
+	uint16_t restarts;					// RX restarts since start
+	uint16_t configures;				// radio configurations since start
+	uint16_t resets;					// MCU resets since power on
+};
+
+extern struct health_stats_s health_stats;
+
+void health_init(void);					// start watchdog on ACLK, call at start of main
+void health_start(void);				// start ticks on TA1 once packet handler has started
+void health_poll(void);					// call on EVENT_TICK, kicks watchdog, checks radios and recovers
+
+#endif /* HEALTH_H_ */
@@ -0,0 +1,424 @@
+/*
+ * Batch decoder for archived raw bit captures on all cores, output is NMEA on stdout
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Capture files hold the raw (NRZI) levels of the radio's DATA pin, packed 8 bits per byte MSB
+ * first, or one byte per bit with -u, or are indexed captures of bit_capture.h. Files are memory mapped and split into chunks, which are
+ * decoded by the firmware packet handler on a work-stealing thread pool.
+ *
+ * Each chunk starts decoding BATCH_OVERLAP bits early and continues BATCH_OVERLAP bits past its
+ * end. The state machine is fully determined once two decoders reset on the same bit, so chunks
+ * are cut at the first reset both neighbours agree on, i.e. at a sync boundary. The merged output
+ * is identical to decoding each file in one go.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fifo.h"
+#include "nmea.h"
+#include "packet_handler.h"
+#include "bit_capture.h"
+
+#define BATCH_CHUNK			(1 << 22)		// default bits per chunk, about 7 minutes at 9600 bps
+#define BATCH_OVERLAP		4096			// bits decoded before and after chunk to find a common reset
+#define BATCH_MAX_PACKET	128				// max packet size incl. channel and CRC, size of firmware FIFO
+#define BATCH_MAX_THREADS	256
+
+struct packet_s {
+	uint64_t bit;							// bit index of end flag in file
+	uint8_t size;
+	uint8_t data[BATCH_MAX_PACKET];			// channel, payload, CRC as stored in FIFO
+};
+
+struct reset_list_s {
+	uint64_t* bits;							// bit indices of PH_EVENT_RESET
+	size_t count;
+	size_t capacity;
+};
+
+struct capture_s {
+	const char* name;
+	const uint8_t* map;						// mapped file
+	size_t size;
+	const uint8_t* data;					// raw bits in mapped file
+	uint64_t nbits;
+	uint8_t unpacked;						// one byte per bit
+};
+
+struct chunk_s {
+	struct capture_s* capture;
+	uint64_t start;							// nominal range of chunk
+	uint64_t end;
+	struct packet_s* packets;				// packets decoded from start - overlap to end + overlap
+	size_t count;
+	size_t capacity;
+	struct reset_list_s head;				// resets in [start - overlap, start + overlap)
+	struct reset_list_s tail;				// resets in [end - overlap, end + overlap)
+	uint64_t cut;							// chunk owns packets in (cut of this chunk, cut of next chunk]
+};
+
+// task queue of one worker, owner takes from head, thieves from tail
+struct worker_s {
+	pthread_mutex_t lock;
+	size_t head;
+	size_t tail;
+	size_t* tasks;
+	pthread_t thread;
+	uint16_t id;
+	size_t own;								// statistics
+	size_t stolen;
+	uint64_t bits;
+	double seconds;
+};
+
+static struct chunk_s* chunks;
+static struct worker_s* workers;
+static uint16_t nworkers;
+static uint8_t batch_unpacked = 0;
+static uint8_t batch_channel = 0;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint8_t capture_bit(const struct capture_s* capture, uint64_t n)
+{
+	if (capture->unpacked)
+		return capture->data[n] & 1;
+	return (capture->data[n >> 3] >> (7 - (n & 7))) & 1;
+}
+
+static void add_reset(struct reset_list_s* list, uint64_t bit)
+{
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity * 2 + 64;
+		list->bits = realloc(list->bits, list->capacity * sizeof(uint64_t));
+	}
+	list->bits[list->count++] = bit;
+}
+
+// move packets from FIFO into chunk
+static void collect_packets(struct chunk_s* chunk, struct fifo_s* fifo, uint64_t bit)
+{
+	uint16_t size;
+
+	while ((size = fifo_ctx_get_packet(fifo)) != 0) {
+		if (size <= BATCH_MAX_PACKET) {
+			struct packet_s* p;
+			uint16_t n;
+			if (chunk->count == chunk->capacity) {
+				chunk->capacity = chunk->capacity * 2 + 64;
+				chunk->packets = realloc(chunk->packets, chunk->capacity * sizeof(struct packet_s));
+			}
+			p = &chunk->packets[chunk->count++];
+			p->bit = bit;
+			p->size = size;
+			for (n = 0; n < size; n++)
+				p->data[n] = fifo_ctx_read_byte(fifo);
+		}
+		fifo_ctx_remove_packet(fifo);
+	}
+}
+
+static uint64_t decode_chunk(struct chunk_s* chunk)
+{
+	const struct capture_s* capture = chunk->capture;
+	uint64_t from = chunk->start > BATCH_OVERLAP ? chunk->start - BATCH_OVERLAP : 0;
+	uint64_t to = chunk->end + BATCH_OVERLAP < capture->nbits ? chunk->end + BATCH_OVERLAP : capture->nbits;
+	uint64_t head_end = chunk->start + BATCH_OVERLAP;
+	uint64_t tail_start = chunk->end > BATCH_OVERLAP ? chunk->end - BATCH_OVERLAP : 0;
+	struct ph_context_s ph;
+	struct fifo_s fifo;
+	uint64_t n;
+
+	fifo_ctx_reset(&fifo);
+	ph_context_init(&ph, &fifo, batch_channel);
+
+	for (n = from; n < to; n++) {
+		if (ph_process_bit(&ph, capture_bit(capture, n)) & PH_EVENT_RESET) {
+			collect_packets(chunk, &fifo, n);			// packets are committed when state machine resets
+			if (n < head_end)
+				add_reset(&chunk->head, n);
+			if (n >= tail_start)
+				add_reset(&chunk->tail, n);
+		}
+	}
+
+	return to - from;
+}
+
+// take task from own queue, or steal from the tail of another
+static int next_task(struct worker_s* self, size_t* task)
+{
+	uint16_t k;
+
+	pthread_mutex_lock(&self->lock);
+	if (self->head < self->tail) {
+		*task = self->tasks[self->head++];
+		pthread_mutex_unlock(&self->lock);
+		self->own++;
+		return 1;
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	for (k = 1; k < nworkers; k++) {
+		struct worker_s* victim = &workers[(self->id + k) % nworkers];
+		pthread_mutex_lock(&victim->lock);
+		if (victim->head < victim->tail) {
+			*task = victim->tasks[--victim->tail];
+			pthread_mutex_unlock(&victim->lock);
+			self->stolen++;
+			return 1;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	return 0;
+}
+
+static void* worker_thread(void* arg)
+{
+	struct worker_s* self = arg;
+	size_t task;
+
+	while (next_task(self, &task)) {
+		double t0 = now();
+		self->bits += decode_chunk(&chunks[task]);
+		self->seconds += now() - t0;
+	}
+
+	return 0;
+}
+
+// first reset on which the previous chunk and this chunk agree, both decoders are identical after it
+static int find_cut(const struct chunk_s* prev, const struct chunk_s* chunk, uint64_t* cut)
+{
+	uint64_t from = chunk->start > BATCH_OVERLAP ? chunk->start - BATCH_OVERLAP : 0;
+	size_t a = 0, b = 0;
+
+	while (a < prev->tail.count && b < chunk->head.count) {
+		uint64_t ra = prev->tail.bits[a], rb = chunk->head.bits[b];
+		if (ra < rb)
+			a++;
+		else if (rb < ra)
+			b++;
+		else if (ra <= from)							// this chunk has no NRZI history yet
+			a++, b++;
+		else {
+			*cut = ra;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int map_capture(struct capture_s* capture, const char* name)
+{
+	struct stat st;
+	int fd;
+
+	capture->name = name;
+	if ((fd = open(name, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(name);
+		return 1;
+	}
+	capture->size = st.st_size;
+	capture->map = 0;
+	if (capture->size) {
+		capture->map = mmap(0, capture->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (capture->map == MAP_FAILED) {
+			perror(name);
+			close(fd);
+			return 1;
+		}
+		madvise((void*) capture->map, capture->size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	if (bit_capture_is_capture(capture->map, capture->size)) {
+		const struct bit_capture_header_s* h = (const struct bit_capture_header_s*) capture->map;
+		capture->data = capture->map + h->data_offset;
+		capture->nbits = h->bit_count;
+		capture->unpacked = 0;
+	} else {
+		capture->data = capture->map;
+		capture->unpacked = batch_unpacked;
+		capture->nbits = capture->unpacked ? capture->size : (uint64_t) capture->size * 8;
+	}
+	return 0;
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options] file..\n"
+		"  -j threads      number of worker threads (default: number of cores)\n"
+		"  -k bits         bits per chunk (default %u)\n"
+		"  -u              one byte per bit instead of 8 bits per byte, MSB first\n"
+		"  -c channel      channel label A or B in NMEA output (default A)\n"
+		"  -s              print per-thread throughput to stderr\n"
+		"files are decoded independently, output is in order of files and time\n", name, BATCH_CHUNK);
+}
+
+int main(int argc, char* argv[])
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t chunk_bits = BATCH_CHUNK;
+	uint8_t stats = 0;
+	int opt;
+
+	nworkers = cores > 0 ? cores : 1;
+	while ((opt = getopt(argc, argv, "j:k:uc:sh")) != -1) {
+		switch (opt) {
+		case 'j': nworkers = atoi(optarg); break;
+		case 'k': chunk_bits = strtoull(optarg, 0, 0); break;
+		case 'u': batch_unpacked = 1; break;
+		case 'c': batch_channel = (optarg[0] == 'B' || optarg[0] == 'b'); break;
+		case 's': stats = 1; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind >= argc || nworkers < 1 || nworkers > BATCH_MAX_THREADS || chunk_bits < 2 * BATCH_OVERLAP) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// map files and split into chunks
+	uint16_t ncaptures = argc - optind;
+	struct capture_s* captures = calloc(ncaptures, sizeof(struct capture_s));
+	size_t nchunks = 0, n;
+	uint64_t total_bits = 0;
+	uint16_t c;
+
+	for (c = 0; c < ncaptures; c++) {
+		if (map_capture(&captures[c], argv[optind + c]))
+			return 1;
+		nchunks += (captures[c].nbits + chunk_bits - 1) / chunk_bits;
+		total_bits += captures[c].nbits;
+	}
+
+	chunks = calloc(nchunks + 1, sizeof(struct chunk_s));
+	nchunks = 0;
+	for (c = 0; c < ncaptures; c++) {
+		uint64_t start;
+		for (start = 0; start < captures[c].nbits; start += chunk_bits) {
+			chunks[nchunks].capture = &captures[c];
+			chunks[nchunks].start = start;
+			chunks[nchunks].end = start + chunk_bits < captures[c].nbits ? start + chunk_bits : captures[c].nbits;
+			nchunks++;
+		}
+	}
+
+	// contiguous run of chunks per worker, idle workers steal from the end of busy ones
+	workers = calloc(nworkers, sizeof(struct worker_s));
+	size_t* tasks = malloc((nchunks + 1) * sizeof(size_t));
+	uint16_t w;
+
+	for (n = 0; n < nchunks; n++)
+		tasks[n] = n;
+	for (w = 0; w < nworkers; w++) {
+		pthread_mutex_init(&workers[w].lock, 0);
+		workers[w].id = w;
+		workers[w].tasks = tasks;
+		workers[w].head = nchunks * w / nworkers;
+		workers[w].tail = nchunks * (w + 1) / nworkers;
+	}
+
+	double t0 = now();
+	for (w = 0; w < nworkers; w++)
+		pthread_create(&workers[w].thread, 0, worker_thread, &workers[w]);
+	for (w = 0; w < nworkers; w++)
+		pthread_join(workers[w].thread, 0);
+	double seconds = now() - t0;
+
+	// cut chunks at sync boundaries
+	size_t unsynced = 0;
+	for (n = 0; n < nchunks; n++) {
+		struct chunk_s* chunk = &chunks[n];
+		if (chunk->start == 0) {
+			chunk->cut = 0;
+			continue;
+		}
+		if (!find_cut(&chunks[n - 1], chunk, &chunk->cut)) {
+			chunk->cut = chunk->start;				// no common reset, e.g. during continuous preamble
+			unsynced++;
+		}
+	}
+
+	// output in order of files and reception through firmware NMEA encoder
+	size_t packets = 0;
+	fifo_reset();
+	for (n = 0; n < nchunks; n++) {
+		struct chunk_s* chunk = &chunks[n];
+		uint64_t first = chunk->start ? chunk->cut + 1 : 0;
+		uint64_t last = (n + 1 < nchunks && chunks[n + 1].start) ? chunks[n + 1].cut : UINT64_MAX;
+		size_t p;
+
+		for (p = 0; p < chunk->count; p++) {
+			struct packet_s* packet = &chunk->packets[p];
+			uint8_t b;
+			if (packet->bit < first || packet->bit > last)
+				continue;
+			fifo_new_packet();
+			for (b = 0; b < packet->size; b++)
+				fifo_write_byte(packet->data[b]);
+			fifo_commit_packet();
+			nmea_process_packet();
+			fifo_remove_packet();
+			packets++;
+		}
+	}
+	fflush(stdout);
+
+	if (stats) {
+		double busy = 0;
+		fprintf(stderr, "%u files, %" PRIu64 " bits (%.1f h at 9600 bps), %zu chunks, %zu packets\n",
+				ncaptures, total_bits, total_bits / 9600.0 / 3600.0, nchunks, packets);
+		for (w = 0; w < nworkers; w++) {
+			struct worker_s* worker = &workers[w];
+			fprintf(stderr, "thread %3u: %5zu chunks (%zu stolen), %7.2f s, %7.1f Mbit/s\n",
+					w, worker->own + worker->stolen, worker->stolen, worker->seconds,
+					worker->seconds > 0 ? worker->bits / worker->seconds * 1e-6 : 0);
+			busy += worker->seconds;
+		}
+		fprintf(stderr, "total: %.2f s, %.1f Mbit/s, %.2f threads busy on average\n",
+				seconds, seconds > 0 ? total_bits / seconds * 1e-6 : 0, seconds > 0 ? busy / seconds : 0);
+		if (unsynced)
+			fprintf(stderr, "%zu chunk boundaries without common reset, packets there may differ\n", unsynced);
+	}
+
+	for (n = 0; n < nchunks; n++) {
+		free(chunks[n].packets);
+		free(chunks[n].head.bits);
+		free(chunks[n].tail.bits);
+	}
+	for (c = 0; c < ncaptures; c++)
+		if (captures[c].size)
+			munmap((void*) captures[c].map, captures[c].size);
+	for (w = 0; w < nworkers; w++)
+		pthread_mutex_destroy(&workers[w].lock);
+	free(workers);
+	free(tasks);
+	free(chunks);
+	free(captures);
+
+	return 0;
+}
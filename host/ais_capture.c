@@ -0,0 +1,257 @@
+/*
+ * Converts, lists and decodes indexed capture files of raw demodulator bits
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * With -o a raw bit file (as read by ais_batch) or the raw bit stream of the firmware (-R, see
+ * ph_set_raw_stream) is converted into an indexed capture, otherwise
+ * the file is an indexed capture: prints a summary, lists the sync index (-l) or decodes packets
+ * picked from the index (-p), seeking to them without decoding the bits in between.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "nmea.h"
+#include "packet_handler.h"
+#include "bit_capture.h"
+
+static const char* error_names[] = { "ok", "stuff bit", "no end", "CRC", "RSSI" };
+
+static int convert(const char* in_name, const char* out_name, uint8_t unpacked, uint8_t channel, uint64_t start_time)
+{
+	struct bit_capture_writer_s w;
+	FILE* in;
+	int c;
+
+	if (!(in = fopen(in_name, "rb"))) {
+		perror(in_name);
+		return 1;
+	}
+	if (bit_capture_create(&w, out_name, start_time, channel)) {
+		perror(out_name);
+		fclose(in);
+		return 1;
+	}
+
+	while ((c = getc(in)) != EOF) {
+		if (unpacked)
+			bit_capture_write(&w, c & 1);
+		else {
+			int8_t b;
+			for (b = 7; b >= 0; b--)
+				bit_capture_write(&w, (c >> b) & 1);
+		}
+	}
+	fclose(in);
+
+	if (bit_capture_finish(&w)) {
+		perror(out_name);
+		return 1;
+	}
+	return 0;
+}
+
+// raw bit stream of ph_irq_handler: 7 bits per data byte, marks for hops and overflows
+static int convert_stream(const char* in_name, const char* out_name, uint64_t start_time)
+{
+	struct bit_capture_writer_s w;
+	int pending = -1;						// data bytes are only complete if no hop mark follows
+	uint8_t started = 0;
+	size_t gaps = 0;
+	FILE* in;
+	int c;
+
+	if (!(in = fopen(in_name, "rb"))) {
+		perror(in_name);
+		return 1;
+	}
+
+	while ((c = getc(in)) != EOF) {
+		uint8_t bits = PH_RAW_BITS;
+		int8_t b;
+
+		if (!(c & 0x80)) {							// data byte
+			if (!started)							// skip text sent before stream started
+				continue;
+		} else if ((c & 0xc0) == PH_RAW_MARK_OVERFLOW) {
+			if (!started)
+				continue;
+		} else if (c & 7)							// hop mark, preceding byte is partial
+			bits = c & 7;
+
+		if (pending >= 0)
+			for (b = bits - 1; b >= 0; b--)
+				bit_capture_write(&w, (pending >> b) & 1);
+		pending = -1;
+
+		if (!(c & 0x80))
+			pending = c;
+		else if ((c & 0xc0) == PH_RAW_MARK_OVERFLOW) {
+			bit_capture_mark_gap(&w);
+			gaps++;
+		} else if (!started) {						// first hop mark has channel at start
+			if (bit_capture_create(&w, out_name, start_time, (c >> 3) & (PH_CHANNELS - 1))) {
+				perror(out_name);
+				fclose(in);
+				return 1;
+			}
+			started = 1;
+		} else
+			bit_capture_hop(&w, (c >> 3) & (PH_CHANNELS - 1));
+	}
+	fclose(in);
+
+	if (!started) {
+		fprintf(stderr, "%s: no raw bit stream found\n", in_name);
+		return 1;
+	}
+	if (pending >= 0) {
+		int8_t b;
+		for (b = PH_RAW_BITS - 1; b >= 0; b--)
+			bit_capture_write(&w, (pending >> b) & 1);
+	}
+	if (gaps)
+		fprintf(stderr, "%zu gaps, UART couldn't keep up\n", gaps);
+
+	if (bit_capture_finish(&w)) {
+		perror(out_name);
+		return 1;
+	}
+	return 0;
+}
+
+static void print_time(uint64_t time)
+{
+	time_t seconds = time / 1000000;
+	struct tm tm;
+	char text[32];
+
+	gmtime_r(&seconds, &tm);
+	strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+	printf("%s.%06u", text, (uint32_t) (time % 1000000));
+}
+
+// decode packet through seek, returns 1 if a packet was committed
+static int decode_sync(const struct bit_capture_s* cap, const struct bit_capture_sync_s* sync)
+{
+	struct ph_context_s ph;
+	uint64_t n;
+
+	bit_capture_seek(cap, sync, &ph, &fifo_default);
+	for (n = sync->start; n <= sync->end; n++)
+		ph_process_bit(&ph, bit_capture_level(cap, n));
+
+	if (!fifo_get_packet())
+		return 0;
+	nmea_process_packet();
+	fifo_remove_packet();
+	return 1;
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options] file\n"
+		"  -o out          convert raw bit file to indexed capture out\n"
+		"  -u              raw bit file has one byte per bit instead of 8 bits per byte, MSB first\n"
+		"  -R              convert raw bit stream of firmware as received from UART\n"
+		"  -c channel      channel A or B of raw bit file (default A)\n"
+		"  -T seconds      start time of raw bit file in seconds since 1970\n"
+		"  -l              list sync index of capture\n"
+		"  -p first[,count]  decode valid packets first.. of capture, NMEA on stdout\n"
+		"  -a              -p counts all syncs, not just valid packets\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* out_name = 0;
+	uint8_t unpacked = 0, channel = 0, list = 0, all = 0, stream = 0;
+	uint64_t start_time = 0;
+	long first = -1, count = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:uRc:T:lp:ah")) != -1) {
+		switch (opt) {
+		case 'o': out_name = optarg; break;
+		case 'u': unpacked = 1; break;
+		case 'R': stream = 1; break;
+		case 'c': channel = (optarg[0] == 'B' || optarg[0] == 'b'); break;
+		case 'T': start_time = (uint64_t) (atof(optarg) * 1e6); break;
+		case 'l': list = 1; break;
+		case 'p':
+			first = atol(optarg);
+			if (strchr(optarg, ','))
+				count = atol(strchr(optarg, ',') + 1);
+			break;
+		case 'a': all = 1; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (out_name && stream)
+		return convert_stream(argv[optind], out_name, start_time);
+	if (out_name)
+		return convert(argv[optind], out_name, unpacked, channel, start_time);
+
+	struct bit_capture_s cap;
+	size_t n, valid = 0, errors[5] = { 0 };
+
+	if (bit_capture_open(&cap, argv[optind])) {
+		fprintf(stderr, "%s: not an indexed capture\n", argv[optind]);
+		return 1;
+	}
+
+	if (first >= 0) {
+		long index = 0;
+		fifo_reset();
+		for (n = 0; n < cap.sync_count && count > 0; n++) {
+			if (!all && cap.syncs[n].error != PH_ERROR_NONE)
+				continue;
+			if (index++ < first)
+				continue;
+			decode_sync(&cap, &cap.syncs[n]);
+			count--;
+		}
+		bit_capture_close(&cap);
+		return 0;
+	}
+
+	for (n = 0; n < cap.sync_count; n++) {
+		const struct bit_capture_sync_s* sync = &cap.syncs[n];
+		if (sync->error < 5)
+			errors[sync->error]++;
+		if (sync->error == PH_ERROR_NONE)
+			valid++;
+		if (list) {
+			print_time(bit_capture_time(&cap, sync->sync));
+			printf(" %c bit %12" PRIu64 " start %12" PRIu64 " length %4" PRIu64 " %s\n", 'A' + sync->channel,
+					sync->sync, sync->start, sync->end - sync->sync, error_names[sync->error < 5 ? sync->error : 0]);
+		}
+	}
+
+	if (!list) {
+		printf("%" PRIu64 " bits at %u bps (%.1f s) from ", cap.bit_count, cap.header->bit_rate,
+				(double) cap.bit_count / cap.header->bit_rate);
+		print_time(cap.header->start_time);
+		printf("\n%zu marks, %zu syncs: %zu valid packets, %zu stuff bit, %zu no end, %zu CRC errors\n",
+				cap.mark_count, cap.sync_count, valid, errors[PH_ERROR_STUFFBIT], errors[PH_ERROR_NOEND], errors[PH_ERROR_CRC]);
+	}
+
+	bit_capture_close(&cap);
+	return 0;
+}
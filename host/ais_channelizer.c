@@ -0,0 +1,327 @@
+/*
+ * Decodes AIS channels A and B simultaneously from one wideband IQ capture, output is NMEA on stdout
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * A polyphase filter bank splits the capture into 25 kHz channels, channels A (161.975 MHz) and
+ * B (162.025 MHz) are demodulated and decoded on their own threads. As no packet is missed while
+ * hopping, this is the zero-hop reference for the channel hopping of the firmware, which is
+ * emulated on the same bits with -H.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "nmea.h"
+#include "packet_handler.h"
+#include "dsp.h"
+#include "demod.h"
+#include "sample_file.h"
+
+#define CHAN_SPACING		25000			// channel raster in Hz
+#define CHAN_RATE			(2 * CHAN_SPACING)	// sample rate of channels, filter bank is 2x oversampled
+#define CHAN_BRANCH_TAPS	24				// taps per polyphase branch
+#define CHAN_CUTOFF			0.5f			// filter bank cutoff relative to spacing, demodulator filters the channel
+#define CHAN_COUNT			2				// AIS channels A and B
+#define CHAN_MAX_PACKET		128				// max packet size incl. channel and CRC, size of firmware FIFO
+
+static const uint32_t chan_freq[CHAN_COUNT] = { 161975000, 162025000 };
+
+struct packet_s {
+	uint64_t bit;							// time of end flag in bits since start of capture
+	uint8_t size;
+	uint8_t data[CHAN_MAX_PACKET];			// channel, payload, CRC as stored in FIFO
+};
+
+struct packet_list_s {
+	struct packet_s* packets;
+	size_t count;
+	size_t capacity;
+};
+
+struct channel_s {
+	uint8_t id;								// 0=A, 1=B
+	struct demod_s demod;
+	struct ph_context_s ph;					// firmware packet handler
+	struct fifo_s fifo;
+	struct packet_list_s list;				// decoded packets
+	float* out_i[2];						// filter bank output, double buffered
+	float* out_q[2];
+	size_t count[2];
+	uint8_t* bits;							// raw (NRZI) bits of whole capture
+	size_t nbits;
+	size_t capacity;
+	pthread_t thread;
+};
+
+static pthread_barrier_t chan_sync;			// main thread hands over filled buffers, workers hand back processed ones
+static volatile uint8_t chan_stop = 0;
+
+// move packets from FIFO into list
+static void collect_packets(struct packet_list_s* list, struct fifo_s* fifo, uint64_t bit)
+{
+	uint16_t size;
+
+	while ((size = fifo_ctx_get_packet(fifo)) != 0) {
+		if (size <= CHAN_MAX_PACKET) {
+			struct packet_s* p;
+			uint16_t n;
+			if (list->count == list->capacity) {
+				list->capacity = list->capacity * 2 + 64;
+				list->packets = realloc(list->packets, list->capacity * sizeof(struct packet_s));
+			}
+			p = &list->packets[list->count++];
+			p->bit = bit;
+			p->size = size;
+			for (n = 0; n < size; n++)
+				p->data[n] = fifo_ctx_read_byte(fifo);
+		}
+		fifo_ctx_remove_packet(fifo);
+	}
+}
+
+// worker: demodulate and decode filter bank output of one channel
+static void* channel_thread(void* arg)
+{
+	struct channel_s* chan = arg;
+	uint8_t buf = 0;
+	size_t n, start;
+
+	for (;;) {
+		pthread_barrier_wait(&chan_sync);
+		if (chan_stop)
+			break;
+
+		if (chan->nbits + chan->count[buf] / 4 + 1 > chan->capacity) {	// at least 4 samples per bit
+			chan->capacity = chan->capacity * 2 + DSP_BLOCK;
+			chan->bits = realloc(chan->bits, chan->capacity);
+		}
+		start = chan->nbits;
+		chan->nbits += demod_iq(&chan->demod, chan->out_i[buf], chan->out_q[buf], chan->count[buf], chan->bits + chan->nbits);
+
+		for (n = start; n < chan->nbits; n++) {
+			if (ph_process_bit(&chan->ph, chan->bits[n]) & PH_EVENT_RESET)
+				collect_packets(&chan->list, &chan->fifo, n);	// packets are committed when state machine resets
+		}
+		buf ^= 1;
+	}
+
+	return 0;
+}
+
+static int compare_packets(const void* a, const void* b)
+{
+	const struct packet_s* pa = a;
+	const struct packet_s* pb = b;
+
+	if (pa->bit != pb->bit)
+		return pa->bit < pb->bit ? -1 : 1;
+	return (int) pa->data[0] - (int) pb->data[0];
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options] [file]\n"
+		"  -f format       wav (stereo), u8, s16 or f32 (default wav, raw formats need -r)\n"
+		"  -r rate         sample rate in Hz of raw formats, multiple of %u\n"
+		"  -c Hz           center frequency of capture, on %u Hz raster (default 162000000)\n"
+		"  -H              also decode with firmware channel hopping, compare with zero-hop\n"
+		"  -s              print statistics to stderr\n"
+		"reads stdin if no file is given\n", name, 2 * CHAN_SPACING, CHAN_SPACING);
+}
+
+int main(int argc, char* argv[])
+{
+	struct sample_file_s in = { stdin, SAMPLE_FORMAT_WAV, 2, 0 };
+	uint32_t center = 162000000;
+	uint8_t hop = 0;
+	uint8_t stats = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:r:c:Hsh")) != -1) {
+		switch (opt) {
+		case 'f':
+			if ((opt = sample_file_format(optarg)) < 0) {
+				usage(argv[0]);
+				return 2;
+			}
+			in.format = opt;
+			break;
+		case 'r': in.rate = atoi(optarg); break;
+		case 'c': center = atoi(optarg); break;
+		case 'H': hop = 1; break;
+		case 's': stats = 1; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind < argc && !(in.file = fopen(argv[optind], "rb"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (sample_file_open(&in) || in.channels != 2) {
+		fprintf(stderr, "unsupported file, need I/Q as stereo WAV (16 bit PCM or 32 bit float) or raw\n");
+		return 1;
+	}
+
+	uint16_t branches = in.rate / CHAN_SPACING;
+	int16_t bins[CHAN_COUNT];
+	uint8_t k;
+
+	if (in.rate % (2 * CHAN_SPACING) || center % CHAN_SPACING) {
+		usage(argv[0]);
+		return 2;
+	}
+	for (k = 0; k < CHAN_COUNT; k++) {
+		bins[k] = ((int32_t) chan_freq[k] - (int32_t) center) / CHAN_SPACING;
+		if (2 * abs(bins[k]) >= branches) {
+			fprintf(stderr, "channel %c at %u Hz not in capture\n", 'A' + k, chan_freq[k]);
+			return 1;
+		}
+	}
+
+	// filter bank in main thread, one worker thread per channel
+	float* buf_i = malloc(DSP_BLOCK * sizeof(float));
+	float* buf_q = malloc(DSP_BLOCK * sizeof(float));
+	struct channel_s chans[CHAN_COUNT];
+	float* out_i[CHAN_COUNT];
+	float* out_q[CHAN_COUNT];
+	struct pfb_s pfb;
+	uint8_t buf = 0;
+
+	pfb_init(&pfb, branches, CHAN_BRANCH_TAPS, CHAN_CUTOFF);
+	pthread_barrier_init(&chan_sync, 0, CHAN_COUNT + 1);
+	memset(chans, 0, sizeof(chans));
+	for (k = 0; k < CHAN_COUNT; k++) {
+		chans[k].id = k;
+		demod_init(&chans[k].demod, CHAN_RATE, 1);
+		fifo_ctx_reset(&chans[k].fifo);
+		ph_context_init(&chans[k].ph, &chans[k].fifo, k);
+		chans[k].out_i[0] = malloc(DSP_BLOCK * sizeof(float));
+		chans[k].out_q[0] = malloc(DSP_BLOCK * sizeof(float));
+		chans[k].out_i[1] = malloc(DSP_BLOCK * sizeof(float));
+		chans[k].out_q[1] = malloc(DSP_BLOCK * sizeof(float));
+		pthread_create(&chans[k].thread, 0, channel_thread, &chans[k]);
+	}
+
+	uint64_t samples = 0;
+	struct timespec start, end;
+	size_t count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while ((count = sample_file_read(&in, buf_i, buf_q, DSP_BLOCK)) != 0) {
+		size_t n;
+
+		for (k = 0; k < CHAN_COUNT; k++) {
+			out_i[k] = chans[k].out_i[buf];
+			out_q[k] = chans[k].out_q[buf];
+		}
+		n = pfb_process(&pfb, buf_i, buf_q, count, CHAN_COUNT, bins, out_i, out_q);
+		for (k = 0; k < CHAN_COUNT; k++)
+			chans[k].count[buf] = n;
+
+		pthread_barrier_wait(&chan_sync);		// workers start on this block, main continues with the other buffer
+		buf ^= 1;
+		samples += count;
+	}
+
+	chan_stop = 1;
+	pthread_barrier_wait(&chan_sync);
+	for (k = 0; k < CHAN_COUNT; k++)
+		pthread_join(chans[k].thread, 0);
+
+	// merge channels
+	struct packet_list_s list = { 0, 0, 0 };
+	size_t received[CHAN_COUNT];
+	size_t n;
+
+	for (k = 0; k < CHAN_COUNT; k++) {
+		received[k] = chans[k].list.count;
+		list.capacity += received[k];
+	}
+	list.packets = malloc(list.capacity * sizeof(struct packet_s) + 1);
+	for (k = 0; k < CHAN_COUNT; k++) {
+		memcpy(list.packets + list.count, chans[k].list.packets, received[k] * sizeof(struct packet_s));
+		list.count += received[k];
+	}
+
+	// firmware hopping between A and B on the same bits
+	size_t hop_received = 0;
+	if (hop) {
+		struct packet_list_s hop_list = { 0, 0, 0 };
+		struct ph_context_s ph;
+		struct fifo_s fifo;
+		size_t nbits = chans[0].nbits < chans[1].nbits ? chans[0].nbits : chans[1].nbits;
+
+		fifo_ctx_reset(&fifo);
+		ph_context_init(&ph, &fifo, 0);
+		for (n = 0; n < nbits; n++) {
+			if (ph_process_bit(&ph, chans[ph.radio_channel].bits[n]) & PH_EVENT_RESET) {
+				collect_packets(&hop_list, &fifo, n);
+				ph.radio_channel ^= 1;				// hop like ph_irq_handler
+			}
+		}
+		hop_received = hop_list.count;
+		free(hop_list.packets);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// output in order of reception through firmware NMEA encoder
+	qsort(list.packets, list.count, sizeof(struct packet_s), compare_packets);
+	fifo_reset();
+	for (n = 0; n < list.count; n++) {
+		uint8_t b;
+		fifo_new_packet();
+		for (b = 0; b < list.packets[n].size; b++)
+			fifo_write_byte(list.packets[n].data[b]);
+		fifo_commit_packet();
+		nmea_process_packet();
+		fifo_remove_packet();
+	}
+
+	if (stats) {
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+		double duration = (double) samples / in.rate;
+		fprintf(stderr, "%u Hz, %u channels of %u Hz, A in bin %d, B in bin %d\n",
+				in.rate, branches, CHAN_SPACING, bins[0], bins[1]);
+		fprintf(stderr, "%" PRIu64 " samples (%.1f s), %.2f s processing, %.0fx realtime\n",
+				samples, duration, seconds, seconds > 0 ? duration / seconds : 0);
+		fprintf(stderr, "zero-hop: %zu packets on A, %zu on B, %zu total\n", received[0], received[1], list.count);
+		if (hop)
+			fprintf(stderr, "hopping: %zu packets, %.1f%% lost\n", hop_received,
+					list.count ? 100.0 * (list.count - (double) hop_received) / list.count : 0);
+	}
+
+	for (k = 0; k < CHAN_COUNT; k++) {
+		demod_free(&chans[k].demod);
+		free(chans[k].out_i[0]);
+		free(chans[k].out_q[0]);
+		free(chans[k].out_i[1]);
+		free(chans[k].out_q[1]);
+		free(chans[k].bits);
+		free(chans[k].list.packets);
+	}
+	pthread_barrier_destroy(&chan_sync);
+	pfb_free(&pfb);
+	free(list.packets);
+	free(buf_i);
+	free(buf_q);
+	if (in.file != stdin)
+		fclose(in.file);
+
+	return 0;
+}
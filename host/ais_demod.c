@@ -0,0 +1,177 @@
+/*
+ * AIS demodulator for recorded IQ or discriminator audio files, output is NMEA on stdout
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Reads WAV (16 bit PCM or 32 bit float) or raw samples (u8, s16, f32), demodulates with the
+ * reference demodulator and decodes with the firmware packet handler and NMEA encoder.
+ * Stereo WAV and raw files are treated as interleaved I/Q, mono WAV as discriminator audio.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "nmea.h"
+#include "packet_handler.h"
+#include "ph_host.h"
+#include "dsp.h"
+#include "demod.h"
+#include "sample_file.h"
+#include "bit_capture.h"
+
+#define DEMOD_TARGET_RATE	48000		// IQ input is decimated to approx. this rate in the channel filter
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options] [file]\n"
+		"  -f format       wav, u8, s16 or f32 (default wav, raw formats need -r)\n"
+		"  -m mode         iq or audio, for raw formats (default iq)\n"
+		"  -r rate         sample rate in Hz of raw formats\n"
+		"  -o Hz           frequency of AIS channel in IQ capture, shifted to 0 Hz (default 0)\n"
+		"  -c channel      channel label A or B in NMEA output (default A)\n"
+		"  -w file         record demodulated bits as indexed capture\n"
+		"  -s              print statistics to stderr\n"
+		"reads stdin if no file is given\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+	struct sample_file_s in = { stdin, SAMPLE_FORMAT_WAV, 2, 0 };
+	uint8_t audio = 0;
+	float offset = 0;
+	uint8_t channel = 0;
+	uint8_t stats = 0;
+	const char* record = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:m:r:o:c:w:sh")) != -1) {
+		switch (opt) {
+		case 'f':
+			if ((opt = sample_file_format(optarg)) < 0) {
+				usage(argv[0]);
+				return 2;
+			}
+			in.format = opt;
+			break;
+		case 'm': audio = !strcmp(optarg, "audio"); break;
+		case 'r': in.rate = atoi(optarg); break;
+		case 'o': offset = atof(optarg); break;
+		case 'c': channel = (optarg[0] == 'B' || optarg[0] == 'b'); break;
+		case 'w': record = optarg; break;
+		case 's': stats = 1; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind < argc && !(in.file = fopen(argv[optind], "rb"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (in.format == SAMPLE_FORMAT_WAV) {
+		if (sample_file_open(&in)) {
+			fprintf(stderr, "unsupported WAV file, need 16 bit PCM or 32 bit float, mono or stereo\n");
+			return 1;
+		}
+		audio = (in.channels == 1);
+	} else {
+		in.channels = audio ? 1 : 2;
+		sample_file_open(&in);
+	}
+
+	if (in.rate < 4 * DSP_AIS_BAUD) {
+		fprintf(stderr, "sample rate must be at least %u Hz\n", 4 * DSP_AIS_BAUD);
+		usage(argv[0]);
+		return 2;
+	}
+
+	float* buf_a = malloc(DSP_BLOCK * sizeof(float));
+	float* buf_b = malloc(DSP_BLOCK * sizeof(float));
+	uint8_t* bits = malloc(DSP_BLOCK);
+	struct demod_s demod;
+	struct mix_s mix;
+	uint16_t decim = 1;
+
+	if (audio) {
+		demod_init_audio(&demod, in.rate);
+	} else {
+		decim = in.rate / DEMOD_TARGET_RATE;
+		if (decim < 1)
+			decim = 1;
+		demod_init(&demod, in.rate, decim);
+		mix_init(&mix, -offset / in.rate);
+	}
+
+	struct bit_capture_writer_s writer;
+	if (record && bit_capture_create(&writer, record, 0, channel)) {
+		perror(record);
+		return 1;
+	}
+
+	ph_host_start(channel);
+
+	uint64_t samples = 0, total_bits = 0, packets = 0;
+	clock_t start = clock();
+	size_t count;
+
+	while ((count = sample_file_read(&in, buf_a, buf_b, DSP_BLOCK)) != 0) {
+		size_t n, nbits;
+
+		if (audio) {
+			nbits = demod_audio(&demod, buf_a, count, bits);
+		} else {
+			if (offset != 0) {
+				for (n = count; n % DSP_VEC_LEN; n++)		// pad last block for mixer
+					buf_a[n] = buf_b[n] = 0;
+				mix_process(&mix, buf_a, buf_b, n);
+			}
+			nbits = demod_iq(&demod, buf_a, buf_b, count, bits);
+		}
+
+		for (n = 0; n < nbits; n++)
+			ph_host_bit(bits[n]);
+		if (record)
+			for (n = 0; n < nbits; n++)
+				bit_capture_write(&writer, bits[n]);		// same bits as presented to ph_irq_handler
+
+		while (fifo_get_packet()) {
+			nmea_process_packet();						// NMEA sentence(s) through UART, i.e. stdout
+			fifo_remove_packet();
+			packets++;
+		}
+
+		samples += count;
+		total_bits += nbits;
+	}
+
+	if (stats) {
+		double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+		double duration = (double) samples / in.rate;
+		fprintf(stderr, "%s input, %u Hz, decimation %u\n", audio ? "audio" : "IQ", in.rate, decim);
+		fprintf(stderr, "%" PRIu64 " samples (%.1f s), %" PRIu64 " bits, %" PRIu64 " packets\n",
+				samples, duration, total_bits, packets);
+		fprintf(stderr, "%.2f s processing, %.0fx realtime\n", seconds, seconds > 0 ? duration / seconds : 0);
+	}
+
+	if (record && bit_capture_finish(&writer))
+		perror(record);
+
+	demod_free(&demod);
+	free(buf_a);
+	free(buf_b);
+	free(bits);
+	if (in.file != stdin)
+		fclose(in.file);
+
+	return 0;
+}
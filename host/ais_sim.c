@@ -0,0 +1,353 @@
+/*
+ * GMSK baseband simulator measuring packet error rate of the dAISy decoder vs Eb/N0
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Random AIS packets are framed and GMSK modulated (9600 sps, 2400 Hz deviation as configured
+ * in radio_config.h), passed through a channel with multipath, frequency offset and AWGN,
+ * demodulated by the reference demodulator and decoded by the firmware packet handler.
+ *
+ * The radio's RSSI is emulated from the power in the channel filter bandwidth, averaged over
+ * SIM_RSSI_BITS bits and scaled so that noise alone reads the noise floor given with -N. With a
+ * fixed (-t) or adaptive (-c) RSSI threshold, the packet handler aborts when the emulated CCA pin
+ * drops, which shows how many false syncs on noise a threshold avoids and what it costs.
+ *
+ * With -x, the crystal pulls the carrier offset by the given Hz per step of XO_TUNE away from
+ * RADIO_XO_TUNE_DEFAULT, and the modem reports the offset as AFC value with some estimation noise.
+ * This shows how the packet handler's crystal calibration converges, a negative value reverses the
+ * direction the firmware assumes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "radio.h"
+#include "packet_handler.h"
+#include "ph_host.h"
+#include "radio_mock.h"
+#include "dsp.h"
+#include "demod.h"
+#include "ais_tx.h"
+
+#define SIM_MAX_GUARDS		16
+#define SIM_IDLE_MIN		32			// min. symbols of noise between packets
+#define SIM_IDLE_RANDOM		32			// random additional symbols of noise between packets
+#define SIM_TAIL			16			// symbols of noise after packet to flush filters
+#define SIM_RSSI_CUTOFF		9000.0f		// bandwidth of RSSI measurement, same as channel filter of demodulator
+#define SIM_RSSI_BITS		4			// RSSI is averaged over this many bits
+#define SIM_RSSI_DELAY		2			// bits demodulator output lags behind, RSSI is delayed to match
+#define SIM_AFC_NOISE		100.0f		// standard deviation of AFC offset reported by modem in Hz
+
+struct guard_s {
+	float ebn0;
+	float max_per;
+};
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+// xorshift64*
+static uint32_t rng_next(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (uint32_t) ((rng_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static float rng_uniform(void)
+{
+	return (rng_next() + 0.5f) / 4294967296.0f;
+}
+
+// Box-Muller, standard deviation 1
+static float rng_gauss(void)
+{
+	return sqrtf(-2 * logf(rng_uniform())) * cosf(2 * (float) M_PI * rng_uniform());
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n count        packets per Eb/N0 point (default 500)\n"
+		"  -s dB           first Eb/N0 point (default 0)\n"
+		"  -e dB           last Eb/N0 point (default 16)\n"
+		"  -d dB           Eb/N0 step (default 1)\n"
+		"  -r rate         sample rate in Hz, multiple of 9600 (default 48000)\n"
+		"  -b bt           Gaussian filter BT of transmitter (default 0.4)\n"
+		"  -l bytes        AIS payload length (default 21, message type 1)\n"
+		"  -f Hz           carrier frequency offset (default 0)\n"
+		"  -m us,dB        multipath echo delay and gain relative to direct path (default none)\n"
+		"  -g dB,per       guard: fail if PER at Eb/N0 exceeds per, can be repeated\n"
+		"  -N dBm          noise floor read by RSSI (default -110)\n"
+		"  -t dBm          fixed RSSI threshold, like TUNE RSSI (default 0, off)\n"
+		"  -c dB           adaptive RSSI threshold above noise floor, like TUNE MARGIN (default 0, off)\n"
+		"  -x Hz           offset per XO_TUNE step, calibrates crystal like TUNE XO AUTO (default 0, off)\n"
+		"  -S seed         random seed\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t packets = 500;
+	float ebn0_start = 0, ebn0_end = 16, ebn0_step = 1;
+	uint32_t rate = 48000;
+	float bt = 0.4f;
+	uint16_t size = 21;
+	float offset = 0;
+	float echo_us = 0, echo_db = -200;
+	struct guard_s guards[SIM_MAX_GUARDS];
+	uint8_t guard_count = 0;
+	uint8_t failed = 0;
+	float noise_dbm = -110;
+	int threshold = 0, margin = 0;
+	float xo_step = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:e:d:r:b:l:f:m:g:N:t:c:x:S:h")) != -1) {
+		switch (opt) {
+		case 'n': packets = atoi(optarg); break;
+		case 's': ebn0_start = atof(optarg); break;
+		case 'e': ebn0_end = atof(optarg); break;
+		case 'd': ebn0_step = atof(optarg); break;
+		case 'r': rate = atoi(optarg); break;
+		case 'b': bt = atof(optarg); break;
+		case 'l': size = atoi(optarg); break;
+		case 'f': offset = atof(optarg); break;
+		case 'm':
+			if (sscanf(optarg, "%f,%f", &echo_us, &echo_db) != 2) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'g':
+			if (guard_count == SIM_MAX_GUARDS || sscanf(optarg, "%f,%f", &guards[guard_count].ebn0, &guards[guard_count].max_per) != 2) {
+				usage(argv[0]);
+				return 2;
+			}
+			guard_count++;
+			break;
+		case 'N': noise_dbm = atof(optarg); break;
+		case 't': threshold = atoi(optarg); break;
+		case 'c': margin = atoi(optarg); break;
+		case 'x': xo_step = atof(optarg); break;
+		case 'S': rng_state ^= strtoull(optarg, 0, 0) * 0x9e3779b97f4a7c15ULL; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (rate % DSP_AIS_BAUD || rate < 4 * DSP_AIS_BAUD || size < 1 || size > 125 || ebn0_step <= 0
+			|| threshold > 0 || threshold < -127 || margin < 0 || margin > 40) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	uint16_t sps = rate / DSP_AIS_BAUD;
+	uint32_t echo_delay = (uint32_t) (echo_us * 1e-6f * rate + 0.5f);
+	float echo_gain = powf(10, echo_db / 20);
+	size_t max_symbols = SIM_IDLE_MIN + SIM_IDLE_RANDOM + AIS_TX_MAX_BITS(size) + SIM_TAIL;
+	size_t max_samples = max_symbols * sps + echo_delay;
+
+	uint8_t* payload = malloc(size);
+	uint8_t* levels = malloc(max_symbols);
+	uint8_t* bits = malloc(max_samples);
+	float* tx_i = calloc(max_samples, sizeof(float));
+	float* tx_q = calloc(max_samples, sizeof(float));
+	float* rx_i = malloc(max_samples * sizeof(float));
+	float* rx_q = malloc(max_samples * sizeof(float));
+	float* power = malloc(max_samples * sizeof(float));
+	uint8_t* rssi = calloc(max_samples / sps + 2 + SIM_RSSI_DELAY, 1);
+
+	struct gmsk_s gmsk;
+	gmsk_init(&gmsk, sps, bt);
+
+	// RSSI: power in channel bandwidth, noise alone reads noise_dbm
+	float rssi_taps[255];
+	uint16_t rssi_ntaps = ((uint16_t) (rate / 1000) | 1);
+	float rssi_gain = 0;
+	uint16_t k;
+	if (rssi_ntaps > 255)
+		rssi_ntaps = 255;
+	fir_design_lowpass(rssi_taps, rssi_ntaps, SIM_RSSI_CUTOFF / rate);
+	for (k = 0; k < rssi_ntaps; k++)
+		rssi_gain += rssi_taps[k] * rssi_taps[k];		// noise power gain of filter
+	struct fir_s rssi_i, rssi_q;
+	fir_init(&rssi_i, rssi_taps, rssi_ntaps, 1);
+	fir_init(&rssi_q, rssi_taps, rssi_ntaps, 1);
+
+	ph_set_tuning(PH_PREAMBLE_LENGTH, PH_SYNC_TIMEOUT, threshold, margin);
+	ph_set_xo_tune(RADIO_XO_TUNE_DEFAULT, xo_step != 0);
+
+	printf("# dAISy packet error rate, %u sps, BT %.2f, %u byte payload, offset %.0f Hz", sps, bt, size, offset);
+	if (echo_delay)
+		printf(", echo %.1f us %.1f dB", echo_us, echo_db);
+	if (threshold || margin)
+		printf(", noise %.0f dBm, RSSI threshold %d dBm, margin %d dB", noise_dbm, threshold, margin);
+	if (xo_step)
+		printf(", crystal %.0f Hz per XO_TUNE step", xo_step);
+	printf("\nebn0_db,packets,received,crc_errors,stuff_errors,noend_errors,per,false_syncs,rssi_drops,noise_floor_dbm,rssi_dbm,fade_db,quality_db,xo_tune,offset_hz\n");
+
+	float ebn0;
+	for (ebn0 = ebn0_start; ebn0 <= ebn0_end + ebn0_step / 2; ebn0 += ebn0_step) {
+		float sigma = sqrtf(sps / powf(10, ebn0 / 10) / 2);	// noise per component, signal power 1, Es = Eb
+		float noise_power = 2 * sigma * sigma * rssi_gain;	// in channel bandwidth
+		float history[SIM_RSSI_BITS] = { 0 };				// power of last bits
+		float sum = 0, acc = 0;
+		uint16_t acc_count = 0;
+		uint8_t h = 0;
+		uint32_t syncs = 0;
+		uint8_t state = PH_STATE_OFF;
+		uint32_t received = 0;
+		int32_t rssi_sum = 0, fade_sum = 0, quality_sum = 0;	// signal strength of received packets
+		uint32_t errors[PH_ERROR_RSSI_DROP + 1] = { 0 };
+		uint64_t t = 0;										// sample counter for frequency offset
+		uint8_t level = 0;
+		struct demod_s demod;
+		uint32_t p;
+
+		demod_init(&demod, rate, 1);
+		ph_host_start(0);
+
+		for (p = 0; p < packets; p++) {
+			size_t idle = SIM_IDLE_MIN + rng_next() % SIM_IDLE_RANDOM;
+			size_t frame, symbols, samples, n;
+			uint16_t k;
+
+			for (k = 0; k < size; k++)
+				payload[k] = rng_next();
+
+			// transmitter: one packet framed by silence
+			frame = ais_tx_frame(levels, &level, payload, size);
+			symbols = idle + frame + SIM_TAIL;
+			samples = symbols * sps + echo_delay;
+			memset(tx_i, 0, samples * sizeof(float));
+			memset(tx_q, 0, samples * sizeof(float));
+			gmsk_modulate(&gmsk, levels, frame, tx_i + idle * sps, tx_q + idle * sps);
+
+			// channel: multipath echo, frequency offset incl. crystal calibration, AWGN
+			float carrier = offset + ((int) radio_mock[0].xo_tune - RADIO_XO_TUNE_DEFAULT) * xo_step;
+			if (xo_step) {
+				int16_t afc = RADIO_HZ_TO_AFC(carrier + SIM_AFC_NOISE * rng_gauss());
+				radio_mock[0].modem_status.afc_freq_offset_msb = afc >> 8;
+				radio_mock[0].modem_status.afc_freq_offset_lsb = afc & 0xff;
+			}
+			float echo_phase = 2 * (float) M_PI * rng_uniform();
+			float echo_i = echo_gain * cosf(echo_phase);
+			float echo_q = echo_gain * sinf(echo_phase);
+			for (n = 0; n < samples; n++, t++) {
+				float si = tx_i[n], sq = tx_q[n];
+				if (n >= echo_delay && echo_delay) {
+					float di = tx_i[n - echo_delay], dq = tx_q[n - echo_delay];
+					si += di * echo_i - dq * echo_q;
+					sq += di * echo_q + dq * echo_i;
+				}
+				float w = 2 * (float) M_PI * carrier * (float) (t % rate) / rate;
+				float c = cosf(w), s = sinf(w);
+				rx_i[n] = si * c - sq * s + sigma * rng_gauss();
+				rx_q[n] = si * s + sq * c + sigma * rng_gauss();
+			}
+
+			// receiver: reference demodulator
+			size_t count = demod_iq(&demod, rx_i, rx_q, samples, bits);
+
+			// RSSI per bit, averaged over last SIM_RSSI_BITS bits, in register units (0.5dB)
+			size_t nrssi = SIM_RSSI_DELAY, m;					// last bits of previous packet come first
+			for (n = 0; n < samples; n += m) {
+				size_t j;
+				m = samples - n > DSP_BLOCK ? DSP_BLOCK : samples - n;
+				fir_process(&rssi_i, rx_i + n, m, power + n);
+				fir_process(&rssi_q, rx_q + n, m, rx_q + n);	// demodulator is done with rx
+				for (j = 0; j < m; j++)
+					power[n + j] = power[n + j] * power[n + j] + rx_q[n + j] * rx_q[n + j];
+			}
+			for (n = 0; n < samples; n++) {
+				acc += power[n];
+				if (++acc_count == sps) {
+					float value;
+					sum += acc / sps - history[h];
+					history[h] = acc / sps;
+					h = (h + 1) % SIM_RSSI_BITS;
+					value = 2 * (noise_dbm + 10 * log10f(fmaxf(sum / SIM_RSSI_BITS, 1e-12f) / noise_power) + 0x40 + 70);	// RADIO_DBM_TO_RSSI
+					rssi[nrssi++] = value < 0 ? 0 : (value > 255 ? 255 : (uint8_t) (value + 0.5f));
+					acc = 0;
+					acc_count = 0;
+				}
+			}
+
+			// firmware packet handler, RSSI of bit is presented with it
+			for (n = 0; n < count; n++) {
+				radio_mock_rssi(0, rssi[n < nrssi ? n : nrssi - 1]);
+				ph_host_bit(bits[n]);
+				errors[ph_get_last_error()]++;
+				if (ph_get_state() == PH_STATE_PREFETCH && state != PH_STATE_PREFETCH)
+					syncs++;
+				state = ph_get_state();
+			}
+			memmove(rssi, rssi + nrssi - SIM_RSSI_DELAY, SIM_RSSI_DELAY);
+
+
+			// collect decoded packets, FIFO holds channel, payload and CRC
+			uint16_t packet_size;
+			while ((packet_size = fifo_get_packet()) != 0) {
+				if (packet_size == size + 3) {
+					struct ph_packet_info_s info;
+					fifo_read_byte();
+					for (k = 0; k < size; k++)
+						if (fifo_read_byte() != payload[k])
+							break;
+					if (k == size) {
+						received++;
+						ph_get_packet_info(&info);
+						ph_xo_step();					// like housekeeping
+						rssi_sum += info.rssi;
+						fade_sum += info.rssi - info.rssi_min;
+						quality_sum += info.quality;
+					}
+				}
+				fifo_remove_packet();
+			}
+		}
+
+		demod_free(&demod);
+
+		float per = 1 - (float) received / packets;
+		float r = received ? received : 1;
+		printf("%.1f,%u,%u,%u,%u,%u,%.4f,%u,%u,%d,%.1f,%.1f,%.1f,%u,%.0f\n", ebn0, packets, received,
+				errors[PH_ERROR_CRC], errors[PH_ERROR_STUFFBIT], errors[PH_ERROR_NOEND], per,
+				syncs - received, errors[PH_ERROR_RSSI_DROP], ph_get_noise_floor(0),
+				rssi_sum / r, fade_sum / r, quality_sum / r,
+				radio_mock[0].xo_tune, offset + ((int) radio_mock[0].xo_tune - RADIO_XO_TUNE_DEFAULT) * xo_step);
+		fflush(stdout);
+
+		uint8_t g;
+		for (g = 0; g < guard_count; g++) {
+			if (fabsf(guards[g].ebn0 - ebn0) < ebn0_step / 2 && per > guards[g].max_per) {
+				fprintf(stderr, "regression: PER %.4f at %.1f dB exceeds %.4f\n", per, ebn0, guards[g].max_per);
+				failed = 1;
+			}
+		}
+	}
+
+	gmsk_free(&gmsk);
+	free(payload);
+	free(levels);
+	free(bits);
+	free(tx_i);
+	free(tx_q);
+	free(rx_i);
+	free(rx_q);
+	free(power);
+	free(rssi);
+	fir_free(&rssi_i);
+	fir_free(&rssi_q);
+
+	return failed;
+}
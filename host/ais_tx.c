@@ -0,0 +1,129 @@
+/*
+ * AIS transmit side for host tools: HDLC framing, NRZI encoding and GMSK modulation
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "dsp.h"
+#include "ais_tx.h"
+
+#define AIS_SYNC_WORD		0x7e
+
+struct frame_s {
+	uint8_t* levels;
+	uint8_t level;
+	uint16_t count;
+	uint8_t one_count;
+};
+
+// NRZI: toggle line for sending 0, keep state for sending 1
+static void frame_bit(struct frame_s* f, uint8_t bit)
+{
+	if (bit == 0)
+		f->level ^= 1;
+	f->levels[f->count++] = f->level;
+}
+
+// send bit, stuff with 0 after five consecutive 1's
+static void frame_stuffed_bit(struct frame_s* f, uint8_t bit)
+{
+	frame_bit(f, bit);
+	if (bit) {
+		if (++f->one_count == 5) {
+			frame_bit(f, 0);
+			f->one_count = 0;
+		}
+	} else
+		f->one_count = 0;
+}
+
+uint16_t ais_tx_frame(uint8_t* levels, uint8_t* level, const uint8_t* payload, uint16_t size)
+{
+	struct frame_s f = { levels, *level, 0, 0 };
+	uint16_t crc = 0xffff;
+	uint16_t i;
+	uint8_t b;
+
+	// preamble of alternating bits
+	for (i = 0; i < AIS_TX_PREAMBLE; i++)
+		frame_bit(&f, i & 1);
+
+	// start flag, LSB first
+	for (b = 0; b < 8; b++)
+		frame_bit(&f, (AIS_SYNC_WORD >> b) & 1);
+
+	// payload, each byte LSB first, same bit order as packet handler stores in FIFO
+	for (i = 0; i < size; i++) {
+		for (b = 0; b < 8; b++) {
+			uint8_t bit = (payload[i] >> b) & 1;
+			if (bit ^ (crc & 0x0001))				// CCITT CRC calculation (according to Dr. Dobbs)
+				crc = (crc >> 1) ^ 0x8408;
+			else
+				crc >>= 1;
+			frame_stuffed_bit(&f, bit);
+		}
+	}
+
+	// CRC, LSB first
+	crc = ~crc;
+	for (b = 0; b < 16; b++)
+		frame_stuffed_bit(&f, (crc >> b) & 1);
+
+	// end flag
+	for (b = 0; b < 8; b++)
+		frame_bit(&f, (AIS_SYNC_WORD >> b) & 1);
+
+	*level = f.level;
+	return f.count;
+}
+
+void gmsk_init(struct gmsk_s* gmsk, uint16_t sps, float bt)
+{
+	gmsk->sps = sps;
+	gmsk->ntaps = sps * 4 + 1;						// Gaussian pulse spans 4 symbols
+	gmsk->taps = malloc(gmsk->ntaps * sizeof(float));
+	gmsk->phase = 0;
+	fir_design_gaussian(gmsk->taps, gmsk->ntaps, bt, sps);
+}
+
+void gmsk_free(struct gmsk_s* gmsk)
+{
+	free(gmsk->taps);
+	gmsk->taps = 0;
+}
+
+void gmsk_modulate(struct gmsk_s* gmsk, const uint8_t* levels, size_t count, float* i, float* q)
+{
+	uint16_t sps = (uint16_t) gmsk->sps;
+	size_t total = count * sps;
+	int32_t half = gmsk->ntaps / 2;
+	float step = (float) M_PI * 2 * DSP_AIS_FDEV / (DSP_AIS_BAUD * gmsk->sps);	// phase change per sample at full deviation
+	size_t n;
+	uint16_t t;
+
+	for (n = 0; n < total; n++) {
+		// Gaussian filtered NRZ, levels before and after frame are extended
+		float freq = 0;
+		for (t = 0; t < gmsk->ntaps; t++) {
+			int64_t k = (int64_t) n - half + t;
+			size_t symbol = k < 0 ? 0 : (size_t) k / sps;
+			if (symbol >= count)
+				symbol = count - 1;
+			freq += gmsk->taps[t] * (levels[symbol] ? 1.0f : -1.0f);
+		}
+
+		gmsk->phase += freq * step;
+		if (gmsk->phase > M_PI)
+			gmsk->phase -= 2 * M_PI;
+		else if (gmsk->phase < -M_PI)
+			gmsk->phase += 2 * M_PI;
+
+		i[n] = cosf(gmsk->phase);
+		q[n] = sinf(gmsk->phase);
+	}
+}
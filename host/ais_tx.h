@@ -0,0 +1,34 @@
+/*
+ * AIS transmit side for host tools: HDLC framing, NRZI encoding and GMSK modulation
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#ifndef AIS_TX_H_
+#define AIS_TX_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define AIS_TX_PREAMBLE		24				// preamble length in bits
+#define AIS_TX_MAX_BITS(size)	(AIS_TX_PREAMBLE + 8 + ((size) * 8 + 16) * 6 / 5 + 1 + 8)	// worst case frame length
+
+// encode payload into frame of raw DATA pin levels: preamble, start flag, stuffed payload and CRC, end flag
+// level holds the NRZI line state between frames, returns number of bits written to levels
+uint16_t ais_tx_frame(uint8_t* levels, uint8_t* level, const uint8_t* payload, uint16_t size);
+
+// GMSK modulator, constant envelope complex baseband
+struct gmsk_s {
+	float sps;							// samples per symbol
+	uint16_t ntaps;						// length of Gaussian filter
+	float* taps;						// Gaussian filter
+	float phase;						// carrier phase
+};
+
+void gmsk_init(struct gmsk_s* gmsk, uint16_t sps, float bt);
+void gmsk_free(struct gmsk_s* gmsk);
+void gmsk_modulate(struct gmsk_s* gmsk, const uint8_t* levels, size_t count, float* i, float* q);	// writes count * sps samples
+
+#endif /* AIS_TX_H_ */
@@ -0,0 +1,287 @@
+/*
+ * Indexed capture files of raw demodulator bits, i.e. what the radio's DATA pin delivered
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bit_capture.h"
+
+#define BIT_CAPTURE_GROW		(1 << 20)	// minimum growth of writer mapping in bytes
+
+int bit_capture_is_capture(const void* data, size_t size)
+{
+	return size >= sizeof(struct bit_capture_header_s) && !memcmp(data, BIT_CAPTURE_MAGIC, 8);
+}
+
+int bit_capture_open(struct bit_capture_s* cap, const char* name)
+{
+	const struct bit_capture_header_s* h;
+	struct stat st;
+	void* map;
+	int fd;
+
+	memset(cap, 0, sizeof(*cap));
+	if ((fd = open(name, O_RDONLY)) < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || st.st_size < BIT_CAPTURE_DATA_OFFSET) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	h = map;
+	cap->size = st.st_size;
+	if (!bit_capture_is_capture(map, cap->size) || h->version != BIT_CAPTURE_VERSION
+			|| h->data_offset + (h->bit_count + 7) / 8 > cap->size
+			|| h->mark_offset + h->mark_count * sizeof(struct bit_capture_mark_s) > cap->size
+			|| h->sync_offset + h->sync_count * sizeof(struct bit_capture_sync_s) > cap->size) {
+		munmap(map, cap->size);
+		cap->size = 0;
+		return -1;
+	}
+
+	cap->header = h;
+	cap->bits = (const uint8_t*) map + h->data_offset;
+	cap->marks = (const struct bit_capture_mark_s*) ((const uint8_t*) map + h->mark_offset);
+	cap->syncs = (const struct bit_capture_sync_s*) ((const uint8_t*) map + h->sync_offset);
+	cap->bit_count = h->bit_count;
+	cap->mark_count = h->mark_count;
+	cap->sync_count = h->sync_count;
+	return 0;
+}
+
+void bit_capture_close(struct bit_capture_s* cap)
+{
+	if (cap->size)
+		munmap((void*) cap->header, cap->size);
+	memset(cap, 0, sizeof(*cap));
+}
+
+const struct bit_capture_mark_s* bit_capture_find_mark(const struct bit_capture_s* cap, uint64_t bit)
+{
+	size_t lo = 0, hi = cap->mark_count;
+
+	if (!hi)
+		return 0;
+	while (hi - lo > 1) {							// marks[lo].bit <= bit < marks[hi].bit
+		size_t mid = (lo + hi) / 2;
+		if (cap->marks[mid].bit <= bit)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return &cap->marks[lo];
+}
+
+const struct bit_capture_sync_s* bit_capture_find_sync(const struct bit_capture_s* cap, uint64_t bit)
+{
+	size_t lo = 0, hi = cap->sync_count;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (cap->syncs[mid].sync < bit)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < cap->sync_count ? &cap->syncs[lo] : 0;
+}
+
+uint64_t bit_capture_time(const struct bit_capture_s* cap, uint64_t bit)
+{
+	const struct bit_capture_mark_s* mark = bit_capture_find_mark(cap, bit);
+	uint64_t base = mark ? mark->time : cap->header->start_time;
+	uint64_t offset = mark ? bit - mark->bit : bit;
+
+	return base + offset * 1000000 / cap->header->bit_rate;
+}
+
+void bit_capture_seek(const struct bit_capture_s* cap, const struct bit_capture_sync_s* sync, struct ph_context_s* ctx, struct fifo_s* fifo)
+{
+	fifo_ctx_reset(fifo);
+	ph_context_init(ctx, fifo, sync->channel);
+	if (sync->start)
+		ctx->rx_prev_bit_NRZI = bit_capture_level(cap, sync->start - 1);	// state after reset only depends on previous bit
+}
+
+// writer
+
+static int writer_reserve(struct bit_capture_writer_s* w, size_t size)
+{
+	size_t capacity = w->capacity;
+
+	if (size <= capacity)
+		return 0;
+	while (capacity < size)
+		capacity += capacity > BIT_CAPTURE_GROW ? capacity : BIT_CAPTURE_GROW;
+	if (ftruncate(w->fd, capacity) < 0)
+		return -1;
+	if (w->map)
+		munmap(w->map, w->capacity);
+	w->map = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+	if (w->map == MAP_FAILED) {
+		w->map = 0;
+		w->capacity = 0;
+		return -1;
+	}
+	w->capacity = capacity;
+	return 0;
+}
+
+static void writer_add_mark(struct bit_capture_writer_s* w, uint8_t type, uint8_t channel, uint64_t time)
+{
+	struct bit_capture_mark_s* mark;
+
+	if (w->mark_count == w->mark_capacity) {
+		w->mark_capacity = w->mark_capacity * 2 + 16;
+		w->marks = realloc(w->marks, w->mark_capacity * sizeof(struct bit_capture_mark_s));
+	}
+	mark = &w->marks[w->mark_count++];
+	memset(mark, 0, sizeof(*mark));
+	mark->bit = w->bit_count;
+	mark->time = time;
+	mark->type = type;
+	mark->channel = channel;
+}
+
+// time of next bit extrapolated from last mark
+static uint64_t writer_time(const struct bit_capture_writer_s* w)
+{
+	const struct bit_capture_mark_s* mark = &w->marks[w->mark_count - 1];
+	return mark->time + (w->bit_count - mark->bit) * 1000000 / BIT_CAPTURE_RATE;
+}
+
+int bit_capture_create(struct bit_capture_writer_s* w, const char* name, uint64_t start_time, uint8_t channel)
+{
+	memset(w, 0, sizeof(*w));
+	if ((w->fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+		return -1;
+	if (writer_reserve(w, BIT_CAPTURE_DATA_OFFSET + BIT_CAPTURE_GROW)) {
+		close(w->fd);
+		return -1;
+	}
+	memset(w->map, 0, BIT_CAPTURE_DATA_OFFSET);
+	w->start_time = start_time;
+	writer_add_mark(w, BIT_CAPTURE_MARK_START, channel, start_time);
+	fifo_ctx_reset(&w->fifo);
+	ph_context_init(&w->ph, &w->fifo, channel);
+	return 0;
+}
+
+void bit_capture_write(struct bit_capture_writer_s* w, uint8_t level)
+{
+	uint64_t n = w->bit_count;
+	uint8_t* byte;
+	uint8_t events;
+
+	if (BIT_CAPTURE_DATA_OFFSET + n / 8 >= w->capacity && writer_reserve(w, BIT_CAPTURE_DATA_OFFSET + n / 8 + 1))
+		return;											// out of disk space, drop bits
+
+	byte = w->map + BIT_CAPTURE_DATA_OFFSET + n / 8;
+	if ((n & 7) == 0)
+		*byte = 0;
+	if (level)
+		*byte |= 0x80 >> (n & 7);
+	w->bit_count++;
+
+	// index packets
+	events = ph_process_bit(&w->ph, level);
+	if (events & PH_EVENT_SYNC) {
+		struct bit_capture_sync_s* sync;
+		if (w->sync_count == w->sync_capacity) {
+			w->sync_capacity = w->sync_capacity * 2 + 256;
+			w->syncs = realloc(w->syncs, w->sync_capacity * sizeof(struct bit_capture_sync_s));
+		}
+		sync = &w->syncs[w->sync_count++];
+		memset(sync, 0, sizeof(*sync));
+		sync->start = w->ph_start;
+		sync->sync = n;
+		sync->channel = w->ph.radio_channel;
+		w->ph.last_error = PH_ERROR_NONE;
+		w->ph_synced = 1;
+	}
+	if (events & PH_EVENT_RESET) {
+		if (w->ph_synced) {
+			w->syncs[w->sync_count - 1].end = n;
+			w->syncs[w->sync_count - 1].error = w->ph.last_error;
+			w->ph_synced = 0;
+		}
+		fifo_ctx_reset(&w->fifo);					// only the index is of interest
+		w->ph_start = n + 1;
+	}
+}
+
+void bit_capture_hop(struct bit_capture_writer_s* w, uint8_t channel)
+{
+	writer_add_mark(w, BIT_CAPTURE_MARK_HOP, channel, writer_time(w));
+	w->ph.radio_channel = channel;
+}
+
+void bit_capture_mark_time(struct bit_capture_writer_s* w, uint64_t time)
+{
+	writer_add_mark(w, BIT_CAPTURE_MARK_TIME, w->marks[w->mark_count - 1].channel, time);
+}
+
+void bit_capture_mark_gap(struct bit_capture_writer_s* w)
+{
+	writer_add_mark(w, BIT_CAPTURE_MARK_GAP, w->marks[w->mark_count - 1].channel, writer_time(w));
+}
+
+int bit_capture_finish(struct bit_capture_writer_s* w)
+{
+	struct bit_capture_header_s h;
+	size_t mark_size = w->mark_count * sizeof(struct bit_capture_mark_s);
+	size_t sync_size;
+	int result = 0;
+
+	if (w->ph_synced)								// packet cut off by end of capture
+		w->syncs[--w->sync_count].end = 0;
+	sync_size = w->sync_count * sizeof(struct bit_capture_sync_s);
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, BIT_CAPTURE_MAGIC, 8);
+	h.version = BIT_CAPTURE_VERSION;
+	h.header_size = sizeof(h);
+	h.bit_rate = BIT_CAPTURE_RATE;
+	h.start_time = w->start_time;
+	h.bit_count = w->bit_count;
+	h.data_offset = BIT_CAPTURE_DATA_OFFSET;
+	h.mark_offset = (BIT_CAPTURE_DATA_OFFSET + (w->bit_count + 7) / 8 + 7) & ~7ULL;
+	h.mark_count = w->mark_count;
+	h.sync_offset = h.mark_offset + mark_size;
+	h.sync_count = w->sync_count;
+
+	if (w->map && !writer_reserve(w, h.sync_offset + sync_size)) {
+		memcpy(w->map + h.mark_offset, w->marks, mark_size);
+		memcpy(w->map + h.sync_offset, w->syncs, sync_size);
+		memcpy(w->map, &h, sizeof(h));					// header last, a crashed writer leaves bit_count 0
+		munmap(w->map, w->capacity);
+		if (ftruncate(w->fd, h.sync_offset + sync_size) < 0)
+			result = -1;
+	} else {
+		if (w->map)
+			munmap(w->map, w->capacity);
+		result = -1;
+	}
+
+	close(w->fd);
+	free(w->marks);
+	free(w->syncs);
+	memset(w, 0, sizeof(*w));
+	w->fd = -1;
+	return result;
+}
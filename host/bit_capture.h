@@ -0,0 +1,125 @@
+/*
+ * Indexed capture files of raw demodulator bits, i.e. what the radio's DATA pin delivered
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Layout, all fields little endian:
+ *   header			struct bit_capture_header_s, padded to BIT_CAPTURE_DATA_OFFSET
+ *   bits			raw NRZI levels, 8 per byte MSB first, same as ais_batch input
+ *   marks			struct bit_capture_mark_s, channel and time at start, hops and time stamps
+ *   syncs			struct bit_capture_sync_s, one per start flag found by the packet handler
+ *
+ * Readers map the file and use bits, marks and syncs in place. The writer maps the file too and
+ * packs bits straight into it, marks and syncs are appended on close. Syncs are found by running
+ * the firmware packet handler over the written bits, so every source of bits gets an index.
+ */
+
+#ifndef BIT_CAPTURE_H_
+#define BIT_CAPTURE_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "packet_handler.h"
+
+#define BIT_CAPTURE_MAGIC		"dAISyRAW"
+#define BIT_CAPTURE_VERSION		1
+#define BIT_CAPTURE_DATA_OFFSET	4096		// bits start on a page
+#define BIT_CAPTURE_RATE		9600		// AIS bit rate
+
+struct bit_capture_header_s {
+	char magic[8];							// BIT_CAPTURE_MAGIC
+	uint16_t version;						// BIT_CAPTURE_VERSION
+	uint16_t header_size;					// sizeof(struct bit_capture_header_s)
+	uint32_t bit_rate;						// bits per second
+	uint64_t start_time;					// microseconds since 1970 of first bit, 0 if unknown
+	uint64_t bit_count;						// number of bits, 0 if writer didn't close file
+	uint64_t data_offset;					// file offsets of sections
+	uint64_t mark_offset;
+	uint64_t mark_count;
+	uint64_t sync_offset;
+	uint64_t sync_count;
+};
+
+enum BIT_CAPTURE_MARK {
+	BIT_CAPTURE_MARK_START = 0,				// first bit
+	BIT_CAPTURE_MARK_HOP,					// radio switched channel before this bit
+	BIT_CAPTURE_MARK_TIME,					// time stamp, e.g. after a gap in the capture
+	BIT_CAPTURE_MARK_GAP					// bits are missing before this bit, e.g. raw stream overflow
+};
+
+struct bit_capture_mark_s {
+	uint64_t bit;							// index of first bit the mark applies to
+	uint64_t time;							// microseconds since 1970 of that bit
+	uint8_t type;							// BIT_CAPTURE_MARK_x
+	uint8_t channel;						// radio channel from this bit on, 0=A, 1=B, ..
+	uint8_t reserved[6];
+};
+
+struct bit_capture_sync_s {
+	uint64_t start;							// a fresh decoder started on this bit reproduces the packet
+	uint64_t sync;							// bit completing the start flag, PH_EVENT_SYNC
+	uint64_t end;							// bit on which the state machine reset after the packet
+	uint8_t channel;						// radio channel of packet
+	uint8_t error;							// PH_ERROR_x, PH_ERROR_NONE for a valid packet
+	uint8_t reserved[6];
+};
+
+// reader, pointers refer to the mapped file
+struct bit_capture_s {
+	const struct bit_capture_header_s* header;
+	const uint8_t* bits;
+	const struct bit_capture_mark_s* marks;
+	const struct bit_capture_sync_s* syncs;
+	uint64_t bit_count;
+	size_t mark_count;
+	size_t sync_count;
+	size_t size;							// size of mapping
+};
+
+int bit_capture_is_capture(const void* data, size_t size);	// test for header
+int bit_capture_open(struct bit_capture_s* cap, const char* name);	// map file, returns 0 on success
+void bit_capture_close(struct bit_capture_s* cap);
+
+static inline uint8_t bit_capture_level(const struct bit_capture_s* cap, uint64_t bit)
+{
+	return (cap->bits[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+const struct bit_capture_mark_s* bit_capture_find_mark(const struct bit_capture_s* cap, uint64_t bit);	// last mark at or before bit
+const struct bit_capture_sync_s* bit_capture_find_sync(const struct bit_capture_s* cap, uint64_t bit);	// first sync at or after bit, 0 if none
+uint64_t bit_capture_time(const struct bit_capture_s* cap, uint64_t bit);	// microseconds since 1970 of bit
+
+// prepare ctx to decode the packet of sync, feed bits from sync->start through sync->end
+void bit_capture_seek(const struct bit_capture_s* cap, const struct bit_capture_sync_s* sync, struct ph_context_s* ctx, struct fifo_s* fifo);
+
+// writer
+struct bit_capture_writer_s {
+	int fd;
+	uint8_t* map;							// mapping of file, grows with capacity
+	size_t capacity;
+	uint64_t bit_count;
+	uint64_t start_time;
+	struct bit_capture_mark_s* marks;
+	size_t mark_count;
+	size_t mark_capacity;
+	struct bit_capture_sync_s* syncs;
+	size_t sync_count;
+	size_t sync_capacity;
+	struct ph_context_s ph;					// packet handler building the sync index
+	struct fifo_s fifo;
+	uint64_t ph_start;						// first bit after last reset
+	uint8_t ph_synced;						// sync without reset yet
+};
+
+int bit_capture_create(struct bit_capture_writer_s* w, const char* name, uint64_t start_time, uint8_t channel);	// returns 0 on success
+void bit_capture_write(struct bit_capture_writer_s* w, uint8_t level);	// append one raw (NRZI) bit
+void bit_capture_hop(struct bit_capture_writer_s* w, uint8_t channel);	// following bits are from channel
+void bit_capture_mark_time(struct bit_capture_writer_s* w, uint64_t time);	// time of following bit
+void bit_capture_mark_gap(struct bit_capture_writer_s* w);	// bits missing before following bit
+int bit_capture_finish(struct bit_capture_writer_s* w);	// write marks, index and header, close file, returns 0 on success
+
+#endif /* BIT_CAPTURE_H_ */
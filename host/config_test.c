@@ -0,0 +1,283 @@
+/*
+ * Tests the persistent configuration against the emulated flash controller
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Covers blank and corrupted flash, save and load, saving the calibrated crystal alone, segment wear
+ * over many saves and power loss at every flash operation of a save. After a power loss the loaded configuration must be either the
+ * one before or the one after the save. Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "flash.h"
+#include "flash_host.h"
+#include "radio.h"
+#include "packet_handler.h"
+#include "config.h"
+
+static unsigned failures = 0;
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+// configuration that differs from defaults and from other saves by n
+static void make_config(uint32_t n)
+{
+	config.baud = (9600 / CONFIG_BAUD_UNIT) << (n % 5);
+	config.types = 0x0e ^ (n << 4);
+	config.preamble_length = 2 + n % 60;
+	config.sync_timeout = 1 + n % 250;
+	config.rssi_threshold = -(int8_t) (20 + n % 100);
+	config.output = n % 2;
+	config.log = (n >> 1) & 1;
+	config.xo_fixed = (n >> 2) & 1;
+	config.hop = 1 + n % 15;
+	config.channels = 1 + n % 15;
+	ph_channel_pll(&config.channel[n % PH_CHANNELS], RADIO_BAND_MIN_KHZ + n % 33000);
+	config.channel[n % PH_CHANNELS].dwell = 1 + n % 255;
+}
+
+// settings equal, sequence, crystal and CRC are not compared
+static int same_settings(const struct config_s* a, const struct config_s* b)
+{
+	return a->baud == b->baud && a->types == b->types && a->preamble_length == b->preamble_length
+			&& a->sync_timeout == b->sync_timeout && a->rssi_threshold == b->rssi_threshold
+			&& a->output == b->output && a->log == b->log && a->xo_fixed == b->xo_fixed
+			&& a->hop == b->hop && a->channels == b->channels
+			&& memcmp(a->channel, b->channel, sizeof(a->channel)) == 0;
+}
+
+// CRC of record as config.c computes it for a layout version
+static uint16_t record_crc(const struct config_s* record, uint16_t version)
+{
+	const uint8_t* data = (const uint8_t*) record;
+	uint16_t crc = 0xffff ^ version;
+	size_t i;
+	int bit;
+
+	for (i = 0; i < offsetof(struct config_s, crc); i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+	}
+	return crc;
+}
+
+// info segments D and A are not used by configuration
+static int others_untouched(void)
+{
+	uint16_t i;
+	for (i = 0; i < FLASH_INFO_SEGMENT_SIZE; i++) {
+		if (FLASH_INFO_D[i] != 0xff || FLASH_INFO_MEMORY[0xc0 + i] != 0xa5)
+			return 0;
+	}
+	return 1;
+}
+
+static void reset_flash(void)
+{
+	flash_host_reset();
+	memset(FLASH_INFO_MEMORY + 0xc0, 0xa5, FLASH_INFO_SEGMENT_SIZE);	// calibration data in segment A
+	memset(&config, 0, sizeof(config));
+}
+
+static void test_blank(void)
+{
+	struct config_s defaults;
+
+	reset_flash();
+	CHECK(config_load() == 0, "blank: found a record");
+	CHECK(config.preamble_length == PH_PREAMBLE_LENGTH && config.sync_timeout == PH_SYNC_TIMEOUT
+			&& config.channels == 0x0f && config.hop == PH_HOP_AB && config.types == 0xffffffff
+			&& ph_channel_khz(&config.channel[0]) == 161975 && ph_channel_khz(&config.channel[3]) == 156825, "blank: no defaults");
+
+	// garbage that isn't a record
+	defaults = config;
+	memset(FLASH_INFO_B, 0x00, FLASH_INFO_SEGMENT_SIZE);
+	memset(FLASH_INFO_C, 0x5a, FLASH_INFO_SEGMENT_SIZE);
+	CHECK(config_load() == 0 && same_settings(&config, &defaults), "garbage: not ignored");
+}
+
+static void test_save_load(void)
+{
+	struct config_s saved;
+	uint32_t slots;
+	uint8_t* third;								// third record written
+
+	slots = FLASH_INFO_SEGMENT_SIZE / sizeof(struct config_s);
+	reset_flash();
+	config_load();
+	make_config(7);
+	CHECK(config_save() == 1, "save: failed");
+	saved = config;
+
+	memset(&config, 0, sizeof(config));
+	CHECK(config_load() == 1, "load: no record after save");
+	CHECK(same_settings(&config, &saved) && config.sequence == saved.sequence, "load: settings differ");
+
+	// version mismatch, e.g. after firmware update with new layout
+	CHECK(config.crc == record_crc(&config, CONFIG_VERSION), "version: CRC not seeded with version");
+	config.sequence++;
+	config.crc = record_crc(&config, CONFIG_VERSION + 1);
+	flash_write(slots > 1 ? FLASH_INFO_B + sizeof(struct config_s) : FLASH_INFO_C, &config, sizeof(config));
+	config_load();
+	CHECK(same_settings(&config, &saved), "version: other version loaded");
+
+	// corrupted current record falls back to previous
+	make_config(8);
+	config_save();
+	if (slots > 2)
+		third = FLASH_INFO_B + 2 * sizeof(struct config_s);
+	else
+		third = FLASH_INFO_C;							// segment B is full
+	third[5] ^= 0x10;
+	config_load();
+	CHECK(same_settings(&config, &saved), "corrupt: previous record not loaded");
+	CHECK(flash_host_violations == 0, "save: %u writes to bits not erased", flash_host_violations);
+}
+
+// crystal is saved into a copy of the current record, unsaved settings stay unsaved
+static void test_xo_tune(void)
+{
+	struct config_s saved, unsaved;
+	uint8_t n;
+
+	reset_flash();
+	config_load();
+	config.xo_tune = 42;
+	CHECK(config_save_xo_tune() == 0, "xo: saved without a record");
+
+	make_config(3);
+	config_save();
+	saved = config;
+	for (n = 0; n < 5; n++) {						// across both segments
+		make_config(4);								// unsaved changes
+		config.xo_tune = 50 + n;
+		unsaved = config;
+		CHECK(config_save_xo_tune() == 1, "xo: save %u failed", n);
+		CHECK(same_settings(&config, &unsaved) && config.xo_tune == 50 + n, "xo: active configuration changed");
+		memset(&config, 0, sizeof(config));
+		config_load();
+		CHECK(same_settings(&config, &saved) && config.xo_tune == 50 + n, "xo: save %u not loaded", n);
+		CHECK(config.sequence == saved.sequence + n + 1, "xo: save %u has sequence %u", n, config.sequence);
+	}
+	CHECK(flash_host_violations == 0, "xo: %u writes to bits not erased", flash_host_violations);
+}
+
+static void test_wear(uint32_t saves)
+{
+	uint32_t n, slots = FLASH_INFO_SEGMENT_SIZE / sizeof(struct config_s);
+	uint32_t expected = saves / (2 * slots) + 1;
+
+	reset_flash();
+	config_load();
+	for (n = 0; n < saves; n++) {
+		make_config(n);
+		if (!config_save()) {
+			CHECK(0, "wear: save %u failed", n);
+			return;
+		}
+		memset(&config, 0, sizeof(config));
+		config_load();
+		if (config.sequence != (uint16_t) (n + 1)) {		// sequence wraps after 65535 saves
+			CHECK(0, "wear: save %u loaded sequence %u", n, config.sequence);
+			return;
+		}
+	}
+
+	printf("%u saves, %u records per segment: %u erases of segment B, %u of segment C\n",
+			saves, slots, flash_host_erases[2], flash_host_erases[1]);
+	CHECK(flash_host_erases[1] <= expected && flash_host_erases[2] <= expected,
+			"wear: more erases than expected %u", expected);
+	CHECK(flash_host_erases[0] == 0 && flash_host_erases[3] == 0 && others_untouched(), "wear: segment D or A touched");
+	CHECK(flash_host_violations == 0, "wear: %u writes to bits not erased", flash_host_violations);
+}
+
+// power loss after each possible number of flash operations during a save, then more saves
+static void test_power_loss(uint32_t saves)
+{
+	uint32_t n;
+	long budget;
+	unsigned old = 0, new = 0;
+
+	for (n = 0; n < saves; n++) {
+		for (budget = 0; ; budget++) {
+			struct config_s before, after;
+			uint32_t k;
+
+			reset_flash();
+			config_load();
+			for (k = 0; k < n; k++) {					// fill segments up to save n
+				make_config(k);
+				config_save();
+			}
+			before = config;
+
+			make_config(n);
+			after = config;
+			flash_host_budget = budget;
+			config_save();
+			if (!flash_host_power_lost()) {				// save completed within budget
+				flash_host_budget = -1;
+				break;
+			}
+			flash_host_budget = -1;
+
+			// power is back
+			memset(&config, 0, sizeof(config));
+			config_load();
+			if (same_settings(&config, &after))
+				new++;
+			else if (same_settings(&config, &before) && (n > 0 || config.sequence == 0))
+				old++;
+			else {
+				CHECK(0, "power loss: save %u budget %ld loaded neither old nor new configuration", n, budget);
+				return;
+			}
+
+			// saving again has to work
+			make_config(n + 1000);
+			after = config;
+			CHECK(config_save() == 1, "power loss: save %u budget %ld, next save failed", n, budget);
+			memset(&config, 0, sizeof(config));
+			config_load();
+			CHECK(same_settings(&config, &after), "power loss: save %u budget %ld, next save not loaded", n, budget);
+			CHECK(others_untouched(), "power loss: segment D or A touched");
+		}
+	}
+	printf("power loss during %u saves: %u times old, %u times new configuration\n", saves, old, new);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t saves = 100000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n': saves = strtoul(optarg, 0, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n saves]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	printf("record %zu bytes\n", sizeof(struct config_s));
+	CHECK(FLASH_INFO_SEGMENT_SIZE / sizeof(struct config_s) >= 2, "record: less than 2 per segment");
+	test_blank();
+	test_save_load();
+	test_xo_tune();
+	test_wear(saves);
+	test_power_loss(12);
+
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
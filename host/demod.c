@@ -0,0 +1,114 @@
+/*
+ * Reference AIS demodulator: channel filter, FM discriminator and clock recovery
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "dsp.h"
+#include "demod.h"
+
+#define DEMOD_CHANNEL_CUTOFF	9000.0f		// channel filter cutoff in Hz, signal +/-7.2 kHz plus margin for frequency offset
+#define DEMOD_POST_CUTOFF		6000.0f		// post-discriminator filter cutoff in Hz
+#define DEMOD_MAX_TAPS			255
+
+void demod_init(struct demod_s* demod, float sample_rate, uint16_t decim)
+{
+	float taps[DEMOD_MAX_TAPS];
+	float rate = sample_rate / decim;			// sample rate after decimation
+	uint16_t ntaps;
+
+	ntaps = ((uint16_t) (sample_rate / 1000) | 1);	// approx. 1 ms impulse response
+	if (ntaps > DEMOD_MAX_TAPS)
+		ntaps = DEMOD_MAX_TAPS;
+	fir_design_lowpass(taps, ntaps, DEMOD_CHANNEL_CUTOFF / sample_rate);
+	fir_init(&demod->chan_i, taps, ntaps, decim);
+	fir_init(&demod->chan_q, taps, ntaps, decim);
+
+	demod->disc.prev_i = 1;
+	demod->disc.prev_q = 0;
+
+	ntaps = ((uint16_t) (rate / 2000) | 1);		// approx. half a symbol
+	if (ntaps < 3)
+		ntaps = 3;
+	fir_design_lowpass(taps, ntaps, DEMOD_POST_CUTOFF / rate);
+	fir_init(&demod->post, taps, ntaps, 1);
+
+	cr_init(&demod->cr, rate / DSP_AIS_BAUD, 1.5f * 2 * (float) M_PI * DSP_AIS_FDEV / rate);
+
+	demod->buf_i = malloc(DSP_BLOCK * sizeof(float));
+	demod->buf_q = malloc(DSP_BLOCK * sizeof(float));
+	demod->buf_f = malloc(DSP_BLOCK * sizeof(float));
+	demod->buf_p = malloc(DSP_BLOCK * sizeof(float));
+}
+
+void demod_init_audio(struct demod_s* demod, float sample_rate)
+{
+	demod_init(demod, sample_rate, 1);
+
+	// level of audio is unknown, AGC scales it to what the discriminator would output
+	demod->level_target = 2 * (float) M_PI * DSP_AIS_FDEV / sample_rate;
+	demod->level = demod->level_target;
+	demod->attack = 1 / (sample_rate / DSP_AIS_BAUD);		// one symbol
+	demod->release = demod->attack / 4;					// four symbols, so noise bursts between packets don't mask the next one
+}
+
+void demod_free(struct demod_s* demod)
+{
+	fir_free(&demod->chan_i);
+	fir_free(&demod->chan_q);
+	fir_free(&demod->post);
+	free(demod->buf_i);
+	free(demod->buf_q);
+	free(demod->buf_f);
+	free(demod->buf_p);
+}
+
+size_t demod_iq(struct demod_s* demod, const float* i, const float* q, size_t count, uint8_t* bits)
+{
+	size_t produced = 0;
+
+	while (count) {
+		size_t block = count > DSP_BLOCK ? DSP_BLOCK : count;
+		size_t n;
+
+		fir_process(&demod->chan_i, i, block, demod->buf_i);
+		n = fir_process(&demod->chan_q, q, block, demod->buf_q);
+		disc_process(&demod->disc, demod->buf_i, demod->buf_q, n, demod->buf_f);
+		n = fir_process(&demod->post, demod->buf_f, n, demod->buf_p);
+		produced += cr_process(&demod->cr, demod->buf_p, n, bits + produced);
+
+		i += block;
+		q += block;
+		count -= block;
+	}
+
+	return produced;
+}
+
+size_t demod_audio(struct demod_s* demod, const float* audio, size_t count, uint8_t* bits)
+{
+	size_t produced = 0;
+
+	while (count) {
+		size_t block = count > DSP_BLOCK ? DSP_BLOCK : count;
+		size_t n, k;
+
+		n = fir_process(&demod->post, audio, block, demod->buf_p);
+		for (k = 0; k < n; k++) {
+			float a = fabsf(demod->buf_p[k]);
+			demod->level += (a > demod->level ? demod->attack : demod->release) * (a - demod->level);
+			demod->buf_p[k] *= demod->level_target / (demod->level + 1e-12f);
+		}
+		produced += cr_process(&demod->cr, demod->buf_p, n, bits + produced);
+
+		audio += block;
+		count -= block;
+	}
+
+	return produced;
+}
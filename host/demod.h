@@ -0,0 +1,43 @@
+/*
+ * Reference AIS demodulator: channel filter, FM discriminator and clock recovery
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#ifndef DEMOD_H_
+#define DEMOD_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "dsp.h"
+
+struct demod_s {
+	struct fir_s chan_i;				// channel filter, in-phase
+	struct fir_s chan_q;				// channel filter, quadrature
+	struct disc_s disc;					// FM discriminator
+	struct fir_s post;					// post-discriminator filter
+	struct cr_s cr;						// clock recovery and slicer
+	float level;						// audio only: envelope for AGC, fast attack, slow release
+	float level_target;					// audio only: envelope is scaled to nominal deviation
+	float attack;
+	float release;
+	float* buf_i;						// intermediate buffers, DSP_BLOCK samples each
+	float* buf_q;
+	float* buf_f;
+	float* buf_p;
+};
+
+void demod_init(struct demod_s* demod, float sample_rate, uint16_t decim);	// sample rate of input, decim = decimation in channel filter
+void demod_init_audio(struct demod_s* demod, float sample_rate);			// for discriminator audio, e.g. from scanner
+void demod_free(struct demod_s* demod);
+
+// demodulate complex baseband samples into raw (NRZI) bits, bits must hold count / samples per symbol + 1
+size_t demod_iq(struct demod_s* demod, const float* i, const float* q, size_t count, uint8_t* bits);
+
+// slice discriminator audio into raw (NRZI) bits, polarity does not matter as NRZI only looks at transitions
+size_t demod_audio(struct demod_s* demod, const float* audio, size_t count, uint8_t* bits);
+
+#endif /* DEMOD_H_ */
@@ -0,0 +1,383 @@
+/*
+ * Signal processing building blocks for host-side AIS demodulation
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+
+#define DSP_PI		3.14159265358979f
+
+// unaligned vector load
+static inline dsp_v8f v8_load(const float* p)
+{
+	dsp_v8f v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// broadcast scalar into vector
+static inline dsp_v8f v8_set(float f)
+{
+	dsp_v8f v = { f, f, f, f, f, f, f, f };
+	return v;
+}
+
+// pick a where mask is set, b otherwise
+static inline dsp_v8f v8_select(dsp_v8i mask, dsp_v8f a, dsp_v8f b)
+{
+	return (dsp_v8f) (((dsp_v8i) a & mask) | ((dsp_v8i) b & ~mask));
+}
+
+static inline float v8_sum(dsp_v8f v)
+{
+	return ((v[0] + v[4]) + (v[1] + v[5])) + ((v[2] + v[6]) + (v[3] + v[7]));
+}
+
+void fir_init(struct fir_s* fir, const float* taps, uint16_t ntaps, uint16_t decim)
+{
+	uint16_t padded = (ntaps + DSP_VEC_LEN - 1) & ~(DSP_VEC_LEN - 1);
+	uint16_t i;
+
+	fir->ntaps = padded;
+	fir->decim = decim ? decim : 1;
+	fir->phase = 0;
+	fir->taps = calloc(padded, sizeof(float));
+	fir->buffer = calloc(padded + DSP_BLOCK, sizeof(float));
+
+	for (i = 0; i < ntaps; i++)						// reverse taps so window is read forward, zero padding in front
+		fir->taps[padded - 1 - i] = taps[i];
+}
+
+void fir_free(struct fir_s* fir)
+{
+	free(fir->taps);
+	free(fir->buffer);
+	fir->taps = 0;
+	fir->buffer = 0;
+}
+
+size_t fir_process(struct fir_s* fir, const float* in, size_t count, float* out)
+{
+	size_t hist = fir->ntaps - 1;
+	size_t produced = 0;
+	size_t n, v;
+
+	if (count > DSP_BLOCK)
+		count = DSP_BLOCK;
+
+	memcpy(fir->buffer + hist, in, count * sizeof(float));
+
+	for (n = fir->phase; n < count; n += fir->decim) {
+		const float* window = fir->buffer + n;
+		dsp_v8f acc = v8_set(0);
+		for (v = 0; v < fir->ntaps; v += DSP_VEC_LEN)
+			acc += v8_load(window + v) * v8_load(fir->taps + v);
+		out[produced++] = v8_sum(acc);
+	}
+	fir->phase = n - count;
+
+	memmove(fir->buffer, fir->buffer + count, hist * sizeof(float));	// keep history for next block
+
+	return produced;
+}
+
+void fir_design_lowpass(float* taps, uint16_t ntaps, float cutoff)
+{
+	float center = (ntaps - 1) / 2.0f;
+	float sum = 0;
+	uint16_t i;
+
+	for (i = 0; i < ntaps; i++) {
+		float t = i - center;
+		float sinc = (t == 0) ? 2 * cutoff : sinf(2 * DSP_PI * cutoff * t) / (DSP_PI * t);
+		float window = 0.42f - 0.5f * cosf(2 * DSP_PI * i / (ntaps - 1)) + 0.08f * cosf(4 * DSP_PI * i / (ntaps - 1));	// Blackman
+		taps[i] = sinc * window;
+		sum += taps[i];
+	}
+
+	for (i = 0; i < ntaps; i++)
+		taps[i] /= sum;
+}
+
+void fir_design_gaussian(float* taps, uint16_t ntaps, float bt, float sps)
+{
+	float center = (ntaps - 1) / 2.0f;
+	float sum = 0;
+	uint16_t i;
+
+	for (i = 0; i < ntaps; i++) {
+		float t = (i - center) / sps;				// time in symbols
+		taps[i] = expf(-2 * DSP_PI * DSP_PI * bt * bt * t * t / logf(2));
+		sum += taps[i];
+	}
+
+	for (i = 0; i < ntaps; i++)
+		taps[i] /= sum;
+}
+
+void mix_init(struct mix_s* mix, float shift)
+{
+	uint8_t k;
+
+	for (k = 0; k < DSP_VEC_LEN; k++) {
+		mix->ph_i[k] = cosf(2 * DSP_PI * shift * k);
+		mix->ph_q[k] = sinf(2 * DSP_PI * shift * k);
+	}
+	mix->rot_i = cosf(2 * DSP_PI * shift * DSP_VEC_LEN);
+	mix->rot_q = sinf(2 * DSP_PI * shift * DSP_VEC_LEN);
+}
+
+void mix_process(struct mix_s* mix, float* i, float* q, size_t count)
+{
+	dsp_v8f pi = v8_load(mix->ph_i), pq = v8_load(mix->ph_q);
+	dsp_v8f mag;
+	size_t n;
+
+	for (n = 0; n + DSP_VEC_LEN <= count; n += DSP_VEC_LEN) {
+		dsp_v8f si = v8_load(i + n), sq = v8_load(q + n);
+		dsp_v8f ri = si * pi - sq * pq;
+		dsp_v8f rq = si * pq + sq * pi;
+		memcpy(i + n, &ri, sizeof(ri));
+		memcpy(q + n, &rq, sizeof(rq));
+
+		dsp_v8f ti = pi * mix->rot_i - pq * mix->rot_q;		// advance oscillator by 8 samples
+		pq = pi * mix->rot_q + pq * mix->rot_i;
+		pi = ti;
+	}
+
+	// renormalize to avoid drift of phasor magnitude
+	mag = pi * pi + pq * pq;
+	for (n = 0; n < DSP_VEC_LEN; n++) {
+		float norm = 1 / sqrtf(mag[n]);
+		mix->ph_i[n] = pi[n] * norm;
+		mix->ph_q[n] = pq[n] * norm;
+	}
+}
+
+void pfb_init(struct pfb_s* pfb, uint16_t branches, uint16_t branch_taps, float cutoff)
+{
+	uint16_t ntaps = branches * branch_taps;
+	float* taps = malloc(ntaps * sizeof(float));
+	uint16_t n;
+
+	pfb->branches = branches;
+	pfb->ntaps = ntaps;
+	pfb->phase = 0;
+	pfb->pos = 0;
+	pfb->taps = malloc(ntaps * sizeof(float));
+	pfb->buf_i = calloc(ntaps + DSP_BLOCK, sizeof(float));
+	pfb->buf_q = calloc(ntaps + DSP_BLOCK, sizeof(float));
+	pfb->acc_i = malloc(branches * sizeof(float));
+	pfb->acc_q = malloc(branches * sizeof(float));
+	pfb->rot_i = malloc(branches * sizeof(float));
+	pfb->rot_q = malloc(branches * sizeof(float));
+
+	fir_design_lowpass(taps, ntaps, cutoff / branches);
+	for (n = 0; n < ntaps; n++)
+		pfb->taps[ntaps - 1 - n] = taps[n];
+	for (n = 0; n < branches; n++) {
+		pfb->rot_i[n] = cosf(2 * DSP_PI * n / branches);
+		pfb->rot_q[n] = sinf(2 * DSP_PI * n / branches);
+	}
+
+	free(taps);
+}
+
+void pfb_free(struct pfb_s* pfb)
+{
+	free(pfb->taps);
+	free(pfb->buf_i);
+	free(pfb->buf_q);
+	free(pfb->acc_i);
+	free(pfb->acc_q);
+	free(pfb->rot_i);
+	free(pfb->rot_q);
+}
+
+// channel k is x[s-n] * h[n] * exp(-j*2*pi*k*(s-n)/M), with n = p*M + r this is the sum of branch outputs
+// v[r] = sum_p h[p*M+r] * x[s-p*M-r] rotated by exp(j*2*pi*k*(r-s)/M), so the filter runs once for all channels
+size_t pfb_process(struct pfb_s* pfb, const float* i, const float* q, size_t count,
+		uint8_t nchannels, const int16_t* bins, float** out_i, float** out_q)
+{
+	uint16_t m = pfb->branches;
+	uint16_t decim = m / 2;
+	size_t hist = pfb->ntaps - 1;
+	size_t produced = 0;
+	size_t n, c, t;
+	uint8_t k;
+
+	if (count > DSP_BLOCK)
+		count = DSP_BLOCK;
+
+	memcpy(pfb->buf_i + hist, i, count * sizeof(float));
+	memcpy(pfb->buf_q + hist, q, count * sizeof(float));
+
+	for (n = pfb->phase; n < count; n += decim) {
+		const float* wi = pfb->buf_i + n;
+		const float* wq = pfb->buf_q + n;
+		uint16_t s = (pfb->pos + n) % m;				// absolute index of newest sample modulo M
+
+		// branch outputs, taps and samples in reverse order so that acc[t] is branch r = M-1-t
+		for (t = 0; t + DSP_VEC_LEN <= m; t += DSP_VEC_LEN) {
+			dsp_v8f ai = v8_set(0), aq = v8_set(0);
+			for (c = t; c < pfb->ntaps; c += m) {
+				dsp_v8f taps = v8_load(pfb->taps + c);
+				ai += taps * v8_load(wi + c);
+				aq += taps * v8_load(wq + c);
+			}
+			memcpy(pfb->acc_i + t, &ai, sizeof(ai));
+			memcpy(pfb->acc_q + t, &aq, sizeof(aq));
+		}
+		for (; t < m; t++) {
+			float ai = 0, aq = 0;
+			for (c = t; c < pfb->ntaps; c += m) {
+				ai += pfb->taps[c] * wi[c];
+				aq += pfb->taps[c] * wq[c];
+			}
+			pfb->acc_i[t] = ai;
+			pfb->acc_q[t] = aq;
+		}
+
+		// DFT, only for the requested channels
+		for (k = 0; k < nchannels; k++) {
+			int32_t step = (bins[k] % m + m) % m;
+			uint16_t u = (step * (uint32_t) (m - 1 + m - s)) % m;	// rotation index of r = M-1 at t = 0
+			float yi = 0, yq = 0;
+			for (t = 0; t < m; t++) {
+				yi += pfb->acc_i[t] * pfb->rot_i[u] - pfb->acc_q[t] * pfb->rot_q[u];
+				yq += pfb->acc_i[t] * pfb->rot_q[u] + pfb->acc_q[t] * pfb->rot_i[u];
+				u += m - step;							// r decreases with t
+				if (u >= m)
+					u -= m;
+			}
+			out_i[k][produced] = yi;
+			out_q[k][produced] = yq;
+		}
+		produced++;
+	}
+	pfb->phase = n - count;
+	pfb->pos = (pfb->pos + count) % m;
+
+	memmove(pfb->buf_i, pfb->buf_i + count, hist * sizeof(float));
+	memmove(pfb->buf_q, pfb->buf_q + count, hist * sizeof(float));
+
+	return produced;
+}
+
+// branch-free atan2 on 8 lanes, max error approx. 1e-5 rad
+static inline dsp_v8f v8_atan2(dsp_v8f y, dsp_v8f x)
+{
+	const dsp_v8i abs_mask = (dsp_v8i) v8_set(0) | 0x7fffffff;
+	const dsp_v8i sign_mask = ~abs_mask;
+
+	dsp_v8f ax = (dsp_v8f) ((dsp_v8i) x & abs_mask);
+	dsp_v8f ay = (dsp_v8f) ((dsp_v8i) y & abs_mask);
+	dsp_v8i swap = ay > ax;
+	dsp_v8f num = v8_select(swap, ax, ay);
+	dsp_v8f den = v8_select(swap, ay, ax);
+	dsp_v8f a = num / (den + 1e-30f);
+	dsp_v8f s = a * a;
+
+	dsp_v8f r = ((((-0.01348047f * s + 0.05747731f) * s - 0.12123912f) * s + 0.19563307f) * s - 0.33299461f) * s * a + a;
+	r = v8_select(swap, DSP_PI / 2 - r, r);
+	r = v8_select(x < 0, DSP_PI - r, r);
+	return (dsp_v8f) ((dsp_v8i) r | ((dsp_v8i) y & sign_mask));
+}
+
+void disc_process(struct disc_s* disc, const float* i, const float* q, size_t count, float* out)
+{
+	size_t n = 0;
+
+	if (count == 0)
+		return;
+
+	// first sample relates to last sample of previous call
+	out[0] = atan2f(q[0] * disc->prev_i - i[0] * disc->prev_q, i[0] * disc->prev_i + q[0] * disc->prev_q);
+	n = 1;
+
+	// arg(x[n] * conj(x[n-1])), 8 samples at a time
+	for (; n + DSP_VEC_LEN <= count; n += DSP_VEC_LEN) {
+		dsp_v8f ci = v8_load(i + n), cq = v8_load(q + n);
+		dsp_v8f pi = v8_load(i + n - 1), pq = v8_load(q + n - 1);
+		dsp_v8f r = v8_atan2(cq * pi - ci * pq, ci * pi + cq * pq);
+		memcpy(out + n, &r, sizeof(r));
+	}
+
+	for (; n < count; n++)
+		out[n] = atan2f(q[n] * i[n-1] - i[n] * q[n-1], i[n] * i[n-1] + q[n] * q[n-1]);
+
+	disc->prev_i = i[count - 1];
+	disc->prev_q = q[count - 1];
+}
+
+void cr_init(struct cr_s* cr, float sps, float limit)
+{
+	cr->sps = sps;
+	cr->gain = 0.1f;
+	cr->gain_acq = 0.5f;
+	cr->mu = 0;
+	cr->prev = 0;
+	cr->dc = 0;
+	cr->amp = limit / 2;
+	cr->alpha = 1.0f / 16;							// time constant of 16 symbols, covered by AIS preamble
+	cr->limit = limit;
+	cr->sampled = 0;
+}
+
+size_t cr_process(struct cr_s* cr, const float* in, size_t count, uint8_t* bits)
+{
+	float half = cr->sps / 2;
+	float last;
+	size_t produced = 0;
+	size_t n;
+
+	for (n = 0; n < count; n++) {
+		float v = in[n];
+		if (v > cr->limit)
+			v = cr->limit;
+		else if (v < -cr->limit)
+			v = -cr->limit;
+		v -= cr->dc;
+		last = cr->prev;
+
+		cr->mu += 1;
+
+		if ((v >= 0) != (cr->prev >= 0)) {			// zero crossing marks symbol boundary
+			float since = v / (v - cr->prev);		// samples elapsed since crossing (linear interpolation)
+			float err = since - cr->mu;
+			while (err > half)
+				err -= cr->sps;
+			while (err < -half)
+				err += cr->sps;
+			if (err > cr->sps / 4 || err < -cr->sps / 4)
+				cr->mu += cr->gain_acq * err;			// pull in quickly if far off, e.g. on preamble
+			else
+				cr->mu += cr->gain * err;			// nudge symbol clock towards crossing
+		}
+		cr->prev = v;
+
+		if (cr->mu >= cr->sps) {					// next symbol period
+			cr->mu -= cr->sps;
+			cr->sampled = 0;
+		}
+		if (!cr->sampled && cr->mu >= half) {		// slice in center of symbol
+			float frac = cr->mu - half;				// center was frac samples ago, interpolate
+			float center = v - (v - last) * (frac > 1 ? 1 : frac);
+			bits[produced++] = (center >= 0);
+			cr->sampled = 1;
+
+			// decision directed DC and amplitude tracking, unbiased by unbalanced data
+			cr->dc += cr->alpha * (center >= 0 ? center - cr->amp : center + cr->amp);
+			cr->amp += cr->alpha * (fabsf(center) - cr->amp);
+		}
+	}
+
+	return produced;
+}
@@ -0,0 +1,97 @@
+/*
+ * Signal processing building blocks for host-side AIS demodulation
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#ifndef DSP_H_
+#define DSP_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define DSP_AIS_BAUD		9600		// AIS symbol rate
+#define DSP_AIS_FDEV		2400		// AIS frequency deviation in Hz (GMSK, h=0.5)
+
+#define DSP_VEC_LEN			8			// floats per SIMD vector
+#define DSP_BLOCK			4096		// max samples per call of the block functions
+
+typedef float dsp_v8f __attribute__((vector_size(DSP_VEC_LEN * sizeof(float))));
+typedef int32_t dsp_v8i __attribute__((vector_size(DSP_VEC_LEN * sizeof(int32_t))));
+
+// FIR filter with optional decimation, taps are padded to a multiple of DSP_VEC_LEN
+struct fir_s {
+	uint16_t ntaps;						// number of taps, padded
+	uint16_t decim;						// decimation factor, 1 = none
+	uint16_t phase;						// samples to skip before next output
+	float* taps;						// taps in reverse order
+	float* buffer;						// history (ntaps-1 samples) followed by current block
+};
+
+void fir_init(struct fir_s* fir, const float* taps, uint16_t ntaps, uint16_t decim);
+void fir_free(struct fir_s* fir);
+size_t fir_process(struct fir_s* fir, const float* in, size_t count, float* out);	// returns number of output samples
+
+void fir_design_lowpass(float* taps, uint16_t ntaps, float cutoff);	// windowed sinc, cutoff relative to sample rate (0..0.5), unity DC gain
+void fir_design_gaussian(float* taps, uint16_t ntaps, float bt, float sps);	// GMSK pulse shaping filter, unity DC gain
+
+// frequency shift of complex baseband by numerically controlled oscillator
+struct mix_s {
+	float ph_i[DSP_VEC_LEN];			// oscillator phasors of the 8 lanes
+	float ph_q[DSP_VEC_LEN];
+	float rot_i;						// phasor rotation for 8 samples
+	float rot_q;
+};
+
+void mix_init(struct mix_s* mix, float shift);		// shift relative to sample rate (-0.5..0.5)
+void mix_process(struct mix_s* mix, float* i, float* q, size_t count);	// in place, count must be a multiple of DSP_VEC_LEN
+
+// polyphase filter bank splitting complex baseband into channels spaced by sample rate / branches,
+// 2x oversampled, i.e. decimation by branches / 2 so that channel edges don't alias
+struct pfb_s {
+	uint16_t branches;					// number of channels in filter bank, even
+	uint16_t ntaps;						// length of prototype filter, multiple of branches
+	uint16_t phase;						// samples to skip before next output
+	uint16_t pos;						// index of newest sample in buffer modulo branches, for channel phase
+	float* taps;						// prototype low pass in reverse order
+	float* buf_i;						// history (ntaps-1 samples) followed by current block
+	float* buf_q;
+	float* acc_i;						// branch outputs
+	float* acc_q;
+	float* rot_i;						// exp(j*2*pi*k/branches)
+	float* rot_q;
+};
+
+void pfb_init(struct pfb_s* pfb, uint16_t branches, uint16_t branch_taps, float cutoff);	// cutoff of channels relative to channel spacing, e.g. 0.5
+void pfb_free(struct pfb_s* pfb);
+size_t pfb_process(struct pfb_s* pfb, const float* i, const float* q, size_t count,		// returns number of output samples per channel
+		uint8_t nchannels, const int16_t* bins, float** out_i, float** out_q);			// bins are channel numbers, negative below center
+
+// FM discriminator, output is instantaneous frequency in radians per sample
+struct disc_s {
+	float prev_i;
+	float prev_q;
+};
+
+void disc_process(struct disc_s* disc, const float* i, const float* q, size_t count, float* out);
+
+// symbol clock recovery on discriminator output, slicing into raw (NRZI) bits
+struct cr_s {
+	float sps;							// samples per symbol
+	float gain;							// loop gain of timing correction at zero crossings
+	float gain_acq;						// loop gain when timing is off by more than a quarter symbol
+	float mu;							// samples since last symbol boundary
+	float prev;							// previous DC-free sample
+	float dc;							// DC estimate, i.e. carrier frequency offset
+	float amp;							// amplitude estimate of sliced symbols
+	float alpha;						// weight of new symbol in DC and amplitude estimates
+	float limit;						// samples are clipped to +/-limit, e.g. 1.5x deviation, so noise can't drag DC estimate
+	uint8_t sampled;					// symbol of current period has been sliced
+};
+
+void cr_init(struct cr_s* cr, float sps, float limit);
+size_t cr_process(struct cr_s* cr, const float* in, size_t count, uint8_t* bits);	// returns number of bits
+
+#endif /* DSP_H_ */
@@ -0,0 +1,334 @@
+/*
+ * Tests the packet handler with two radios against the radio mock
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Build with RADIO_DEVICES=2. Covers dealing the channels of the hop policy to the radios, overlapping
+ * packets on channel A and B received at the same time without a hop, merging them into fifo_default with
+ * their signal info when the packet handler posts EVENT_PACKET, the CCA pin of each radio aborting only
+ * its own packets, and MCLK divided only while both radios hunt for sync. Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "radio.h"
+#include "radio_mock.h"
+#include "fifo.h"
+#include "packet_handler.h"
+#include "ais_tx.h"
+#include "event.h"
+
+#if (RADIO_DEVICES != 2)
+#error "Build dual_test with -DRADIO_DEVICES=2."
+#endif
+
+#define DUAL_PAYLOAD	21					// bytes of a position report
+#define DUAL_RSSI_0		100					// RSSI register values of the radios, -84 and -64dBm
+#define DUAL_RSSI_1		140
+
+void ph_irq_handler(void);					// firmware ISR, a regular function on host
+
+static unsigned failures = 0;
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+// raw DATA pin levels of one radio
+struct dual_stream_s {
+	uint8_t* levels;
+	uint32_t count;
+	uint32_t* keys;							// payload key of each frame
+	uint32_t packets;						// frames in stream
+	uint32_t received;						// frames received so far, in order
+};
+
+static uint8_t payload_byte(uint8_t channel, uint32_t k, uint8_t i)
+{
+	return k * 31 + i * 7 + channel * 101;
+}
+
+// frame and following idle line decode on a single channel, some CRCs end in a way the decoder rejects
+static int frame_decodes(const uint8_t* levels, uint16_t count)
+{
+	struct fifo_s fifo;
+	struct ph_context_s ctx;
+	uint8_t packets = 0;
+	uint16_t n;
+
+	fifo_ctx_reset(&fifo);
+	ph_context_init(&ctx, &fifo, 0);
+	for (n = 0; n < count; n++) {
+		if (ph_process_bit(&ctx, levels[n]) & PH_EVENT_PACKET)
+			packets++;
+	}
+	return packets == 1;
+}
+
+// idle line, then frames with gaps of varying length, one stream starts later so frames overlap
+static void make_stream(struct dual_stream_s* stream, uint8_t channel, uint32_t packets, uint32_t offset)
+{
+	uint8_t payload[DUAL_PAYLOAD];
+	uint8_t level = 0;
+	uint32_t k = 0;
+	uint8_t i;
+
+	stream->levels = malloc(offset + packets * (AIS_TX_MAX_BITS(DUAL_PAYLOAD) + 64) + 64);
+	stream->keys = malloc(packets * sizeof(uint32_t));
+	memset(stream->levels, 0, offset);
+	stream->count = offset;
+	stream->packets = 0;
+	while (stream->packets < packets) {
+		uint8_t* frame = stream->levels + stream->count;
+		uint8_t start = level;
+		uint8_t gap = 20 + k % 37;
+		uint16_t bits;
+		for (i = 0; i < DUAL_PAYLOAD; i++)
+			payload[i] = payload_byte(channel, k, i);
+		bits = ais_tx_frame(frame, &level, payload, DUAL_PAYLOAD);
+		memset(frame + bits, level, gap);
+		if (frame_decodes(frame, bits + gap)) {
+			stream->keys[stream->packets++] = k;
+			stream->count += bits + gap;
+		} else
+			level = start;
+		k++;
+	}
+	memset(stream->levels + stream->count, level, 64);
+	stream->count += 64;
+	stream->received = 0;
+}
+
+static void free_stream(struct dual_stream_s* stream)
+{
+	free(stream->levels);
+	free(stream->keys);
+}
+
+// clock one bit into each radio, on the same DATA_CLK edge
+static void clock_bits(uint8_t level0, uint8_t level1)
+{
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		const struct radio_pins_s* pins = radio_devices[n].pins;
+		if (n == 0 ? level0 : level1)
+			P2IN |= pins->data;
+		else
+			P2IN &= ~pins->data;
+		P2IFG |= pins->data_clk;
+	}
+	ph_irq_handler();
+	CHECK(!(P2IFG & (radio_devices[0].pins->data_clk | radio_devices[1].pins->data_clk)), "DATA_CLK flags not cleared");
+}
+
+// move packets into fifo_default and check them against the streams of channel A and B
+static void receive_packets(struct dual_stream_s* streams, const int16_t* rssi)
+{
+	uint16_t size;
+
+	ph_poll();
+	while ((size = fifo_get_packet()) != 0) {
+		struct ph_packet_info_s info;
+		uint8_t channel = fifo_read_byte();
+		uint8_t info_ok = ph_get_packet_info(&info);
+		uint8_t i;
+
+		if (channel > 1 || size != 1 + DUAL_PAYLOAD + 2) {
+			CHECK(0, "packet of %u bytes on channel %u", size, channel);
+			fifo_remove_packet();
+			continue;
+		}
+		struct dual_stream_s* stream = &streams[channel];
+		uint32_t k = stream->keys[stream->received++ % stream->packets];
+		for (i = 0; i < DUAL_PAYLOAD; i++) {
+			if (fifo_read_byte() != payload_byte(channel, k, i)) {
+				CHECK(0, "channel %c packet %u differs at byte %u", 'A' + channel, k, i);
+				break;
+			}
+		}
+		CHECK(info_ok && info.rssi == rssi[channel], "channel %c packet %u: info %u, RSSI %d instead of %d",
+				'A' + channel, k, info_ok, info.rssi, rssi[channel]);
+		fifo_remove_packet();
+	}
+}
+
+// run both streams through the ISR, returns number of bits clocked
+static uint32_t run_streams(struct dual_stream_s* streams, const int16_t* rssi)
+{
+	uint32_t count = streams[0].count > streams[1].count ? streams[0].count : streams[1].count;
+	uint32_t n;
+
+	for (n = 0; n < count; n++) {
+		uint8_t event;
+		clock_bits(n < streams[0].count ? streams[0].levels[n] : 0, n < streams[1].count ? streams[1].levels[n] : 0);
+		while ((event = event_take()) != 0) {
+			if (event == EVENT_PACKET)		// like the main loop, packets are only picked up on their event
+				receive_packets(streams, rssi);
+		}
+	}
+	return count;
+}
+
+static int same_pll(uint8_t device, uint8_t channel)
+{
+	uint8_t pll[4];
+
+	ph_channel_words(&ph_default_channels[channel], pll);
+	return memcmp(radio_mock[device].pll, pll, 4) == 0;
+}
+
+// channels of hop policy are dealt to radios in turn, a radio without channel isn't started
+static void test_deal(void)
+{
+	uint32_t starts[RADIO_DEVICES];
+	uint8_t n;
+
+	ph_set_hop(0x01);
+	ph_setup();
+	starts[0] = radio_mock[0].start_rx;
+	starts[1] = radio_mock[1].start_rx;
+	ph_start();
+	CHECK(same_pll(0, 0) && radio_mock[0].start_rx == starts[0] + 1, "hop A: radio 0 not on channel A");
+	CHECK(radio_mock[1].start_rx == starts[1], "hop A: radio 1 started");
+	for (n = 0; n < 100; n++)
+		clock_bits(n & 1, n & 1);
+	CHECK(ph_get_state() == PH_STATE_WAIT_FOR_SYNC || ph_get_state() == PH_STATE_RESET, "hop A: state %u", ph_get_state());
+	ph_stop();
+
+	ph_set_hop(0x0f);
+	ph_setup();
+	ph_start();
+	CHECK(same_pll(0, 0) && same_pll(1, 1), "hop ABCD: radios don't start on A and B");
+	for (n = 0; n < PH_SYNC_TIMEOUT + 3; n++)	// idle line, both radios hop after sync timeout
+		clock_bits(0, 0);
+	CHECK(same_pll(0, 2) && same_pll(1, 3), "hop ABCD: radios don't hop to C and D");
+	for (n = 0; n < PH_SYNC_TIMEOUT + 3; n++)
+		clock_bits(0, 0);
+	CHECK(same_pll(0, 0) && same_pll(1, 1), "hop ABCD: radios don't hop back to A and B");
+	ph_stop();
+	printf("dealing channels to radios tested\n");
+}
+
+// overlapping packets on A and B, all must arrive without any hop
+static void test_overlap(uint32_t packets)
+{
+	struct dual_stream_s streams[2];
+	const int16_t rssi[2] = { RADIO_RSSI_TO_DBM(DUAL_RSSI_0), RADIO_RSSI_TO_DBM(DUAL_RSSI_1) };
+	uint32_t starts[RADIO_DEVICES];
+	uint32_t bits;
+
+	make_stream(&streams[0], 0, packets, 0);
+	make_stream(&streams[1], 1, packets, AIS_TX_MAX_BITS(DUAL_PAYLOAD) / 2);
+	radio_mock_rssi(0, DUAL_RSSI_0);
+	radio_mock_rssi(1, DUAL_RSSI_1);
+
+	ph_set_hop(PH_HOP_AB);
+	ph_setup();
+	starts[0] = radio_mock[0].start_rx;
+	starts[1] = radio_mock[1].start_rx;
+	ph_start();
+	CHECK(same_pll(0, 0) && same_pll(1, 1), "hop AB: radios don't start on A and B");
+	bits = run_streams(streams, rssi);
+	ph_stop();
+
+	CHECK(streams[0].received == packets && streams[1].received == packets, "received %u on A and %u on B of %u",
+			streams[0].received, streams[1].received, packets);
+	CHECK(radio_mock[0].start_rx == starts[0] + 1 && radio_mock[1].start_rx == starts[1] + 1, "radios hopped");
+	printf("%u bits: %u of %u packets on A, %u of %u on B\n", bits, streams[0].received, packets, streams[1].received, packets);
+	free_stream(&streams[0]);
+	free_stream(&streams[1]);
+}
+
+// signal of radio 1 below threshold, its CCA pin aborts its packets, radio 0 is not affected
+static void test_cca(uint32_t packets)
+{
+	struct dual_stream_s streams[2];
+	const int16_t rssi[2] = { RADIO_RSSI_TO_DBM(DUAL_RSSI_0), RADIO_RSSI_TO_DBM(DUAL_RSSI_1) };
+
+	make_stream(&streams[0], 0, packets, 0);
+	make_stream(&streams[1], 1, packets, AIS_TX_MAX_BITS(DUAL_PAYLOAD) / 2);
+
+	ph_set_tuning(PH_PREAMBLE_LENGTH, PH_SYNC_TIMEOUT, RADIO_RSSI_TO_DBM(DUAL_RSSI_0) - 10, 0);
+	ph_set_hop(PH_HOP_AB);
+	ph_setup();
+	ph_start();
+	radio_mock_rssi(0, DUAL_RSSI_0);
+	radio_mock_rssi(1, RADIO_DBM_TO_RSSI(RADIO_RSSI_TO_DBM(DUAL_RSSI_0) - 20));
+	run_streams(streams, rssi);
+	ph_stop();
+	ph_set_tuning(PH_PREAMBLE_LENGTH, PH_SYNC_TIMEOUT, PH_RSSI_THRESHOLD, PH_RSSI_MARGIN);
+
+	CHECK(streams[0].received == packets && streams[1].received == 0, "weak B: received %u on A and %u on B of %u",
+			streams[0].received, streams[1].received, packets);
+	printf("weak signal on B: %u of %u packets on A, %u on B\n", streams[0].received, packets, streams[1].received);
+	free_stream(&streams[0]);
+	free_stream(&streams[1]);
+}
+
+// MCLK is divided only while both radios hunt for sync, a sync on either returns to full speed
+static void test_mclk(void)
+{
+	struct dual_stream_s stream;
+	struct ph_activity_s activity;
+	uint32_t n;
+
+	make_stream(&stream, 0, 1, 0);
+	ph_set_hop(PH_HOP_AB);
+	ph_setup();
+	ph_start();
+	for (n = 0; n < 100; n++)
+		clock_bits(0, 0);
+	event_flags = 0;
+	ph_mclk_hunt();
+	CHECK((BCSCTL2 & DIVM_3) == PH_MCLK_HUNT, "MCLK not divided while hunting");
+
+	for (n = 0; n < stream.count && !(event_flags & EVENT_SYNC); n++)
+		clock_bits(0, stream.levels[n]);
+	CHECK(event_flags & EVENT_SYNC, "no sync on B");
+	CHECK((BCSCTL2 & DIVM_3) == 0, "MCLK divided after sync");
+	ph_mclk_hunt();
+	CHECK((BCSCTL2 & DIVM_3) == 0, "MCLK divided while B receives");
+	for (; n < stream.count; n++)
+		clock_bits(0, stream.levels[n]);
+	ph_mclk_hunt();
+	CHECK((BCSCTL2 & DIVM_3) == PH_MCLK_HUNT, "MCLK not divided after packet");
+	PH_MCLK_FULL();
+
+	ph_get_activity(0, &activity);
+	CHECK(activity.late == 0, "%u late bits", activity.late);
+	ph_stop();
+	while (fifo_get_packet())
+		fifo_remove_packet();
+	event_flags = 0;
+	printf("MCLK divided while hunting for sync\n");
+	free_stream(&stream);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t packets = 1000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, 0, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	test_deal();
+	test_overlap(packets);
+	test_cca(packets / 10 + 1);
+	test_mclk();
+
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Host emulation of the MSP430 flash controller, replaces flash.c
+ * Author: Adrian Studer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "flash.h"
+#include "flash_host.h"
+
+uint8_t host_info_memory[256] __attribute__((aligned(FLASH_INFO_SEGMENT_SIZE)));
+uint8_t host_main_memory[0x4000] __attribute__((aligned(FLASH_MAIN_SEGMENT_SIZE)));
+uint32_t flash_host_erases[FLASH_HOST_INFO_SEGMENTS];
+uint32_t flash_host_main_erases[FLASH_HOST_MAIN_SEGMENTS];
+uint32_t flash_host_violations;
+long flash_host_budget = -1;
+
+// consume one operation, returns 0 if power is lost before it
+static uint8_t flash_host_operation(void)
+{
+	if (flash_host_budget == 0)
+		return 0;
+	if (flash_host_budget > 0)
+		flash_host_budget--;
+	return 1;
+}
+
+void flash_host_reset(void)
+{
+	memset(host_info_memory, 0xff, sizeof(host_info_memory));
+	memset(host_main_memory, 0xff, sizeof(host_main_memory));
+	memset(flash_host_erases, 0, sizeof(flash_host_erases));
+	memset(flash_host_main_erases, 0, sizeof(flash_host_main_erases));
+	flash_host_violations = 0;
+	flash_host_budget = -1;
+}
+
+uint8_t flash_host_power_lost(void)
+{
+	return flash_host_budget == 0;
+}
+
+void flash_erase(uint8_t* segment)
+{
+	uint16_t size, i;
+	uint32_t* erases;
+
+	if (segment >= host_info_memory && segment < host_info_memory + sizeof(host_info_memory)) {
+		size_t offset = segment - host_info_memory;
+		size = FLASH_INFO_SEGMENT_SIZE;
+		erases = &flash_host_erases[offset / size];
+		if (offset % size) {
+			fprintf(stderr, "flash_erase: %p is not the start of an information segment\n", (void*) segment);
+			abort();
+		}
+		if (offset / size == 3) {
+			fprintf(stderr, "flash_erase: segment A is locked\n");
+			abort();
+		}
+	} else if (segment >= host_main_memory && segment < host_main_memory + sizeof(host_main_memory)) {
+		size_t offset = segment - host_main_memory;
+		size = FLASH_MAIN_SEGMENT_SIZE;
+		erases = &flash_host_main_erases[offset / size];
+		if (offset % size) {
+			fprintf(stderr, "flash_erase: %p is not the start of a main segment\n", (void*) segment);
+			abort();
+		}
+	} else {
+		fprintf(stderr, "flash_erase: %p is not in flash\n", (void*) segment);
+		abort();
+	}
+
+	if (flash_host_budget == 1) {					// power lost during erase, content is undefined
+		for (i = 0; i < size; i++)
+			segment[i] |= rand();
+		flash_host_budget = 0;
+		return;
+	}
+	if (!flash_host_operation())
+		return;
+	memset(segment, 0xff, size);
+	(*erases)++;
+}
+
+void flash_write(uint8_t* address, const void* data, uint16_t size)
+{
+	const uint8_t* bytes = data;
+	uint16_t i;
+
+	if (!(address >= host_info_memory && address + size <= host_info_memory + sizeof(host_info_memory))
+			&& !(address >= host_main_memory && address + size <= host_main_memory + sizeof(host_main_memory))) {
+		fprintf(stderr, "flash_write: %p..+%u outside of flash\n", (void*) address, size);
+		abort();
+	}
+
+	for (i = 0; i < size; i++) {
+		if (!flash_host_operation())
+			return;
+		if (bytes[i] & ~address[i])					// programming can only clear bits
+			flash_host_violations++;
+		address[i] &= bytes[i];
+	}
+}
@@ -0,0 +1,26 @@
+/*
+ * Host emulation of the MSP430 flash controller, replaces flash.c
+ * Author: Adrian Studer
+ *
+ * Flash behaves like the real thing: erase sets a segment to 0xff, writes can only clear bits.
+ * For tests the emulation counts erases per segment, detects writes to bits that weren't erased
+ * and simulates a power loss after a given number of flash operations.
+ */
+
+#ifndef FLASH_HOST_H_
+#define FLASH_HOST_H_
+
+#include <inttypes.h>
+
+#define FLASH_HOST_INFO_SEGMENTS	4
+#define FLASH_HOST_MAIN_SEGMENTS	32
+
+extern uint32_t flash_host_erases[FLASH_HOST_INFO_SEGMENTS];	// erase count of information segments D, C, B, A
+extern uint32_t flash_host_main_erases[FLASH_HOST_MAIN_SEGMENTS];	// erase count of main segments from 0xc000
+extern uint32_t flash_host_violations;	// writes that tried to set a bit, i.e. to a location not erased
+extern long flash_host_budget;			// erases and byte writes left until power loss, -1 = unlimited
+
+void flash_host_reset(void);			// all segments erased, counters cleared, no power loss
+uint8_t flash_host_power_lost(void);	// budget ran out, flash operations are ignored until reset or new budget
+
+#endif /* FLASH_HOST_H_ */
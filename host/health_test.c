@@ -0,0 +1,246 @@
+/*
+ * Tests supervision and recovery of health.c against the packet handler and radio mock
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Each tick clocks a number of idle bits, optionally followed by a frame, into the packet handler ISR, then
+ * runs the timer ISR and, on its event, health_poll like the main loop. Checks the recovery tiers of a stalled
+ * DATA_CLK, that a sync returns the radio to the first tier, CTS timeouts, silence that never resets the MCU,
+ * the reset count across MCU resets, that a stopped packet handler isn't supervised and that a command
+ * continuing its work doesn't hold off the tick. Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "radio.h"
+#include "radio_mock.h"
+#include "fifo.h"
+#include "packet_handler.h"
+#include "ais_tx.h"
+#include "event.h"
+#include "health.h"
+
+#define TEST_PAYLOAD	21					// bytes of a position report
+#define TEST_WATCHDOG	(WDTPW | WDTCNTCL | WDTSSEL)
+
+void ph_irq_handler(void);					// firmware ISRs, regular functions on host
+void health_timer_isr(void);
+
+static unsigned failures = 0;
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static uint8_t frame[AIS_TX_MAX_BITS(TEST_PAYLOAD)];
+static uint16_t frame_bits;
+
+static void clock_bit(uint8_t level)
+{
+	const struct radio_pins_s* pins = radio_devices[0].pins;
+
+	if (level)
+		P2IN |= pins->data;
+	else
+		P2IN &= ~pins->data;
+	P2IFG |= pins->data_clk;
+	ph_irq_handler();
+}
+
+// clock idle bits and optionally a frame, then tick, returns 1 if health_poll kicked the watchdog
+static int tick(uint32_t bits, int with_frame)
+{
+	uint32_t n;
+
+	for (n = 0; n < bits; n++)
+		clock_bit(0);
+	if (with_frame) {
+		for (n = 0; n < frame_bits; n++)
+			clock_bit(frame[n]);
+		for (n = 0; n < 32; n++)			// line idles in last level of frame
+			clock_bit(frame[frame_bits - 1]);
+	}
+	ph_poll();
+	while (fifo_get_packet())
+		fifo_remove_packet();
+
+	WDTCTL = 0x5a5a;						// marks whether watchdog was kicked
+	event_flags = 0;						// events of packet handler aren't of interest
+	health_timer_isr();
+	CHECK(event_take() == EVENT_TICK, "timer didn't post tick");
+	health_poll();
+	return WDTCTL == TEST_WATCHDOG;
+}
+
+// power on or watchdog reset, packet handler and supervision start over
+static void reset(uint8_t power_on)
+{
+	ph_stop();
+	IFG1 = power_on ? PORIFG : 0;
+	health_init();
+	IFG1 = 0;
+	ph_start();
+	health_start();
+}
+
+static void make_frame(void)
+{
+	uint8_t payload[TEST_PAYLOAD];
+	uint8_t level = 0;
+	uint8_t i;
+
+	for (i = 0; i < TEST_PAYLOAD; i++)
+		payload[i] = i * 7 + 3;
+	frame_bits = ais_tx_frame(frame, &level, payload, TEST_PAYLOAD);
+}
+
+static void test_start(void)
+{
+	reset(1);
+	CHECK(WDTCTL == TEST_WATCHDOG, "watchdog not started");
+	CHECK(health_stats.resets == 0, "%u resets after power on", health_stats.resets);
+	CHECK(TA1CCR0 == HEALTH_TICK - 1 && (TA1CCTL0 & CCIE) && (TA1CTL & MC_1), "tick timer not started");
+	printf("watchdog and tick started\n");
+}
+
+// DATA_CLK stops: restart RX, configure radio, reset MCU, each after HEALTH_STALL_TICKS
+static void test_stall(void)
+{
+	struct health_stats_s before = health_stats;
+	uint32_t starts = radio_mock[0].start_rx;
+	uint32_t configures = radio_mock[0].configures;
+	uint8_t n;
+
+	for (n = 1; n < HEALTH_STALL_TICKS; n++)
+		CHECK(tick(0, 0), "stall: watchdog not kicked");
+	CHECK(health_stats.restarts == before.restarts, "stall: restart after %u ticks", n - 1);
+	tick(0, 0);
+	CHECK(health_stats.restarts == before.restarts + 1 && radio_mock[0].start_rx > starts, "stall: RX not restarted");
+
+	for (n = 0; n < HEALTH_STALL_TICKS; n++)
+		tick(0, 0);
+	CHECK(health_stats.configures == before.configures + 1 && radio_mock[0].configures == configures + 1,
+			"stall: radio not configured");
+
+	for (n = 1; n < HEALTH_STALL_TICKS; n++)
+		tick(0, 0);
+	CHECK(tick(0, 0) == 0 && WDTCTL == 0, "stall: MCU not reset");
+	CHECK(health_stats.resets == before.resets + 1, "stall: %u resets", health_stats.resets);
+
+	reset(0);
+	CHECK(health_stats.resets == before.resets + 1, "stall: reset count lost by watchdog reset");
+	CHECK(tick(HEALTH_MIN_CLOCKS, 0) && health_stats.restarts == before.restarts + 1, "stall: recovery after reset");
+	reset(1);
+	CHECK(health_stats.resets == 0, "stall: %u resets after power on", health_stats.resets);
+	printf("stalled radio recovered by RX restart, configuration and reset\n");
+}
+
+// a sync proves the radio receives, recovery starts over at first tier
+static void test_sync(void)
+{
+	struct health_stats_s before = health_stats;
+	uint8_t n;
+
+	for (n = 0; n < HEALTH_STALL_TICKS; n++)
+		tick(0, 0);
+	CHECK(health_stats.restarts == before.restarts + 1, "sync: RX not restarted");
+	tick(HEALTH_MIN_CLOCKS, 1);
+	for (n = 0; n < HEALTH_STALL_TICKS; n++)
+		tick(0, 0);
+	CHECK(health_stats.restarts == before.restarts + 2 && health_stats.configures == before.configures,
+			"sync: tier not reset, %u restarts, %u configures", health_stats.restarts - before.restarts,
+			health_stats.configures - before.configures);
+	tick(HEALTH_MIN_CLOCKS, 1);
+	printf("sync returned radio to first tier\n");
+}
+
+// a command given up on CTS recovers on next tick
+static void test_timeout(void)
+{
+	struct health_stats_s before = health_stats;
+
+	tick(HEALTH_MIN_CLOCKS, 0);
+	CHECK(health_stats.restarts == before.restarts, "timeout: restart without fault");
+	radio_devices[0].cts_timeouts++;
+	tick(HEALTH_MIN_CLOCKS, 0);
+	CHECK(health_stats.restarts == before.restarts + 1, "timeout: RX not restarted");
+	tick(HEALTH_MIN_CLOCKS, 1);
+	printf("CTS timeout recovered by RX restart\n");
+}
+
+// no sync in a quiet area: restart RX, then configure radio, but never reset MCU
+static void test_silence(void)
+{
+	struct health_stats_s before = health_stats;
+	uint32_t n;
+	uint8_t i;
+
+	for (i = 0; i < 4; i++) {
+		for (n = 0; n < HEALTH_SYNC_TICKS; n++)
+			CHECK(tick(HEALTH_MIN_CLOCKS, 0), "silence: watchdog not kicked");
+	}
+	CHECK(health_stats.restarts == before.restarts + 1 && health_stats.configures == before.configures + 3
+			&& health_stats.resets == before.resets, "silence: %u restarts, %u configures, %u resets",
+			health_stats.restarts - before.restarts, health_stats.configures - before.configures,
+			health_stats.resets - before.resets);
+	tick(HEALTH_MIN_CLOCKS, 1);
+	printf("silence recovered by RX restart and configuration, no reset\n");
+}
+
+// stopped packet handler, e.g. during SURVEY, isn't supervised
+static void test_stopped(void)
+{
+	struct health_stats_s before = health_stats;
+	uint8_t n;
+
+	ph_stop();
+	for (n = 0; n < 2 * HEALTH_STALL_TICKS; n++)
+		CHECK(tick(0, 0), "stopped: watchdog not kicked");
+	CHECK(memcmp(&before, &health_stats, sizeof(before)) == 0, "stopped: recovery while stopped");
+	ph_start();
+	for (n = 1; n < HEALTH_STALL_TICKS; n++)
+		tick(0, 0);
+	CHECK(memcmp(&before, &health_stats, sizeof(before)) == 0, "stopped: ticks while stopped counted");
+	tick(HEALTH_MIN_CLOCKS, 1);
+	printf("stopped packet handler not supervised\n");
+}
+
+// a long command re-posts itself after each step, the tick must still get through
+static void test_continue(void)
+{
+	uint8_t n;
+
+	event_flags = 0;
+	for (n = 0; n < 3; n++) {
+		event_post(EVENT_CONTINUE);			// like main loop after a step of SURVEY
+		health_timer_isr();
+		CHECK(event_take() == EVENT_TICK, "continue: tick %u held off by command", n);
+		CHECK(event_take() == EVENT_CONTINUE, "continue: command lost");
+	}
+	event_post(EVENT_COMMAND);
+	event_post(EVENT_CONTINUE);
+	CHECK(event_take() == EVENT_COMMAND, "continue: new line after continuation");
+	event_flags = 0;
+	printf("tick gets through continued command\n");
+}
+
+int main(int argc, char* argv[])
+{
+	make_frame();
+	ph_setup();
+
+	test_start();
+	test_stall();
+	test_sync();
+	test_timeout();
+	test_silence();
+	test_stopped();
+	test_continue();
+
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
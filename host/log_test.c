@@ -0,0 +1,340 @@
+/*
+ * Tests the store-and-forward log against the emulated flash controller
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Covers an empty log, wrapping around all segments many times, replay order and content, finding the
+ * write position again after a reset, dropping records when segments aren't erased ahead, clearing, and power loss
+ * at every flash operation of appending a record. Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "fifo.h"
+#include "flash.h"
+#include "flash_host.h"
+#include "log.h"
+
+#define LOG_FIRST_SEGMENT	24				// 0xf000 is segment 24 of main memory from 0xc000
+
+static unsigned failures = 0;
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static uint8_t packet_size(uint32_t n)
+{
+	return 10 + n % 50;
+}
+
+static uint8_t packet_byte(uint32_t n, uint8_t i)
+{
+	return n * 7 + i * 13;
+}
+
+// packet n into FIFO as packet handler would: channel, payload, CRC
+static void make_packet(uint32_t n)
+{
+	uint8_t i;
+
+	fifo_reset();
+	fifo_new_packet();
+	fifo_write_byte(n & 1);
+	for (i = 0; i < packet_size(n); i++)
+		fifo_write_byte(packet_byte(n, i));
+	fifo_write_byte(0x55);
+	fifo_write_byte(0xaa);
+	fifo_commit_packet();
+}
+
+// log packet n received at second n, returns 1 if stored
+static uint8_t log_n(uint32_t n, uint32_t offset)
+{
+	uint8_t stored;
+
+	make_packet(n);
+	stored = log_packet(-(int8_t) (n % 100), n - offset);
+	fifo_remove_packet();
+	return stored;
+}
+
+// record holds packet n
+static int record_is(const struct log_record_s* record, uint32_t n)
+{
+	uint8_t i;
+
+	if (record->size != packet_size(n) || record->channel != (n & 1) || record->rssi != -(int8_t) (n % 100))
+		return 0;
+	for (i = 0; i < record->size; i++) {
+		if (record->payload[i] != packet_byte(n, i))
+			return 0;
+	}
+	return 1;
+}
+
+static uint32_t main_erases(void)
+{
+	uint32_t sum = 0;
+	uint8_t i;
+	for (i = 0; i < FLASH_HOST_MAIN_SEGMENTS; i++)
+		sum += flash_host_main_erases[i];
+	return sum;
+}
+
+// main flash outside of log is never touched
+static int program_untouched(void)
+{
+	uint16_t i;
+	for (i = 0; i < FLASH_HOST_MAIN_SEGMENTS; i++) {
+		if ((i < LOG_FIRST_SEGMENT || i >= LOG_FIRST_SEGMENT + LOG_SEGMENTS) && flash_host_main_erases[i])
+			return 0;
+	}
+	for (i = 0; i < LOG_FIRST_SEGMENT * FLASH_MAIN_SEGMENT_SIZE; i++) {
+		if (FLASH_MAIN_MEMORY[i] != 0xff)
+			return 0;
+	}
+	return 1;
+}
+
+// replay whole log, records must be packets first..last in order, returns number of records
+static uint32_t replay_check(const char* test, uint32_t since, uint32_t* first, uint32_t* last)
+{
+	const struct log_record_s* record;
+	uint32_t count = 0;
+
+	log_replay_start(since);
+	while ((record = log_replay_next()) != 0) {
+		uint32_t n = record->time;
+		if (count == 0)
+			*first = n;
+		else if (n != *last + 1) {
+			CHECK(0, "%s: record %u follows %u", test, n, *last);
+			return count;
+		}
+		if (!record_is(record, n)) {
+			CHECK(0, "%s: record %u corrupt", test, n);
+			return count;
+		}
+		*last = n;
+		count++;
+	}
+	return count;
+}
+
+static void test_empty(void)
+{
+	uint32_t first = 0, last = 0;
+
+	flash_host_reset();
+	log_init();
+	CHECK(log_records() == 0, "empty: %u records", log_records());
+	CHECK(replay_check("empty", 0, &first, &last) == 0, "empty: replayed records");
+	CHECK(log_poll() == 0, "empty: erased blank flash");
+
+	CHECK(log_n(0, 0) == 1, "empty: first record dropped");
+	CHECK(log_records() == 1 && replay_check("empty", 0, &first, &last) == 1 && first == 0, "empty: first record not replayed");
+}
+
+static void test_wrap(uint32_t packets)
+{
+	uint32_t n, first = 0, last = 0, count, erases, min = 0xffffffff, max = 0;
+	uint8_t i;
+
+	flash_host_reset();
+	log_init();
+	log_dropped = 0;
+	for (n = 0; n < packets; n++) {
+		erases = main_erases();
+		CHECK(log_n(n, 0) == 1, "wrap: record %u dropped", n);
+		CHECK(main_erases() == erases, "wrap: log_packet erased flash");
+		log_poll();
+	}
+
+	count = replay_check("wrap", 0, &first, &last);
+	CHECK(last == packets - 1, "wrap: newest record %u, expected %u", last, packets - 1);
+	CHECK(count == log_records(), "wrap: replayed %u of %u records", count, log_records());
+	CHECK(count * (8 + 35) > (LOG_SEGMENTS - 2) * FLASH_MAIN_SEGMENT_SIZE, "wrap: only %u records kept", count);
+
+	// recent records only
+	CHECK(replay_check("since", log_time(packets) - 10, &first, &last) == 10 && first == packets - 10, "since: wrong records");
+
+	for (i = 0; i < LOG_SEGMENTS; i++) {
+		uint32_t e = flash_host_main_erases[LOG_FIRST_SEGMENT + i];
+		if (e < min)
+			min = e;
+		if (e > max)
+			max = e;
+	}
+	printf("%u records, %u kept: %u..%u erases per segment\n", packets, count, min, max);
+	CHECK(max - min <= 1, "wrap: uneven wear");
+	CHECK(program_untouched(), "wrap: flash outside of log touched");
+	CHECK(flash_host_violations == 0, "wrap: %u writes to bits not erased", flash_host_violations);
+	CHECK(log_dropped == 0, "wrap: %u records dropped", log_dropped);
+}
+
+// after a reset the log continues where it was
+static void test_reset(void)
+{
+	uint32_t n, first = 0, last = 0, first2 = 0, last2 = 0, count;
+
+	flash_host_reset();
+	log_init();
+	for (n = 0; n < 300; n++) {
+		log_n(n, 0);
+		log_poll();
+	}
+	count = replay_check("reset", 0, &first, &last);
+
+	log_init();
+	CHECK(replay_check("reset", 0, &first2, &last2) == count && first2 == first && last2 == last, "reset: log differs");
+	CHECK(log_time(0) == last + 1, "reset: time continues at %u, expected %u", log_time(0), last + 1);
+
+	// receiver time starts at 0 again
+	for (n = 300; n < 400; n++) {
+		log_n(n, 300);
+		log_poll();
+	}
+	replay_check("reset", 0, &first, &last);
+	CHECK(last == 399, "reset: newest record %u after reset", last);
+	CHECK(flash_host_violations == 0, "reset: %u writes to bits not erased", flash_host_violations);
+}
+
+// without log_poll, records are dropped once the segment ahead isn't erased
+static void test_drop(void)
+{
+	uint32_t n, dropped = 0, first = 0, last = 0, erases;
+
+	flash_host_reset();
+	log_init();
+	for (n = 0; n < 300; n++) {						// wrap around once
+		log_n(n, 0);
+		log_poll();
+	}
+	log_dropped = 0;
+	erases = main_erases();
+	for (n = 300; n < 400; n++) {
+		if (!log_n(n, 0))
+			dropped++;
+	}
+	CHECK(main_erases() == erases, "drop: log_packet erased flash");
+	CHECK(dropped > 0 && dropped == log_dropped, "drop: %u dropped, counted %u", dropped, log_dropped);
+
+	log_poll();										// erase ahead, then records are stored again
+	CHECK(log_n(400, 0) == 1, "drop: record not stored after log_poll");
+	replay_check("drop", log_time(400), &first, &last);
+	CHECK(last == 400, "drop: newest record %u", last);
+	CHECK(flash_host_violations == 0, "drop: %u writes to bits not erased", flash_host_violations);
+}
+
+// LOG CLEAR removes records at once and leaves erasing to log_poll, also across a reset
+static void test_clear(void)
+{
+	uint32_t n, first = 0, last = 0, erases;
+	uint8_t polls;
+
+	flash_host_reset();
+	log_init();
+	for (n = 0; n < 300; n++) {						// all segments in use
+		log_n(n, 0);
+		log_poll();
+	}
+	erases = main_erases();
+	log_clear();
+	CHECK(main_erases() == erases, "clear: log_clear erased flash");
+	CHECK(log_records() == 0 && replay_check("clear", 0, &first, &last) == 0, "clear: records left");
+	CHECK(log_n(300, 0) == 0, "clear: record stored before segment was erased");
+
+	log_poll();										// segment ahead first
+	CHECK(log_n(301, 0) == 1, "clear: record dropped after log_poll");
+	log_init();										// reset before the other segments were erased
+	for (polls = 0; log_poll(); polls++)
+		;
+	CHECK(polls == LOG_SEGMENTS - 2, "clear: %u segments erased after reset", polls);	// one was blank ahead
+	for (n = 302; n < 600; n++) {					// receiver time starts at 0 again
+		CHECK(log_n(n, 302) == 1, "clear: record %u dropped", n);
+		log_poll();
+	}
+	CHECK(replay_check("clear", 0, &first, &last) > 0 && last == 599, "clear: newest record %u", last);
+	CHECK(flash_host_violations == 0, "clear: %u writes to bits not erased", flash_host_violations);
+}
+
+// power loss after every flash operation of log_packet and log_poll
+static void test_power_loss(uint32_t packets)
+{
+	uint32_t n, lost = 0, kept = 0;
+	long budget;
+
+	for (n = 0; n < packets; n++) {
+		for (budget = 0; ; budget++) {
+			uint32_t k, first = 0, last = 0, count;
+
+			flash_host_reset();
+			log_init();
+			for (k = 0; k < n; k++) {
+				log_n(k, 0);
+				log_poll();
+			}
+
+			flash_host_budget = budget;
+			log_n(n, 0);
+			log_poll();
+			if (!flash_host_power_lost()) {
+				flash_host_budget = -1;
+				break;
+			}
+			flash_host_budget = -1;
+
+			// power is back, interrupted record is skipped or complete
+			log_init();
+			count = replay_check("power loss", 0, &first, &last);
+			if (count && last == n)
+				kept++;
+			else if (count == 0 || last == n - 1)
+				lost++;
+			else {
+				CHECK(0, "power loss: record %u budget %ld, newest record %u", n, budget, last);
+				return;
+			}
+
+			// logging has to continue, receiver time starts at 0 again
+			log_poll();
+			log_n(n + 1, log_time(0));
+			log_poll();
+			log_n(n + 2, log_time(0));
+			count = replay_check("power loss", n + 1, &first, &last);
+			CHECK(count == 2 && last == n + 2, "power loss: record %u budget %ld, no records after power loss", n, budget);
+		}
+	}
+	printf("power loss during %u records: %u times lost, %u times kept\n", packets, lost, kept);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t packets = 10000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, 0, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n records]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	test_empty();
+	test_wrap(packets);
+	test_reset();
+	test_drop();
+	test_clear();
+	test_power_loss(120);
+
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * Host emulation of the MSP430G2553 peripherals used by the dAISy firmware
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+
+// digital I/O ports
+volatile uint8_t P1IN, P1OUT, P1SEL, P1SEL2, P1DIR, P1IFG, P1IE, P1IES;
+volatile uint8_t P2IN, P2OUT, P2SEL, P2SEL2, P2DIR, P2IFG, P2IE, P2IES;
+volatile uint8_t P3IN, P3OUT, P3SEL, P3SEL2, P3DIR;
+
+// clocks, watchdog and timers
+volatile uint8_t BCSCTL1, BCSCTL2, BCSCTL3, IFG1;
+volatile uint16_t WDTCTL;
+volatile uint16_t TA0CTL, TA0R;
+volatile uint16_t TA1CTL, TA1CCTL0, TA1CCR0;
+
+// SPI
+volatile uint8_t UCB0TXBUF, UCB0STAT;
+uint8_t (*host_spi)(uint8_t mosi) = 0;
+
+uint8_t host_spi_exchange(void)
+{
+	return host_spi ? host_spi(UCB0TXBUF) : 0xff;
+}
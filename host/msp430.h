@@ -0,0 +1,99 @@
+/*
+ * Host emulation of the MSP430G2553 peripherals used by the dAISy firmware
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Allows compiling the firmware modules (packet_handler.c, fifo.c, nmea.c, ..) for the host,
+ * where registers are plain variables and intrinsics are no-ops.
+ * Host tools compile with -DTEST (radio not accessed) and -I host so that <msp430.h> resolves here.
+ */
+
+#ifndef HOST_MSP430_H_
+#define HOST_MSP430_H_
+
+#include <inttypes.h>
+
+#define BIT0	0x01
+#define BIT1	0x02
+#define BIT2	0x04
+#define BIT3	0x08
+#define BIT4	0x10
+#define BIT5	0x20
+#define BIT6	0x40
+#define BIT7	0x80
+
+#define GIE		BIT3
+#define CPUOFF	BIT4
+#define SCG0	BIT6
+#define SCG1	BIT7
+#define LPM0_bits	(CPUOFF)
+#define LPM3_bits	(SCG1 | SCG0 | CPUOFF)
+
+// interrupt vectors, only used in #pragma vector which is ignored on host
+#define PORT1_VECTOR		1
+#define PORT2_VECTOR		2
+#define TIMER1_A0_VECTOR	3
+#define TIMER0_A1_VECTOR	4
+
+// firmware ISRs become regular functions
+#define __interrupt
+
+// intrinsics
+#define _BIS_SR(x)					((void) (x))	// evaluated like the intrinsic, e.g. a saved GIE
+#define _BIC_SR(x)					((void) (x))
+#define __get_SR_register()	0
+#define _delay_cycles(x)			do {} while (0)
+#define __low_power_mode_3()		do {} while (0)
+#define __low_power_mode_4()		do {} while (0)
+#define __low_power_mode_off_on_exit()	do {} while (0)
+
+// radio_mock.c emulates RSSI and the CCA pin, packet handler uses them with TEST defined
+#define RADIO_MOCK
+
+// information and main memory, flash erase and write are emulated by host/flash_host.c
+#define FLASH_INFO_MEMORY	host_info_memory
+#define FLASH_MAIN_MEMORY	host_main_memory
+extern uint8_t host_info_memory[256];
+extern uint8_t host_main_memory[0x4000];
+
+// digital I/O ports
+extern volatile uint8_t P1IN, P1OUT, P1SEL, P1SEL2, P1DIR, P1IFG, P1IE, P1IES;
+extern volatile uint8_t P2IN, P2OUT, P2SEL, P2SEL2, P2DIR, P2IFG, P2IE, P2IES;
+extern volatile uint8_t P3IN, P3OUT, P3SEL, P3SEL2, P3DIR;
+
+// clocks, watchdog and timers as used by health.c, duty.c and packet_handler.c, WDTCTL holds the last value written
+#define DIVM_0		0x00
+#define DIVM_1		0x10
+#define DIVM_2		0x20
+#define DIVM_3		0x30
+#define LFXT1S_2	0x20
+#define DIVA_3		0x30
+#define WDTPW		0x5A00
+#define WDTCNTCL	0x0008
+#define WDTSSEL		0x0004
+#define PORIFG		0x04
+#define TASSEL_1	0x0100
+#define TASSEL_2	0x0200
+#define MC_1		0x0010
+#define MC_2		0x0020
+#define TACLR		0x0004
+#define TAIE		0x0002
+#define TAIFG		0x0001
+#define CCIE		0x0010
+
+extern volatile uint8_t BCSCTL1, BCSCTL2, BCSCTL3, IFG1;
+extern volatile uint16_t WDTCTL;
+extern volatile uint16_t TA0CTL, TA0R;
+extern volatile uint16_t TA1CTL, TA1CCTL0, TA1CCR0;
+
+// USCI B0 in SPI mode as used by spi.h, a transfer completes at once: TXBUF holds the byte sent, reading RXBUF
+// exchanges it with the device emulated by host_spi, 0xff if there is none
+#define UCBUSY		0x01
+#define UCB0RXBUF	host_spi_exchange()
+extern volatile uint8_t UCB0TXBUF, UCB0STAT;
+extern uint8_t (*host_spi)(uint8_t mosi);
+uint8_t host_spi_exchange(void);
+
+#endif /* HOST_MSP430_H_ */
@@ -0,0 +1,242 @@
+/*
+ * Compares bit-sliced and scalar packet handler: identical packets and throughput
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Random raw bit streams with AIS frames, noise and bit errors are decoded by the firmware
+ * packet handler (ph_process_bit, one stream after the other) and by ph_sliced (all streams at
+ * once). Exit code is 1 if the decoded packets differ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "packet_handler.h"
+#include "ph_sliced.h"
+#include "ais_tx.h"
+
+#define BENCH_BLOCK			4096			// bits per call of ph_sliced_process
+
+struct packet_s {
+	uint16_t stream;
+	uint32_t bit;							// bit index of end flag
+	uint16_t size;
+	uint8_t data[PH_SLICED_MAX_PACKET];
+};
+
+struct packet_list_s {
+	struct packet_s* packets;
+	size_t count;
+	size_t capacity;
+	uint32_t bit;							// index of first bit passed to ph_sliced_process
+};
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+// xorshift64*
+static uint32_t rng_next(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (uint32_t) ((rng_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void list_add(struct packet_list_s* list, uint16_t stream, uint32_t bit, const uint8_t* data, uint16_t size)
+{
+	struct packet_s* p;
+
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity * 2 + 256;
+		list->packets = realloc(list->packets, list->capacity * sizeof(struct packet_s));
+	}
+	p = &list->packets[list->count++];
+	p->stream = stream;
+	p->bit = bit;
+	p->size = size;
+	memcpy(p->data, data, size);
+}
+
+static void sliced_packet(void* arg, uint16_t lane, size_t bit, const uint8_t* data, uint16_t size)
+{
+	struct packet_list_s* list = arg;
+	list_add(list, lane, list->bit + bit, data, size);
+}
+
+static int compare_packets(const void* a, const void* b)
+{
+	const struct packet_s* pa = a;
+	const struct packet_s* pb = b;
+
+	if (pa->stream != pb->stream)
+		return pa->stream < pb->stream ? -1 : 1;
+	if (pa->bit != pb->bit)
+		return pa->bit < pb->bit ? -1 : 1;
+	return 0;
+}
+
+// noise, frames of random size and bit errors
+static void generate_stream(uint8_t* bits, size_t count, float error_rate)
+{
+	uint8_t levels[AIS_TX_MAX_BITS(64)];
+	uint8_t payload[64];
+	uint8_t level = 0;
+	size_t n = 0;
+	uint32_t threshold = (uint32_t) (error_rate * 4294967295.0f);
+
+	while (n < count) {
+		uint16_t idle = rng_next() % 200;
+		uint16_t size = 1 + rng_next() % 64;
+		uint16_t frame, k;
+
+		for (k = 0; k < idle && n < count; k++)
+			bits[n++] = rng_next() & 1;
+
+		for (k = 0; k < size; k++)
+			payload[k] = rng_next();
+		frame = ais_tx_frame(levels, &level, payload, size);
+		for (k = 0; k < frame && n < count; k++)
+			bits[n++] = levels[k] ^ (rng_next() < threshold);
+	}
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n streams      number of streams (default %u)\n"
+		"  -b bits         bits per stream (default 1000000)\n"
+		"  -e rate         bit error rate inside frames (default 0.0005)\n"
+		"  -S seed         random seed\n", name, PH_SLICED_LANES);
+}
+
+int main(int argc, char* argv[])
+{
+	uint16_t nstreams = PH_SLICED_LANES;
+	size_t nbits = 1000000;
+	float error_rate = 0.0005f;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:b:e:S:h")) != -1) {
+		switch (opt) {
+		case 'n': nstreams = atoi(optarg); break;
+		case 'b': nbits = strtoul(optarg, 0, 0); break;
+		case 'e': error_rate = atof(optarg); break;
+		case 'S': rng_state ^= strtoull(optarg, 0, 0) * 0x9e3779b97f4a7c15ULL; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (nstreams < 1 || nstreams > PH_SLICED_LANES || nbits < 1) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	uint8_t** streams = malloc(nstreams * sizeof(uint8_t*));
+	uint8_t channels[PH_SLICED_LANES] = { 0 };
+	uint16_t s;
+
+	for (s = 0; s < nstreams; s++) {
+		streams[s] = malloc(nbits);
+		generate_stream(streams[s], nbits, error_rate);
+		channels[s] = s & 1;
+	}
+
+	// scalar firmware decoder, one stream after the other
+	struct packet_list_s scalar = { 0, 0, 0, 0 };
+	struct ph_context_s ctx;
+	struct fifo_s fifo;
+	double t0 = now();
+
+	for (s = 0; s < nstreams; s++) {
+		size_t n;
+		fifo_ctx_reset(&fifo);
+		ph_context_init(&ctx, &fifo, channels[s]);
+		for (n = 0; n < nbits; n++) {
+			if (ph_process_bit(&ctx, streams[s][n]) & PH_EVENT_RESET) {
+				uint16_t size;
+				while ((size = fifo_ctx_get_packet(&fifo)) != 0) {
+					uint8_t data[PH_SLICED_MAX_PACKET];
+					uint16_t k;
+					for (k = 0; k < size; k++)
+						data[k] = fifo_ctx_read_byte(&fifo);
+					list_add(&scalar, s, n, data, size);
+					fifo_ctx_remove_packet(&fifo);
+				}
+			}
+		}
+	}
+	double t_scalar = now() - t0;
+
+	// bit-sliced decoder, all streams at once
+	struct packet_list_s sliced = { 0, 0, 0, 0 };
+	struct ph_sliced_s* ph = aligned_alloc(sizeof(ph_lane_t), sizeof(struct ph_sliced_s));
+	ph_lane_t* lanes = aligned_alloc(sizeof(ph_lane_t), BENCH_BLOCK * sizeof(ph_lane_t));
+	double t_pack = 0, t_sliced = 0;
+	size_t offset;
+
+	ph_sliced_init(ph, channels, sliced_packet, &sliced);
+	for (offset = 0; offset < nbits; offset += BENCH_BLOCK) {
+		size_t count = nbits - offset < BENCH_BLOCK ? nbits - offset : BENCH_BLOCK;
+
+		t0 = now();
+		ph_sliced_pack(lanes, (const uint8_t* const*) streams, nstreams, offset, count);
+		t_pack += now() - t0;
+
+		t0 = now();
+		sliced.bit = offset;
+		ph_sliced_process(ph, lanes, count);
+		t_sliced += now() - t0;
+	}
+
+	// compare
+	qsort(scalar.packets, scalar.count, sizeof(struct packet_s), compare_packets);
+	qsort(sliced.packets, sliced.count, sizeof(struct packet_s), compare_packets);
+
+	size_t n, mismatch = 0;
+	if (scalar.count != sliced.count)
+		mismatch = 1;
+	for (n = 0; n < scalar.count && n < sliced.count; n++) {
+		struct packet_s* a = &scalar.packets[n];
+		struct packet_s* b = &sliced.packets[n];
+		if (a->stream != b->stream || a->bit != b->bit || a->size != b->size || memcmp(a->data, b->data, a->size)) {
+			if (!mismatch)
+				fprintf(stderr, "first mismatch: stream %u bit %u size %u vs. stream %u bit %u size %u\n",
+						a->stream, a->bit, a->size, b->stream, b->bit, b->size);
+			mismatch++;
+		}
+	}
+
+	double total = (double) nstreams * nbits;
+	printf("%u streams x %zu bits, %u lanes\n", nstreams, nbits, PH_SLICED_LANES);
+	printf("packets: scalar %zu, sliced %zu, %s\n", scalar.count, sliced.count, mismatch ? "MISMATCH" : "identical");
+	printf("scalar:          %8.1f Mbit/s\n", total / t_scalar * 1e-6);
+	printf("sliced:          %8.1f Mbit/s\n", total / t_sliced * 1e-6);
+	printf("sliced + pack:   %8.1f Mbit/s\n", total / (t_sliced + t_pack) * 1e-6);
+
+	for (s = 0; s < nstreams; s++)
+		free(streams[s]);
+	free(streams);
+	free(scalar.packets);
+	free(sliced.packets);
+	free(ph);
+	free(lanes);
+
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Host harness for the firmware packet handler
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "radio.h"
+#include "packet_handler.h"
+#include "ph_host.h"
+
+#define PH_HOST_DATA_CLK_PIN	RADIO_GPIO_2	// wiring of first radio, see RADIO_PINS_0
+#define PH_HOST_DATA_PIN		RADIO_GPIO_3
+
+void ph_irq_handler(void);					// firmware ISR, a regular function on host
+
+// reset FIFO and packet handler, pin decoder to channel (0=A, 1=B)
+void ph_host_start(uint8_t channel)
+{
+	ph_set_hop(1 << channel);				// no hops, RSSI thresholds follow this channel
+	ph_setup();
+	ph_start();
+}
+
+// present one raw (NRZI) bit on DATA pin and clock it into the packet handler
+void ph_host_bit(uint8_t level)
+{
+	if (level)
+		P2IN |= PH_HOST_DATA_PIN;
+	else
+		P2IN &= ~PH_HOST_DATA_PIN;
+
+	P2IFG |= PH_HOST_DATA_CLK_PIN;			// positive edge of DATA_CLK
+	ph_irq_handler();
+}
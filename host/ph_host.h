@@ -0,0 +1,18 @@
+/*
+ * Host harness for the firmware packet handler
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Drives ph_irq_handler with emulated DATA/DATA_CLK pins, so host tools decode with exactly
+ * the same NRZI/HDLC/CRC state machine as the firmware.
+ */
+
+#ifndef PH_HOST_H_
+#define PH_HOST_H_
+
+void ph_host_start(uint8_t channel);		// reset FIFO and packet handler, pin decoder to channel (0=A, 1=B)
+void ph_host_bit(uint8_t level);			// present one raw (NRZI) bit on DATA pin and clock it into the packet handler
+
+#endif /* PH_HOST_H_ */
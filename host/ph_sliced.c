@@ -0,0 +1,276 @@
+/*
+ * Bit-sliced AIS packet handler, decoding 64 (256 with PH_SLICED_AVX2) raw bit streams at once
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "ph_sliced.h"
+
+// same parameters as the packet handler defaults (packet_handler.h)
+#define PH_PREAMBLE_LENGTH	8
+#define PH_SYNC_TIMEOUT		16
+#define PH_MAX_BITS			1020
+
+static const ph_lane_t zero = { 0 };
+
+static inline int lane_any(ph_lane_t v)
+{
+	uint64_t r = 0;
+	uint8_t k;
+	for (k = 0; k < PH_SLICED_WORDS; k++)
+		r |= v[k];
+	return r != 0;
+}
+
+// pick a where mask is set, b otherwise
+static inline ph_lane_t lane_select(ph_lane_t mask, ph_lane_t a, ph_lane_t b)
+{
+	return (a & mask) | (b & ~mask);
+}
+
+// x += 1 in lanes of mask (ripple carry)
+static inline void planes_inc(ph_lane_t* x, uint8_t n, ph_lane_t mask)
+{
+	uint8_t i;
+	for (i = 0; i < n; i++) {
+		ph_lane_t carry = x[i] & mask;
+		x[i] ^= mask;
+		mask = carry;
+	}
+}
+
+// x -= 1 in lanes of mask
+static inline void planes_dec(ph_lane_t* x, uint8_t n, ph_lane_t mask)
+{
+	uint8_t i;
+	for (i = 0; i < n; i++) {
+		ph_lane_t borrow = ~x[i] & mask;
+		x[i] ^= mask;
+		mask = borrow;
+	}
+}
+
+// x = k in lanes of mask
+static inline void planes_set(ph_lane_t* x, uint8_t n, uint32_t k, ph_lane_t mask)
+{
+	uint8_t i;
+	for (i = 0; i < n; i++)
+		x[i] = (k >> i) & 1 ? x[i] | mask : x[i] & ~mask;
+}
+
+// lanes where x == k
+static inline ph_lane_t planes_eq(const ph_lane_t* x, uint8_t n, uint32_t k)
+{
+	ph_lane_t eq = ~zero;
+	uint8_t i;
+	for (i = 0; i < n; i++)
+		eq &= (k >> i) & 1 ? x[i] : ~x[i];
+	return eq;
+}
+
+// lanes where x > k, compare from MSB
+static inline ph_lane_t planes_gt(const ph_lane_t* x, uint8_t n, uint32_t k)
+{
+	ph_lane_t gt = zero, eq = ~zero;
+	uint8_t i = n;
+	while (i--) {
+		if ((k >> i) & 1)
+			eq &= x[i];
+		else {
+			gt |= eq & x[i];
+			eq &= ~x[i];
+		}
+	}
+	return gt;
+}
+
+// call fn for every lane set in mask
+#define FOR_EACH_LANE(mask, lane, ...) do {							\
+		uint8_t word_;													\
+		for (word_ = 0; word_ < PH_SLICED_WORDS; word_++) {				\
+			uint64_t bits_ = (mask)[word_];								\
+			while (bits_) {												\
+				uint16_t lane = word_ * 64 + __builtin_ctzll(bits_);	\
+				bits_ &= bits_ - 1;										\
+				__VA_ARGS__;										\
+			}															\
+		}																\
+	} while (0)
+
+void ph_sliced_init(struct ph_sliced_s* ph, const uint8_t* channels, ph_sliced_packet_f callback, void* arg)
+{
+	memset(ph, 0, sizeof(*ph));
+	ph->st_reset = ~zero;
+	ph->sy_reset = ~zero;
+	if (channels)
+		memcpy(ph->channel, channels, PH_SLICED_LANES);
+	ph->callback = callback;
+	ph->arg = arg;
+}
+
+void ph_sliced_process(struct ph_sliced_s* ph, const ph_lane_t* bits, size_t count)
+{
+	size_t t;
+	uint8_t i;
+
+	for (t = 0; t < count; t++) {
+		ph_lane_t in = bits[t];
+		ph_lane_t bit = ~(ph->prev ^ in);				// NRZI decoding
+		ph_lane_t old_reset = ph->st_reset, old_wait = ph->st_wait;
+		ph_lane_t old_prefetch = ph->st_prefetch, old_receive = ph->st_receive;
+		ph_lane_t next_reset = zero, next_wait = zero, next_prefetch = zero, next_receive = zero;
+
+		ph->prev = in;
+		ph->head = (ph->head + 1) & 15;
+		ph->bitstream[ph->head] = bit;					// bit 15 of rx_bitstream, bit 15-j is head-j
+
+		// STATE: RESET, prepare state machine for next packet
+		if (lane_any(old_reset)) {
+			planes_set(ph->bit_count, 11, 0, old_reset);
+			ph->sy_reset |= old_reset;
+			ph->sy_0 &= ~old_reset;
+			ph->sy_1 &= ~old_reset;
+			ph->sy_flag &= ~old_reset;
+			next_wait |= old_reset;
+		}
+
+		// STATE: WAIT FOR PREAMBLE AND START FLAG
+		if (lane_any(old_wait)) {
+			ph_lane_t sr = old_wait & ph->sy_reset;
+			ph_lane_t s0 = old_wait & ph->sy_0;
+			ph_lane_t s1 = old_wait & ph->sy_1;
+			ph_lane_t sf = old_wait & ph->sy_flag;
+			ph_lane_t preamble = planes_gt(ph->sync_count, 8, PH_PREAMBLE_LENGTH);
+
+			planes_inc(ph->bit_count, 11, old_wait);
+
+			// sync reset: time out or start new preamble
+			ph_lane_t timeout = sr & planes_gt(ph->bit_count, 11, PH_SYNC_TIMEOUT);
+			ph_lane_t start = sr & ~timeout;
+			planes_set(ph->sync_count, 8, 0, start);
+
+			// alternating bits extend preamble, repeated bit after sufficient preamble is part of start flag
+			ph_lane_t s0_one = s0 & bit, s0_zero = s0 & ~bit;
+			ph_lane_t s1_zero = s1 & ~bit, s1_one = s1 & bit;
+			planes_inc(ph->sync_count, 8, s0_one | s1_zero);
+			planes_set(ph->sync_count, 8, 7, s0_zero & preamble);
+			planes_set(ph->sync_count, 8, 5, s1_one & preamble);
+
+			// start flag: expect 1s, last bit 0
+			planes_dec(ph->sync_count, 8, sf);
+			ph_lane_t last = sf & planes_eq(ph->sync_count, 8, 0);
+			ph_lane_t flag_ok = last & ~bit;
+			ph_lane_t flag_more = sf & ~last & bit;
+			ph_lane_t flag_fail = sf & ~flag_more & ~flag_ok;
+
+			ph_lane_t to_reset = ((s0_zero | s1_one) & ~preamble) | flag_fail;
+			ph_lane_t to_0 = (start & ~bit) | s1_zero;
+			ph_lane_t to_1 = (start & bit) | s0_one;
+			ph_lane_t to_flag = ((s0_zero | s1_one) & preamble) | flag_more;
+			ph->sy_reset = lane_select(old_wait, to_reset, ph->sy_reset);
+			ph->sy_0 = lane_select(old_wait, to_0, ph->sy_0);
+			ph->sy_1 = lane_select(old_wait, to_1, ph->sy_1);
+			ph->sy_flag = lane_select(old_wait, to_flag, ph->sy_flag);
+
+			planes_set(ph->bit_count, 11, 0, flag_ok);
+			next_reset |= timeout;
+			next_prefetch |= flag_ok;
+			next_wait |= old_wait & ~timeout & ~flag_ok;
+		}
+
+		// STATE: PREFETCH FIRST PACKET BYTE
+		if (lane_any(old_prefetch)) {
+			planes_inc(ph->bit_count, 11, old_prefetch);
+			ph_lane_t done = old_prefetch & planes_eq(ph->bit_count, 11, 8);
+			if (lane_any(done)) {
+				planes_set(ph->bit_count, 11, 0, done);
+				planes_set(ph->one_count, 3, 0, done);
+				planes_set(ph->data_byte, 8, 0, done);
+				planes_set(ph->crc, 16, 0xffff, done);
+				FOR_EACH_LANE(done, lane, {						// packet starts with channel
+					ph->packet[lane][0] = ph->channel[lane];
+					ph->length[lane] = 1;
+				});
+			}
+			next_receive |= done;
+			next_prefetch |= old_prefetch & ~done;
+		}
+
+		// STATE: RECEIVE PACKET
+		if (lane_any(old_receive)) {
+			ph_lane_t b = ph->bitstream[(ph->head - 8) & 15];	// bit 7 of rx_bitstream
+			ph_lane_t stuff = old_receive & planes_eq(ph->one_count, 3, 5);
+			ph_lane_t stuff_error = stuff & b;
+			ph_lane_t data = old_receive & ~stuff;				// stuff bits are dropped, nothing else happens
+			ph_lane_t fb = b ^ ph->crc[0];
+
+			planes_set(ph->one_count, 3, 0, (stuff & ~b) | (data & ~b));
+			planes_inc(ph->one_count, 3, data & b);
+
+			for (i = 0; i < 7; i++)							// shift bit into data byte, LSB first
+				ph->data_byte[i] = lane_select(data, ph->data_byte[i + 1], ph->data_byte[i]);
+			ph->data_byte[7] = lane_select(data, b, ph->data_byte[7]);
+
+			for (i = 0; i < 15; i++)						// CCITT CRC, polynomial 0x8408 has bits 3, 10 and 15
+				ph->crc[i] = lane_select(data, (i == 3 || i == 10) ? ph->crc[i + 1] ^ fb : ph->crc[i + 1], ph->crc[i]);
+			ph->crc[15] = lane_select(data, fb, ph->crc[15]);
+
+			ph_lane_t byte = data & ph->bit_count[0] & ph->bit_count[1] & ph->bit_count[2];	// every 8th bit
+			if (lane_any(byte)) {
+				FOR_EACH_LANE(byte, lane, {
+					uint8_t value = 0;
+					uint8_t w = lane / 64, s = lane % 64;
+					for (i = 0; i < 8; i++)
+						value |= ((ph->data_byte[i][w] >> s) & 1) << i;
+					if (ph->length[lane] < PH_SLICED_MAX_PACKET)
+						ph->packet[lane][ph->length[lane]++] = value;
+				});
+				planes_set(ph->data_byte, 8, 0, byte);
+			}
+
+			planes_inc(ph->bit_count, 11, data);
+
+			// end flag 0x7e in bits 15..8 of rx_bitstream
+			ph_lane_t flag = data & ~ph->bitstream[(ph->head - 7) & 15] & ~ph->bitstream[ph->head];
+			for (i = 1; i < 7; i++)
+				flag &= ph->bitstream[(ph->head - 7 + i) & 15];
+
+			if (lane_any(flag)) {
+				ph_lane_t commit = flag & planes_eq(ph->crc, 16, 0xf0b8);
+				FOR_EACH_LANE(commit, lane, {
+					if (ph->length[lane] < PH_SLICED_MAX_PACKET)	// firmware FIFO can't hold a full buffer
+						ph->callback(ph->arg, lane, t, ph->packet[lane], ph->length[lane]);
+				});
+			}
+
+			ph_lane_t too_long = data & ~flag & planes_gt(ph->bit_count, 11, PH_MAX_BITS);
+			ph_lane_t end = stuff_error | flag | too_long;
+			next_reset |= end;
+			next_receive |= old_receive & ~end;
+		}
+
+		ph->st_reset = next_reset;
+		ph->st_wait = next_wait;
+		ph->st_prefetch = next_prefetch;
+		ph->st_receive = next_receive;
+	}
+}
+
+void ph_sliced_pack(ph_lane_t* out, const uint8_t* const* streams, uint16_t nstreams, size_t offset, size_t count)
+{
+	size_t n;
+	uint16_t s;
+
+	memset(out, 0, count * sizeof(ph_lane_t));
+	for (s = 0; s < nstreams && s < PH_SLICED_LANES; s++) {
+		const uint8_t* src = streams[s] + offset;
+		uint8_t w = s / 64, shift = s % 64;
+		for (n = 0; n < count; n++)
+			out[n][w] |= (uint64_t) (src[n] & 1) << shift;
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ * Bit-sliced AIS packet handler, decoding 64 (256 with PH_SLICED_AVX2) raw bit streams at once
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Same NRZI, preamble and start flag detection, de-stuffing and CRC as ph_process_bit() in
+ * packet_handler.c, with every state variable stored as bit planes: bit n of a plane belongs to
+ * stream (lane) n, and all lanes step with the same branch-free logic.
+ */
+
+#ifndef PH_SLICED_H_
+#define PH_SLICED_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef PH_SLICED_AVX2
+#define PH_SLICED_WORDS		4				// 64 bit words per plane
+#else
+#define PH_SLICED_WORDS		1
+#endif
+#define PH_SLICED_LANES		(64 * PH_SLICED_WORDS)
+#define PH_SLICED_MAX_PACKET	128			// bytes incl. channel, same as firmware FIFO_BUFFER_SIZE
+
+typedef uint64_t ph_lane_t __attribute__((vector_size(8 * PH_SLICED_WORDS)));	// allocate with aligned_alloc
+
+// called for each packet with CRC ok: channel, payload and CRC, as the firmware stores it in the FIFO
+// bit is the index of the last bit of the end flag in the bits passed to ph_sliced_process
+typedef void (*ph_sliced_packet_f)(void* arg, uint16_t lane, size_t bit, const uint8_t* data, uint16_t size);
+
+struct ph_sliced_s {
+	ph_lane_t prev;							// previous raw bit for NRZI decoding
+	ph_lane_t bitstream[16];				// ring of decoded bits, rx_bitstream of firmware
+	uint8_t head;							// ring index of newest bit
+	ph_lane_t st_reset;						// packet handler states, one-hot
+	ph_lane_t st_wait;
+	ph_lane_t st_prefetch;
+	ph_lane_t st_receive;
+	ph_lane_t sy_reset;						// sync states while waiting, one-hot
+	ph_lane_t sy_0;
+	ph_lane_t sy_1;
+	ph_lane_t sy_flag;
+	ph_lane_t bit_count[11];				// counters and registers as bit planes, LSB first
+	ph_lane_t sync_count[8];
+	ph_lane_t one_count[3];
+	ph_lane_t data_byte[8];
+	ph_lane_t crc[16];
+	uint8_t channel[PH_SLICED_LANES];		// channel stored with packets of lane
+	uint16_t length[PH_SLICED_LANES];		// bytes of current packet
+	uint8_t packet[PH_SLICED_LANES][PH_SLICED_MAX_PACKET];
+	ph_sliced_packet_f callback;
+	void* arg;
+};
+
+void ph_sliced_init(struct ph_sliced_s* ph, const uint8_t* channels, ph_sliced_packet_f callback, void* arg);	// channels may be 0 for all A
+void ph_sliced_process(struct ph_sliced_s* ph, const ph_lane_t* bits, size_t count);	// bits[n] holds raw bit n of all lanes
+
+// transpose raw bits (one byte per bit) of up to PH_SLICED_LANES streams into lane words
+void ph_sliced_pack(ph_lane_t* out, const uint8_t* const* streams, uint16_t nstreams, size_t offset, size_t count);
+
+#endif /* PH_SLICED_H_ */
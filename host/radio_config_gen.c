@@ -0,0 +1,226 @@
+/*
+ * Generates and checks the compact radio configuration stream of radio_config_compact.h
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * The WDS array of radio_config.h sets each group of properties twice, once for image rejection calibration
+ * and again after IRCAL, and writes properties that already hold the value. This tool replays the array
+ * against a model of the radio's properties. Commands other than SET_PROPERTY are kept in place. Property
+ * writes between them are reduced to the properties that change, sorted, and merged into SET_PROPERTY
+ * commands of up to 12 contiguous properties, bridging gaps whose value is already known.
+ *
+ * Without arguments, the stream of radio_config_compact.h is checked: every command other than SET_PROPERTY
+ * must see the same property values as with the WDS array, and so must the end of the stream. With -g the
+ * header is written to stdout instead. Exit code is 1 if the check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "radio_config.h"
+#include "radio_config_compact.h"
+
+#define CMD_POWER_UP		0x02
+#define CMD_SET_PROPERTY	0x11
+#define MAX_PROPERTIES		12			// per SET_PROPERTY command
+
+static const uint8_t wds[] = RADIO_CONFIGURATION_DATA_ARRAY;
+static const uint8_t compact[] = RADIO_CONFIGURATION_COMPACT_ARRAY;
+
+// property values by group << 8 | number, -1 if unknown (reset default)
+struct properties_s {
+	int16_t value[0x10000];
+};
+
+// properties written since last command other than SET_PROPERTY
+static struct properties_s pending;
+
+static void forget(struct properties_s* p)
+{
+	memset(p->value, 0xff, sizeof(p->value));
+}
+
+static const char* command_name(uint8_t cmd)
+{
+	switch (cmd) {
+	case CMD_POWER_UP: return "POWER_UP";
+	case 0x13: return "GPIO_PIN_CFG";
+	case 0x17: return "IRCAL";
+	case 0x32: return "START_RX";
+	default: return "command";
+	}
+}
+
+// apply command to property model, returns 1 if it's a SET_PROPERTY
+static uint8_t apply(struct properties_s* p, const uint8_t* command)
+{
+	uint8_t i;
+
+	if (command[0] == CMD_POWER_UP)
+		forget(p);
+	if (command[0] != CMD_SET_PROPERTY)
+		return 0;
+	for (i = 0; i < command[2]; i++)
+		p->value[(command[1] << 8) + command[3] + i] = command[4 + i];
+	return 1;
+}
+
+// replay two streams, compare properties at every other command and at the end, returns number of differences
+static unsigned compare(const uint8_t* a, const uint8_t* b)
+{
+	static struct properties_s pa, pb;
+	unsigned differences = 0;
+	uint32_t i;
+
+	forget(&pa);
+	forget(&pb);
+	while (1) {
+		while (*a && apply(&pa, a + 1))
+			a += *a + 1;
+		while (*b && apply(&pb, b + 1))
+			b += *b + 1;
+		for (i = 0; i < 0x10000; i++) {
+			if (pa.value[i] != pb.value[i]) {
+				fprintf(stderr, "property 0x%02x 0x%02x is %d instead of %d before %s\n", i >> 8, i & 0xff,
+						pb.value[i], pa.value[i], *a ? command_name(a[1]) : "end");
+				differences++;
+			}
+		}
+		if (!*a || !*b) {
+			if (*a || *b) {
+				fprintf(stderr, "streams have different commands\n");
+				differences++;
+			}
+			return differences;
+		}
+		if (*a != *b || memcmp(a, b, *a + 1)) {
+			fprintf(stderr, "%s differs\n", command_name(a[1]));
+			differences++;
+		}
+		apply(&pa, a + 1);
+		apply(&pb, b + 1);
+		a += *a + 1;
+		b += *b + 1;
+	}
+}
+
+static void count(const uint8_t* stream, unsigned* commands, unsigned* bytes)
+{
+	*commands = 0;
+	*bytes = 0;
+	while (*stream) {
+		(*commands)++;
+		*bytes += *stream;
+		stream += *stream + 1;
+	}
+}
+
+static void emit(const uint8_t* command, uint8_t length)
+{
+	uint8_t i;
+
+	printf("\t0x%02X,", length);
+	for (i = 0; i < length; i++)
+		printf(" 0x%02X,", command[i]);
+	if (command[0] == CMD_SET_PROPERTY)
+		printf("\t/* group 0x%02X, 0x%02X..0x%02X */ \\\n", command[1], command[3], command[3] + command[2] - 1);
+	else
+		printf("\t/* %s */ \\\n", command_name(command[0]));
+}
+
+// write properties of pending that change known, merged into as few SET_PROPERTY commands as possible
+static void flush(struct properties_s* known)
+{
+	uint8_t command[4 + MAX_PROPERTIES];
+	uint32_t i = 0;
+
+	while (i < 0x10000) {
+		uint32_t start, end, j;
+		if (pending.value[i] < 0 || pending.value[i] == known->value[i]) {
+			i++;
+			continue;
+		}
+		// extend run to last changed property reachable through known values within MAX_PROPERTIES
+		start = end = i;
+		for (j = i + 1; j < start + MAX_PROPERTIES && (j & 0xff) != 0; j++) {
+			int16_t value = pending.value[j] >= 0 ? pending.value[j] : known->value[j];
+			if (value < 0)
+				break;
+			if (value != known->value[j])
+				end = j;
+		}
+		command[0] = CMD_SET_PROPERTY;
+		command[1] = start >> 8;
+		command[2] = end - start + 1;
+		command[3] = start & 0xff;
+		for (j = 0; j < command[2] && j < MAX_PROPERTIES; j++)
+			command[4 + j] = pending.value[start + j] >= 0 ? pending.value[start + j] : known->value[start + j];
+		emit(command, 4 + end - start + 1);
+		apply(known, command);
+		i = end + 1;
+	}
+	forget(&pending);
+}
+
+static void generate(void)
+{
+	static struct properties_s known;
+	const uint8_t* a = wds;
+	unsigned commands, bytes;
+
+	count(wds, &commands, &bytes);
+	printf("/*\n");
+	printf(" * Compact radio configuration stream, generated by host/radio_config_gen from radio_config.h\n");
+	printf(" *\n");
+	printf(" * Same property values as RADIO_CONFIGURATION_DATA_ARRAY at every command other than SET_PROPERTY,\n");
+	printf(" * with redundant writes removed and contiguous properties merged. WDS array: %u commands, %u bytes.\n", commands, bytes);
+	printf(" * Regenerate whenever radio_config.h changes: ./radio_config_gen -g > radio_config_compact.h\n");
+	printf(" */\n\n");
+	printf("#ifndef RADIO_CONFIG_COMPACT_H_\n#define RADIO_CONFIG_COMPACT_H_\n\n");
+	printf("#define RADIO_CONFIGURATION_COMPACT_ARRAY { \\\n");
+
+	forget(&known);
+	forget(&pending);
+	while (*a) {
+		if (a[1] == CMD_SET_PROPERTY)
+			apply(&pending, a + 1);
+		else {
+			flush(&known);
+			emit(a + 1, *a);
+			apply(&known, a + 1);
+		}
+		a += *a + 1;
+	}
+	flush(&known);
+
+	printf("\t0x00 \\\n}\n\n#endif /* RADIO_CONFIG_COMPACT_H_ */\n");
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned wds_commands, wds_bytes, commands, bytes, differences;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "gh")) != -1) {
+		switch (opt) {
+		case 'g':
+			generate();
+			return 0;
+		default:
+			fprintf(stderr, "usage: %s [-g]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	count(wds, &wds_commands, &wds_bytes);
+	count(compact, &commands, &bytes);
+	differences = compare(wds, compact);
+	printf("WDS array %u commands, %u bytes; compact %u commands, %u bytes\n", wds_commands, wds_bytes, commands, bytes);
+	printf("%s\n", differences ? "FAILED" : "passed");
+	return differences ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Host mock of the Si4362 radio library
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * Host tools feed demodulated bits straight into the packet handler, the radio is never
+ * accessed. These stubs satisfy the references of the firmware modules. RSSI is emulated:
+ * a tool sets it per bit with radio_mock_rssi, the modem status returns it and the CCA pin
+ * follows the threshold the packet handler configured. Latched RSSI follows it if MODEM_RSSI_CONTROL
+ * turns latching off, otherwise it holds the first value after RX start. Each radio of radio_devices has its
+ * own state, wired to the emulated ports like the firmware.
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "radio.h"
+#include "radio_mock.h"
+
+static const struct radio_pins_s radio_pins[RADIO_DEVICES] = {
+	RADIO_PINS_0,
+#if (RADIO_DEVICES > 1)
+	RADIO_PINS_1
+#endif
+};
+
+struct radio_s radio_devices[RADIO_DEVICES] = {
+	{ &radio_pins[0] },
+#if (RADIO_DEVICES > 1)
+	{ &radio_pins[1] }
+#endif
+};
+
+struct radio_mock_s radio_mock[RADIO_DEVICES] = {
+	{ { 0 }, 0, 0, RADIO_XO_TUNE_DEFAULT, { 0 }, 0, 0x03, 0, 0 },
+#if (RADIO_DEVICES > 1)
+	{ { 0 }, 0, 0, RADIO_XO_TUNE_DEFAULT, { 0 }, 0, 0x03, 0, 0 }
+#endif
+};
+
+uint8_t (*radio_mock_spectrum)(uint8_t device) = 0;
+
+#define MOCK(radio)		(&radio_mock[(radio) - radio_devices])
+
+void radio_mock_rssi(uint8_t device, uint8_t rssi)
+{
+	struct radio_mock_s* mock = &radio_mock[device];
+	const struct radio_pins_s* pins = radio_devices[device].pins;
+
+	mock->modem_status.curr_rssi = rssi;
+	if (!mock->latched) {
+		mock->modem_status.latch_rssi = rssi;
+		mock->latched = (mock->rssi_control & 0x07) != 0;	// LATCH field
+	}
+	if (rssi >= mock->threshold) {
+		mock->modem_status.modem_status |= RADIO_RSSI;
+		*pins->in |= pins->cca;
+	} else {
+		mock->modem_status.modem_status &= ~RADIO_RSSI;
+		*pins->in &= ~pins->cca;
+	}
+}
+
+uint8_t radio_configure(struct radio_s* radio)
+{
+	MOCK(radio)->configures++;
+	return 1;
+}
+
+void radio_start_rx(struct radio_s* radio, uint8_t channel, uint8_t start_condition, uint16_t rx_length, uint8_t rx_timeout_state, uint8_t rx_valid_state, uint8_t rx_invalid_state)
+{
+	MOCK(radio)->start_rx++;
+	MOCK(radio)->latched = 0;
+}
+
+void radio_set_frequency(struct radio_s* radio, const uint8_t* pll)
+{
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+		MOCK(radio)->pll[i] = pll[i];
+}
+
+void radio_change_state(struct radio_s* radio, uint8_t next_state)
+{
+}
+
+void radio_wait_for_CTS(struct radio_s* radio)
+{
+}
+
+void radio_get_modem_status(struct radio_s* radio, uint8_t clr_pending)
+{
+	radio->buffer.modem_status = MOCK(radio)->modem_status;
+}
+
+// FRR A is latched RSSI, B current state and C modem status as configured by radio_config.h, D is off
+void radio_frr_read(struct radio_s* radio, uint8_t frr, uint8_t count)
+{
+	struct radio_mock_s* mock = MOCK(radio);
+	uint8_t i;
+
+	for (i = 0; i < count; i++) {
+		switch (frr + i) {
+		case 'A':
+			radio->buffer.data[i] = radio_mock_spectrum ? radio_mock_spectrum(radio - radio_devices) : mock->modem_status.latch_rssi;
+			break;
+		case 'B':
+			radio->buffer.data[i] = RADIO_STATE_RX;
+			break;
+		case 'C':
+			radio->buffer.data[i] = mock->modem_status.modem_status;
+			break;
+		default:
+			radio->buffer.data[i] = 0;
+		}
+	}
+}
+
+void radio_set_property(struct radio_s* radio, uint8_t prop_group, uint8_t prop_num, uint8_t value)
+{
+	struct radio_mock_s* mock = MOCK(radio);
+
+	if (prop_group == 0x20 && prop_num == 0x4a) {	// MODEM_RSSI_THRESH
+		mock->threshold = value;
+		mock->threshold_updates++;
+	} else if (prop_group == 0x20 && prop_num == 0x4c)	// MODEM_RSSI_CONTROL
+		mock->rssi_control = value;
+	else if (prop_group == 0x00 && prop_num == 0x00)	// GLOBAL_XO_TUNE
+		mock->xo_tune = value;
+}
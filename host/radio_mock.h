@@ -0,0 +1,34 @@
+/*
+ * Host mock of the Si4362 radio library
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#ifndef RADIO_MOCK_H_
+#define RADIO_MOCK_H_
+
+#include <inttypes.h>
+
+#include "radio.h"
+
+// emulated state of each radio of radio_devices
+struct radio_mock_s {
+	struct modem_status_s modem_status;	// returned by radio_get_modem_status, e.g. set AFC offset
+	uint8_t threshold;					// RSSI threshold set through property 0x20 0x4a
+	uint32_t threshold_updates;			// number of times the threshold was set
+	uint8_t xo_tune;					// crystal load capacitance set through property 0x00 0x00
+	uint8_t pll[4];						// frequency set by radio_set_frequency
+	uint32_t start_rx;					// number of times RX was started, e.g. per hop
+	uint8_t rssi_control;				// MODEM_RSSI_CONTROL set through property 0x20 0x4c
+	uint32_t configures;				// number of times radio_configure was called
+	uint8_t latched;					// latch_rssi holds RSSI latched after RX start, MODEM_RSSI_CONTROL latch on
+};
+
+extern struct radio_mock_s radio_mock[RADIO_DEVICES];
+extern uint8_t (*radio_mock_spectrum)(uint8_t device);	// if set, RSSI register value read through FRR A, e.g. of radio_mock[device].pll
+
+void radio_mock_rssi(uint8_t device, uint8_t rssi);	// RSSI register value of current bit, updates modem status and CCA pin
+
+#endif /* RADIO_MOCK_H_ */
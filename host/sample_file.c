@@ -0,0 +1,112 @@
+/*
+ * Reader for recorded sample files: WAV (16 bit PCM, 32 bit float) and raw u8/s16/f32
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sample_file.h"
+
+static uint32_t read_le(const uint8_t* p, uint8_t bytes)
+{
+	uint32_t v = 0;
+	while (bytes--)
+		v = (v << 8) | p[bytes];
+	return v;
+}
+
+int sample_file_format(const char* name)
+{
+	if (!strcmp(name, "wav"))
+		return SAMPLE_FORMAT_WAV;
+	if (!strcmp(name, "u8"))
+		return SAMPLE_FORMAT_U8;
+	if (!strcmp(name, "s16"))
+		return SAMPLE_FORMAT_S16;
+	if (!strcmp(name, "f32"))
+		return SAMPLE_FORMAT_F32;
+	return -1;
+}
+
+// parse RIFF header up to start of data chunk
+int sample_file_open(struct sample_file_s* sf)
+{
+	uint8_t header[12], chunk[8], fmt[40];
+	uint32_t size;
+	uint16_t tag = 0, bits = 0;
+
+	sf->remaining = UINT64_MAX;
+	if (sf->format != SAMPLE_FORMAT_WAV)
+		return 0;
+
+	if (fread(header, 1, 12, sf->file) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+		return -1;
+
+	while (fread(chunk, 1, 8, sf->file) == 8) {
+		size = read_le(chunk + 4, 4);
+		if (!memcmp(chunk, "fmt ", 4)) {
+			if (size < 16 || size > sizeof(fmt) || fread(fmt, 1, size, sf->file) != size)
+				return -1;
+			tag = read_le(fmt, 2);
+			sf->channels = read_le(fmt + 2, 2);
+			sf->rate = read_le(fmt + 4, 4);
+			bits = read_le(fmt + 14, 2);
+			if (tag == 0xfffe && size >= 26)		// WAVE_FORMAT_EXTENSIBLE, sub format in first bytes of GUID
+				tag = read_le(fmt + 24, 2);
+			if (size & 1)
+				fgetc(sf->file);
+		} else if (!memcmp(chunk, "data", 4)) {
+			if (tag == 1 && bits == 16)
+				sf->format = SAMPLE_FORMAT_S16;
+			else if (tag == 3 && bits == 32)
+				sf->format = SAMPLE_FORMAT_F32;
+			else
+				return -1;
+			if (size)								// streaming writers leave size at 0
+				sf->remaining = size;
+			return (sf->channels == 1 || sf->channels == 2) ? 0 : -1;
+		} else {
+			if (fseek(sf->file, size + (size & 1), SEEK_CUR))
+				return -1;
+		}
+	}
+
+	return -1;
+}
+
+// read frames, convert to float (+/-1 full scale)
+size_t sample_file_read(struct sample_file_s* sf, float* a, float* b, size_t count)
+{
+	uint8_t* raw = sf->raw;
+	size_t sample_size = sf->format == SAMPLE_FORMAT_U8 ? 1 : sf->format == SAMPLE_FORMAT_S16 ? 2 : 4;
+	size_t frame_size = sample_size * sf->channels;
+	size_t bytes, frames, n;
+
+	if (count > SAMPLE_FILE_MAX_READ)
+		count = SAMPLE_FILE_MAX_READ;
+	bytes = count * frame_size;
+	if (bytes > sf->remaining)
+		bytes = sf->remaining;
+	frames = fread(raw, 1, bytes, sf->file) / frame_size;
+	sf->remaining -= frames * frame_size;
+
+	for (n = 0; n < frames * sf->channels; n++) {
+		float v;
+		switch (sf->format) {
+		case SAMPLE_FORMAT_U8: v = (raw[n] - 127.5f) / 128; break;
+		case SAMPLE_FORMAT_S16: v = (int16_t) read_le(raw + 2 * n, 2) / 32768.0f; break;
+		default: memcpy(&v, raw + 4 * n, 4); break;
+		}
+		if (sf->channels == 1 || !(n & 1))
+			a[n / sf->channels] = v;
+		else
+			b[n / 2] = v;
+	}
+
+	return frames;
+}
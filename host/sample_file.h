@@ -0,0 +1,38 @@
+/*
+ * Reader for recorded sample files: WAV (16 bit PCM, 32 bit float) and raw u8/s16/f32
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#ifndef SAMPLE_FILE_H_
+#define SAMPLE_FILE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#define SAMPLE_FILE_MAX_READ	4096		// max frames per call of sample_file_read
+
+enum SAMPLE_FORMAT {
+	SAMPLE_FORMAT_WAV = 0,					// format, channels and rate from RIFF header
+	SAMPLE_FORMAT_U8,						// raw unsigned 8 bit, e.g. rtl_sdr
+	SAMPLE_FORMAT_S16,						// raw signed 16 bit little endian
+	SAMPLE_FORMAT_F32						// raw 32 bit float
+};
+
+struct sample_file_s {
+	FILE* file;
+	uint8_t format;							// SAMPLE_FORMAT_x, WAV is replaced by sample format of file
+	uint8_t channels;						// 2 = interleaved I/Q, 1 = audio
+	uint32_t rate;							// sample rate in Hz
+	uint64_t remaining;						// bytes of sample data left, UINT64_MAX if unknown
+	uint8_t raw[SAMPLE_FILE_MAX_READ * 2 * sizeof(float)];	// read buffer
+};
+
+int sample_file_format(const char* name);	// parse wav, u8, s16 or f32, returns -1 if unknown
+int sample_file_open(struct sample_file_s* sf);	// set file, format, channels and rate (raw), parses WAV header, returns 0 on success
+size_t sample_file_read(struct sample_file_s* sf, float* a, float* b, size_t count);	// de-interleave into a (I or audio) and b (Q), returns frames read
+
+#endif /* SAMPLE_FILE_H_ */
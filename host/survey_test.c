@@ -0,0 +1,139 @@
+/*
+ * Tests the spectrum survey against the radio mock
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * The mock spectrum has a noise floor, a constant carrier on channel A and a signal on channel B that is
+ * present in every fourth RSSI sample. Sweeps the default band and checks every frequency is measured
+ * once, in order, with statistics and histogram of its samples. Checks that invalid bands are rejected
+ * and that RSSI latching is restored after the sweep. Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "radio.h"
+#include "radio_mock.h"
+#include "fifo.h"
+#include "packet_handler.h"
+#include "survey.h"
+
+#define TEST_NOISE_DBM		-115
+#define TEST_CARRIER_DBM	-60				// constant on channel A
+#define TEST_BURST_DBM		-80				// every fourth sample on channel B
+
+static unsigned failures = 0;
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static uint32_t samples = 0;				// FRR reads so far
+
+// radio is tuned to channel of default table
+static int tuned(uint8_t device, uint8_t channel)
+{
+	uint8_t pll[4];
+
+	ph_channel_words(&ph_default_channels[channel], pll);
+	return memcmp(radio_mock[device].pll, pll, 4) == 0;
+}
+
+static uint8_t spectrum(uint8_t device)
+{
+	samples++;
+	if (tuned(device, 0))
+		return RADIO_DBM_TO_RSSI(TEST_CARRIER_DBM);
+	if (tuned(device, 1) && samples % 4 == 0)
+		return RADIO_DBM_TO_RSSI(TEST_BURST_DBM);
+	return RADIO_DBM_TO_RSSI(TEST_NOISE_DBM);
+}
+
+static int bin_of(int dbm)
+{
+	int bin = (dbm - SURVEY_BIN_DBM) / SURVEY_BIN_DB;
+	return bin < 0 ? 0 : bin >= SURVEY_BINS ? SURVEY_BINS - 1 : bin;
+}
+
+// invalid bands are rejected without touching the radio
+static void test_invalid(void)
+{
+	struct survey_step_s step;
+
+	CHECK(!survey_start(162000, 161000, 25, SURVEY_BUSY_DBM), "end below start accepted");
+	CHECK(!survey_start(156000, 163000, 0, SURVEY_BUSY_DBM), "step 0 accepted");
+	CHECK(!survey_start(140000, 163000, 25, SURVEY_BUSY_DBM), "start below band accepted");
+	CHECK(!survey_start(156000, 176000, 25, SURVEY_BUSY_DBM), "end above band accepted");
+	CHECK(!survey_next(&step), "step without survey");
+	CHECK(radio_mock[0].rssi_control == SURVEY_RSSI_CONTROL, "RSSI control changed by invalid band");
+	printf("invalid bands tested\n");
+}
+
+static void test_sweep(void)
+{
+	struct survey_step_s step;
+	uint32_t khz = SURVEY_START_KHZ;
+	uint32_t steps = 0;
+	uint32_t starts = radio_mock[0].start_rx;
+	uint8_t i;
+
+	radio_mock_spectrum = spectrum;
+	CHECK(survey_start(SURVEY_START_KHZ, SURVEY_END_KHZ, SURVEY_STEP_KHZ, -90), "default band rejected");
+	CHECK(radio_mock[0].rssi_control == 0, "RSSI latch not disabled");
+
+	while (survey_next(&step)) {
+		struct ph_channel_s channel;
+		uint8_t pll[4];
+		int min = TEST_NOISE_DBM, mean = TEST_NOISE_DBM, max = TEST_NOISE_DBM, busy = 0;
+		unsigned total = 0;
+
+		CHECK(step.khz == khz, "step %u at %u kHz instead of %u", steps, step.khz, khz);
+		ph_channel_pll(&channel, step.khz);
+		ph_channel_words(&channel, pll);
+		CHECK(memcmp(radio_mock[0].pll, pll, 4) == 0, "%u kHz: radio not tuned", step.khz);
+		if (step.khz == ph_channel_khz(&ph_default_channels[0])) {
+			min = mean = max = TEST_CARRIER_DBM;
+			busy = 100;
+		} else if (step.khz == ph_channel_khz(&ph_default_channels[1])) {
+			mean = (3 * RADIO_DBM_TO_RSSI(TEST_NOISE_DBM) + RADIO_DBM_TO_RSSI(TEST_BURST_DBM) + 2) / 4;
+			mean = RADIO_RSSI_TO_DBM(mean);
+			max = TEST_BURST_DBM;
+			busy = 25;
+		}
+		CHECK(step.min == min && step.mean == mean && step.max == max && step.busy == busy,
+				"%u kHz: min %d mean %d max %d busy %u%% instead of %d %d %d %d%%",
+				step.khz, step.min, step.mean, step.max, step.busy, min, mean, max, busy);
+		for (i = 0; i < SURVEY_BINS; i++) {
+			unsigned expected = 0;
+			if (i == bin_of(min))
+				expected += busy == 25 ? SURVEY_SAMPLES * 3 / 4 : SURVEY_SAMPLES;
+			if (busy == 25 && i == bin_of(max))
+				expected += SURVEY_SAMPLES / 4;
+			CHECK(step.hist[i] == expected, "%u kHz: bin %u has %u samples instead of %u", step.khz, i, step.hist[i], expected);
+			total += step.hist[i];
+		}
+		CHECK(total == SURVEY_SAMPLES, "%u kHz: %u samples in histogram", step.khz, total);
+		khz += SURVEY_STEP_KHZ;
+		steps++;
+	}
+	radio_mock_spectrum = 0;
+
+	CHECK(steps == (SURVEY_END_KHZ - SURVEY_START_KHZ) / SURVEY_STEP_KHZ + 1, "%u steps", steps);
+	CHECK(radio_mock[0].start_rx == starts + steps, "RX started %u times for %u steps", radio_mock[0].start_rx - starts, steps);
+	CHECK(samples == steps * SURVEY_SAMPLES, "%u samples for %u steps", samples, steps);
+	CHECK(radio_mock[0].rssi_control == SURVEY_RSSI_CONTROL, "RSSI latch not restored");
+	CHECK(!survey_next(&step), "step after end of sweep");
+	printf("%u frequencies of %u to %u kHz surveyed\n", steps, SURVEY_START_KHZ, SURVEY_END_KHZ);
+}
+
+int main(int argc, char* argv[])
+{
+	test_invalid();
+	test_sweep();
+
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
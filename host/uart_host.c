@@ -0,0 +1,38 @@
+/*
+ * Host replacement of the UART library, output goes to stdout
+ * Author: Adrian Studer
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "uart.h"
+
+void uart_init(void)
+{
+}
+
+void uart_send_string(const char* buffer)
+{
+	fputs(buffer, stdout);
+}
+
+void uart_send_byte(uint8_t data)
+{
+	putchar(data);
+}
+
+uint8_t uart_set_baud(uint32_t baud)
+{
+	return 1;
+}
+
+void uart_flush(void)
+{
+	fflush(stdout);
+}
+
+uint8_t uart_queue_byte(uint8_t data)
+{
+	putchar(data);
+	return 1;
+}
@@ -0,0 +1,177 @@
+/*
+ * Tests the warm start check radio_configured of radio.c against an emulated Si4362 on the SPI bus
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * radio.c is linked instead of the radio mock. The emulated radio keeps a table of properties and answers the
+ * commands radio.c sends: SET_PROPERTY and GET_PROPERTY, PART_INFO and FUNC_INFO, fast response registers.
+ * Others are accepted and ignored. The test configures the radio, starts the packet handler on it like main
+ * does and checks that radio_configured still recognizes the configuration, i.e. that a reset would warm
+ * start. It also checks that a lost configuration, a radio in boot mode and another part are rejected.
+ * Exit code is 1 if a test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <msp430.h>
+#include "radio.h"
+#include "fifo.h"
+#include "packet_handler.h"
+
+#define CMD_SET_PROPERTY	0x11
+#define CMD_GET_PROPERTY	0x12
+#define CMD_PART_INFO		0x01
+#define CMD_FUNC_INFO		0x10
+#define CMD_READ_CMD_BUFF	0x44
+#define CMD_FRR_A_READ		0x50
+
+static unsigned failures = 0;
+
+void spi_init(void)							// USCI B0 of spi.c, emulated by host_spi
+{
+}
+
+#define CHECK(condition, ...) do { if (!(condition)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+// emulated Si4362, a command ends when all its parameters arrived, a read after it returns CTS and the response
+static uint8_t si_properties[256][256];
+static uint8_t si_part_lsb = 0x62;
+static uint8_t si_func = 1;					// main application image running
+static uint8_t si_command[24];
+static uint8_t si_length;					// bytes of si_command received
+static uint8_t si_response[16];
+static int si_read = -1;					// next byte of response, -1 = CTS, -2 = no read in progress
+static unsigned si_property_writes;
+
+// parameter bytes of each command radio.c sends, SET_PROPERTY has count after its first 3
+static uint8_t si_parameters(uint8_t command)
+{
+	switch (command) {
+	case 0x02: return 6;					// POWER_UP
+	case 0x13: return 7;					// GPIO_PIN_CFG
+	case 0x17: return 4;					// IRCAL
+	case 0x32: return 7;					// START_RX
+	case 0x34: return 1;					// CHANGE_STATE
+	case 0x22: return 1;					// GET_MODEM_STATUS
+	case 0x23: return 1;					// GET_CHIP_STATUS
+	case 0x20: return 3;					// GET_INT_STATUS
+	case CMD_SET_PROPERTY: return si_length < 3 ? 3 : 3 + si_command[2];
+	case CMD_GET_PROPERTY: return 3;
+	default: return 0;
+	}
+}
+
+static void si_execute(void)
+{
+	uint8_t i;
+
+	memset(si_response, 0, sizeof(si_response));
+	switch (si_command[0]) {
+	case CMD_SET_PROPERTY:
+		for (i = 0; i < si_command[2]; i++)
+			si_properties[si_command[1]][si_command[3] + i] = si_command[4 + i];
+		si_property_writes++;
+		break;
+	case CMD_GET_PROPERTY:
+		for (i = 0; i < si_command[2]; i++)
+			si_response[i] = si_properties[si_command[1]][si_command[3] + i];
+		break;
+	case CMD_PART_INFO:
+		si_response[1] = 0x43;
+		si_response[2] = si_part_lsb;
+		break;
+	case CMD_FUNC_INFO:
+		si_response[5] = si_func;
+		break;
+	}
+}
+
+// SPI transfer of radio.c, reads are 0 bytes after READ_CMD_BUFF or an FRR read, radio.c never sends NOP
+static uint8_t si_spi(uint8_t mosi)
+{
+	if (si_read > -2) {						// response or FRR read in progress
+		if (mosi == 0) {
+			if (si_read == -1) {
+				si_read = 0;
+				return 0xff;				// CTS
+			}
+			return si_read < (int) sizeof(si_response) ? si_response[si_read++] : 0;
+		}
+		si_read = -2;						// next command
+	}
+
+	if (si_length == 0 && mosi == CMD_READ_CMD_BUFF) {
+		si_read = -1;
+		return 0;
+	}
+	if (si_length == 0 && (mosi & 0xfc) == CMD_FRR_A_READ) {
+		memset(si_response, 0, sizeof(si_response));
+		si_read = 0;						// FRR read has no CTS byte
+		return 0;
+	}
+	si_command[si_length++] = mosi;
+	if (si_length > si_parameters(si_command[0])) {
+		si_execute();
+		si_length = 0;
+	}
+	return 0;
+}
+
+// configuration survives starting the packet handler on the radio
+static void test_started(void)
+{
+	struct radio_s* radio = &radio_devices[0];
+
+	CHECK(radio_configure(radio), "configuration failed");
+	CHECK(radio_configured(radio), "not configured after radio_configure");
+
+	ph_set_hop(PH_HOP_AB);
+	ph_setup();
+	ph_set_tuning(PH_PREAMBLE_LENGTH, PH_SYNC_TIMEOUT, -100, 5);	// threshold written on start
+	ph_start();
+	CHECK(si_properties[0x20][0x4a] == RADIO_DBM_TO_RSSI(-100), "RSSI threshold not set");
+	CHECK(si_properties[0x20][0x4c] != 0x03, "RSSI latch still on, test doesn't cover MODEM_RSSI_CONTROL");
+	CHECK(radio_configured(radio), "not configured after ph_start, every reset would configure the radio");
+	ph_stop();
+	printf("warm start after ph_start tested\n");
+}
+
+// properties lost, e.g. by a brown out, boot mode and other parts need a configuration
+static void test_rejected(void)
+{
+	struct radio_s* radio = &radio_devices[0];
+	uint8_t value = si_properties[0x20][0x4e];
+
+	si_properties[0x20][0x4e] = value + 1;
+	CHECK(!radio_configured(radio), "changed modem property 0x4e accepted");
+	si_properties[0x20][0x4e] = value;
+
+	si_func = 0;
+	CHECK(!radio_configured(radio), "radio in boot mode accepted");
+	si_func = 1;
+
+	si_part_lsb = 0x63;
+	CHECK(!radio_configured(radio), "Si4363 accepted");
+	si_part_lsb = 0x62;
+
+	CHECK(radio_configured(radio), "not configured after restoring radio");
+	printf("lost configuration tested\n");
+}
+
+int main(int argc, char* argv[])
+{
+	host_spi = si_spi;
+	RADIO_PIN |= RADIO_CTS;					// emulated radio is always ready
+
+	test_started();
+	test_rejected();
+
+	printf("%u property writes\n", si_property_writes);
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
@@ -60,7 +60,8 @@ MEMORY
     INFOB                   : origin = 0x1080, length = 0x0040
     INFOC                   : origin = 0x1040, length = 0x0040
     INFOD                   : origin = 0x1000, length = 0x0040
-    FLASH                   : origin = 0xC000, length = 0x3FE0
+    FLASH                   : origin = 0xC000, length = 0x3000
+    LOG                     : origin = 0xF000, length = 0x0E00  /* message log, see log.c */
     INT00                   : origin = 0xFFE0, length = 0x0002
     INT01                   : origin = 0xFFE2, length = 0x0002
     INT02                   : origin = 0xFFE4, length = 0x0002
@@ -87,6 +88,7 @@ SECTIONS
 {
     .bss        : {} > RAM                /* GLOBAL & STATIC VARS              */
     .data       : {} > RAM                /* GLOBAL & STATIC VARS              */
+    .noinit     : {} > RAM type = NOINIT  /* VARS KEPT THROUGH RESET           */
     .sysmem     : {} > RAM                /* DYNAMIC MEMORY ALLOCATION AREA    */
     .stack      : {} > RAM (HIGH)         /* SOFTWARE SYSTEM STACK             */
 
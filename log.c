@@ -0,0 +1,252 @@
+/*
+ * Store-and-forward message log in main flash
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "fifo.h"
+#include "flash.h"
+#include "log.h"
+
+#define LOG_MEMORY			(FLASH_MAIN_MEMORY + 0x3000)	// 0xf000, LOG in lnk_msp430g2553.cmd
+#define LOG_SEGMENT(n)		(LOG_MEMORY + (uint16_t) (n) * FLASH_MAIN_SEGMENT_SIZE)
+#define LOG_HEADER			4				// segment header: sequence, inverted sequence
+#define LOG_RECORD_HEADER	8				// size, valid, channel, rssi, time
+#define LOG_LENGTH(size)	((LOG_RECORD_HEADER + (size) + 1) & ~1)	// record length, keeps time word aligned
+
+uint16_t log_dropped = 0;
+
+static uint8_t log_segment;					// segment being written
+static uint16_t log_offset;					// write position in log_segment
+static uint16_t log_sequence;				// sequence number of log_segment
+static uint8_t log_dirty;					// bit n set if segment n needs to be erased before use
+static uint32_t log_time_base;				// log time at start
+
+static uint8_t replay_segment;				// segment and offset of next record to replay
+static uint16_t replay_offset;
+static uint8_t replay_left;					// segments left to replay, 0 if replay is done
+static uint32_t replay_since;
+
+static uint8_t log_next(uint8_t segment)
+{
+	return segment == LOG_SEGMENTS - 1 ? 0 : segment + 1;
+}
+
+// sequence number of segment, 0xffff if segment is not in use
+static uint16_t log_segment_sequence(uint8_t segment)
+{
+	const uint16_t* header = (const uint16_t*) LOG_SEGMENT(segment);
+
+	if (header[0] != (uint16_t) ~header[1])
+		return 0xffff;
+	return header[0];
+}
+
+static uint8_t log_blank(uint8_t segment)
+{
+	const uint16_t* data = (const uint16_t*) LOG_SEGMENT(segment);
+	uint16_t i;
+
+	for (i = 0; i < FLASH_MAIN_SEGMENT_SIZE / 2; i++) {
+		if (data[i] != 0xffff)
+			return 0;
+	}
+	return 1;
+}
+
+// record at offset of segment, 0 if there is none
+static const struct log_record_s* log_record(uint8_t segment, uint16_t offset)
+{
+	const struct log_record_s* record = (const struct log_record_s*) (LOG_SEGMENT(segment) + offset);
+
+	if (offset + LOG_RECORD_HEADER > FLASH_MAIN_SEGMENT_SIZE)
+		return 0;
+	if (record->size > LOG_MAX_PAYLOAD || offset + LOG_LENGTH(record->size) > FLASH_MAIN_SEGMENT_SIZE)
+		return 0;									// end of records or corrupt
+	return record;
+}
+
+void log_init(void)
+{
+	const struct log_record_s* record;
+	uint8_t segment, found = 0;
+
+	log_time_base = 0;
+	log_dirty = 0;
+	for (segment = 0; segment < LOG_SEGMENTS; segment++) {
+		uint16_t sequence = log_segment_sequence(segment);
+		uint16_t offset = LOG_HEADER;
+		if (sequence == 0xffff) {
+			if (!log_blank(segment))
+				log_dirty |= 1 << segment;			// e.g. reset during LOG CLEAR
+			continue;
+		}
+		if (!found || (int16_t) (sequence - log_sequence) > 0) {
+			log_segment = segment;					// newest so far, sequence may wrap
+			log_sequence = sequence;
+			found = 1;
+		}
+		while ((record = log_record(segment, offset)) != 0) {
+			if (record->valid == 0 && record->time >= log_time_base)
+				log_time_base = record->time + 1;	// continue after newest record
+			offset += LOG_LENGTH(record->size);
+		}
+	}
+
+	if (!found) {									// empty log, next record starts segment 0
+		log_segment = LOG_SEGMENTS - 1;
+		log_offset = FLASH_MAIN_SEGMENT_SIZE;
+		log_sequence = 0;
+	} else {
+		log_offset = LOG_HEADER;
+		while ((record = log_record(log_segment, log_offset)) != 0)
+			log_offset += LOG_LENGTH(record->size);
+		if (log_offset + LOG_RECORD_HEADER <= FLASH_MAIN_SEGMENT_SIZE
+				&& *(LOG_SEGMENT(log_segment) + log_offset) != 0xff)
+			log_offset = FLASH_MAIN_SEGMENT_SIZE;	// corrupt record, continue in next segment
+	}
+
+	if (!log_blank(log_next(log_segment)))
+		log_dirty |= 1 << log_next(log_segment);
+	replay_left = 0;
+}
+
+uint32_t log_time(uint32_t seconds)
+{
+	return log_time_base + seconds;
+}
+
+uint8_t log_packet(int8_t rssi, uint32_t seconds)
+{
+	struct log_record_s header;
+	uint16_t packet_size = fifo_get_packet();
+	uint8_t* address;
+	uint8_t size, i;
+
+	if (packet_size < 4)
+		return 0;
+	header.channel = fifo_read_byte();
+	size = packet_size - 3;							// without channel and CRC
+	if (size > LOG_MAX_PAYLOAD)
+		return 0;
+
+	if (log_offset + LOG_LENGTH(size) > FLASH_MAIN_SEGMENT_SIZE) {
+		uint16_t segment_header[2];
+		if (log_dirty & (1 << log_next(log_segment))) {	// next segment not erased yet, never erase here
+			log_dropped++;
+			return 0;
+		}
+		log_segment = log_next(log_segment);
+		log_sequence = log_sequence == 0xfffe ? 0 : log_sequence + 1;	// 0xffff marks blank segment
+		segment_header[0] = log_sequence;
+		segment_header[1] = ~log_sequence;
+		flash_write(LOG_SEGMENT(log_segment), segment_header, LOG_HEADER);
+		log_offset = LOG_HEADER;
+		log_dirty |= 1 << log_next(log_segment);	// segment after holds oldest records, erase ahead
+	}
+
+	// size first, so the next record has its place even if power fails, valid last
+	address = LOG_SEGMENT(log_segment) + log_offset;
+	header.size = size;
+	header.rssi = rssi;
+	header.time = log_time(seconds);
+	flash_write(address, &header.size, 1);
+	flash_write(address + 2, &header.channel, LOG_RECORD_HEADER - 2);
+	for (i = 0; i < size; i++) {
+		uint8_t data = fifo_read_byte();
+		flash_write(address + LOG_RECORD_HEADER + i, &data, 1);
+	}
+	header.valid = 0;
+	flash_write(address + 1, &header.valid, 1);
+	log_offset += LOG_LENGTH(size);
+	return 1;
+}
+
+// one erase per call, the segment ahead of the write position first
+uint8_t log_poll(void)
+{
+	uint8_t segment = log_next(log_segment);
+
+	if (!log_dirty)
+		return 0;
+	while (!(log_dirty & (1 << segment)))
+		segment = log_next(segment);
+	log_dirty &= ~(1 << segment);
+	if (log_blank(segment))							// e.g. while log fills up for the first time
+		return 0;
+	flash_erase(LOG_SEGMENT(segment));
+	return 1;
+}
+
+// invalidates segment headers, which only programs bits, log_poll erases the segments later
+void log_clear(void)
+{
+	static const uint16_t cleared[2] = { 0, 0 };	// sequence 0 doesn't match inverted sequence 0
+	uint8_t segment;
+
+	for (segment = 0; segment < LOG_SEGMENTS; segment++) {
+		if (log_blank(segment))
+			continue;
+		if (log_segment_sequence(segment) != 0xffff)
+			flash_write(LOG_SEGMENT(segment), cleared, LOG_HEADER);
+		log_dirty |= 1 << segment;
+	}
+	log_segment = LOG_SEGMENTS - 1;					// sequence continues, next record starts segment 0
+	log_offset = FLASH_MAIN_SEGMENT_SIZE;
+	replay_left = 0;
+}
+
+uint16_t log_records(void)
+{
+	const struct log_record_s* record;
+	uint16_t count = 0;
+	uint8_t segment;
+
+	for (segment = 0; segment < LOG_SEGMENTS; segment++) {
+		uint16_t offset = LOG_HEADER;
+		if (log_segment_sequence(segment) == 0xffff)
+			continue;
+		while ((record = log_record(segment, offset)) != 0) {
+			if (record->valid == 0)
+				count++;
+			offset += LOG_LENGTH(record->size);
+		}
+	}
+	return count;
+}
+
+void log_replay_start(uint32_t since)
+{
+	replay_segment = log_next(log_segment);			// oldest segment
+	replay_offset = LOG_HEADER;
+	replay_left = LOG_SEGMENTS;
+	replay_since = since;
+}
+
+const struct log_record_s* log_replay_next(void)
+{
+	const struct log_record_s* record;
+
+	while (replay_left) {
+		if (log_segment_sequence(replay_segment) != 0xffff) {	// segment might have been erased meanwhile
+			while ((record = log_record(replay_segment, replay_offset)) != 0) {
+				replay_offset += LOG_LENGTH(record->size);
+				if (record->valid == 0 && record->time >= replay_since)
+					return record;
+			}
+		}
+		if (replay_segment == log_segment)			// newest records done
+			replay_left = 0;
+		else {
+			replay_segment = log_next(replay_segment);
+			replay_offset = LOG_HEADER;
+			replay_left--;
+		}
+	}
+	return 0;
+}
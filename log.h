@@ -0,0 +1,46 @@
+/*
+ * Store-and-forward message log in main flash
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * LOG_SEGMENTS flash segments (LOG in lnk_msp430g2553.cmd) are used as a ring. Each segment starts with
+ * a sequence number, followed by records that never cross into the next segment. The segment after the
+ * one being written is kept erased, so appending a record only programs bytes. Erasing blocks the CPU
+ * for 12ms; log_poll does it when the main loop knows that the packet handler is waiting for a sync.
+ * If packets arrive faster than segments can be erased, records are dropped instead. log_clear only
+ * invalidates segment headers and leaves erasing to log_poll.
+ *
+ * Times are seconds of reception (ph_get_seconds) continued from the newest record after a reset, so
+ * ages are exact within a power cycle and miss the time the receiver was off.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#define LOG_SEGMENTS		7					// number of 512 byte segments, 0xf000 to 0xfdff
+#define LOG_MAX_PAYLOAD		128					// larger payload size means corrupt record
+
+struct log_record_s {
+	uint8_t size;								// payload size in bytes, 0xff if there are no more records in segment
+	uint8_t valid;								// 0 once record is complete, 0xff if writing was interrupted
+	uint8_t channel;							// radio channel, 0=A, 1=B
+	int8_t rssi;								// RSSI in dBm at sync
+	uint32_t time;								// seconds, see log_time
+	uint8_t payload[];							// AIS payload without CRC, padded to even size
+};
+
+extern uint16_t log_dropped;					// records dropped since start because next segment wasn't erased yet
+
+void log_init(void);							// find newest segment and write position
+uint32_t log_time(uint32_t seconds);			// log time of seconds since start (ph_get_seconds)
+uint8_t log_packet(int8_t rssi, uint32_t seconds);	// append current packet of FIFO, returns 0 if dropped
+uint8_t log_poll(void);							// erase ahead if needed, returns 1 if flash was erased
+void log_clear(void);							// remove all records, log_poll erases their segments one per call
+uint16_t log_records(void);						// number of complete records
+
+void log_replay_start(uint32_t since);			// start replay of records with log time >= since
+const struct log_record_s* log_replay_next(void);	// next record of replay, oldest first, 0 at end
+
+#endif /* LOG_H_ */
@@ -16,8 +16,12 @@
 #include "radio.h"
 #include "packet_handler.h"
 #include "nmea.h"
-
-#define DEBUG_MESSAGES			// un-comment to send error messages over UART
+#include "command.h"
+#include "config.h"
+#include "log.h"
+#include "health.h"
+#include "event.h"
+#include "duty.h"
 
 // LED helpers for debugging
 #define LED1	BIT0
@@ -31,9 +35,150 @@ void test_packet_handler(const char* message);
 void test_error(void);
 #endif
 
-#ifdef DEBUG_MESSAGES
-char str_output_buffer[5];	// output buffer for numbers in some debug messages
-#endif
+#define XO_SAVE_INTERVAL	900			// seconds between stores of learned crystal calibration
+#define STARTUP_TICKS_MS	16000		// SMCLK cycles of duty_now per ms
+
+// ms since reset, TA0 of duty.c starts with main
+static uint16_t startup_ms(void)
+{
+	return duty_now() / STARTUP_TICKS_MS;
+}
+
+// send name and signed number for debug messages, e.g. " RSSI=-80"
+static void send_debug_value(const char* name, int16_t value)
+{
+	char buffer[5];
+
+	dec_to_str(buffer, 3, value);
+	buffer[4] = 0;
+	uart_send_string(name);
+	uart_send_string(buffer);
+}
+
+static uint8_t sync_channel = 0;			// channel and signal strength at last sync
+static int16_t sync_rssi = 0;
+static uint8_t xo_saved;					// crystal calibration stored in flash
+static uint32_t xo_save_time = 0;			// seconds of reception at last store
+
+// record channel and signal strength at sync for debug messages
+static void sync_task(void)
+{
+	if (ph_get_state() == PH_STATE_PREFETCH) {										// found preamble and start flag
+		sync_channel = ph_get_radio_channel();										// read current channel
+		sync_rssi = ph_get_radio_rssi();											// read current RSSI
+	}
+}
+
+// count and report packet handler error, send next packet, returns 1 if more packets are waiting
+static uint8_t packet_task(void)
+{
+	if (ph_get_raw_stream()) {						// only raw bits go out while streaming
+		ph_get_last_error();
+		ph_poll();
+		while (fifo_get_packet())
+			fifo_remove_packet();
+		return 0;
+	}
+
+	uint8_t debug = (config.output == COMMAND_OUTPUT_DEBUG);
+
+	// retrieve last packet handler error
+	uint8_t error = ph_get_last_error();
+	if (error != PH_ERROR_NONE && error < PH_ERRORS)
+		command_stats.errors[error]++;
+
+	// report error if packet handler failed
+	if (error != PH_ERROR_NONE && debug) {
+		uart_send_string("sync ");														// send debug message to UART
+		uart_send_byte(sync_channel + 'A');
+		send_debug_value(" RSSI=", sync_rssi);
+		uart_send_string("dBm\r\n");
+		uart_send_string("error: ");
+		switch (error) {
+		case PH_ERROR_NOEND:
+			uart_send_string("no end flag");
+			break;
+		case PH_ERROR_STUFFBIT:
+			uart_send_string("invalid stuff bit");
+			break;
+		case PH_ERROR_CRC:
+			uart_send_string("CRC error");
+			break;
+		case PH_ERROR_RSSI_DROP:
+			uart_send_string("RSSI drop");
+			break;
+		}
+		uart_send_string("\r\n");
+	}
+
+	// toggle LED if packet handler failed after finding preamble and start flag
+	if (!debug && (error == PH_ERROR_NOEND || error == PH_ERROR_STUFFBIT || error == PH_ERROR_CRC))
+		LED1_TOGGLE;
+
+	// check if a new valid packet arrived
+	ph_poll();									// packets of all radios
+	uint16_t size = fifo_get_packet();
+	if (size > 1) {								// if so, process packet
+		uint8_t packet_channel = fifo_read_byte() & (PH_CHANNELS - 1);
+		uint8_t type = fifo_read_byte() >> 2;	// AIS message type in first 6 bits of payload
+		struct ph_packet_info_s info;
+		uint8_t sampled;
+		command_stats.packets[packet_channel]++;
+
+		sampled = ph_get_packet_info(&info);	// signal strength sampled during this packet
+		if (sampled)
+			sync_rssi = info.rssi;
+
+		if (command_filter(packet_channel, type)) {
+
+			if (debug) {
+				uart_send_string("sync ");												// send debug message to UART
+				uart_send_byte(packet_channel + 'A');
+				send_debug_value(" RSSI=", sync_rssi);
+				uart_send_string("dBm");
+				if (sampled) {
+					send_debug_value(" mean=", info.rssi_mean);
+					send_debug_value(" min=", info.rssi_min);
+					send_debug_value(" quality=", info.quality);
+				}
+				uart_send_string("\r\n");
+			}
+
+			nmea_process_packet();				// process packet (NMEA message will be sent over UART)
+			if (config.log)
+				log_packet(sync_rssi, ph_get_seconds());	// store packet for later replay
+		} else
+			command_stats.filtered++;
+	}
+	if (size > 0)
+		fifo_remove_packet();					// remove processed packet from FIFO
+
+	return fifo_get_packet() != 0;
+}
+
+// work that can wait, returns 0 if it has to wait until nothing is being received
+static uint8_t housekeeping(void)
+{
+	if (ph_get_raw_stream())
+		return 1;								// nothing else while streaming
+	if (fifo_get_packet() || ph_get_state() != PH_STATE_WAIT_FOR_SYNC)
+		return 0;								// erasing and writing flash hold off the packet handler
+
+	// erase log ahead
+	log_poll();
+
+	// calibrate crystal, stored at most every XO_SAVE_INTERVAL seconds to save flash
+	if (!config.xo_fixed) {
+		ph_xo_step();							// averages AFC offsets the ISR collected
+		config.xo_tune = ph_get_xo_tune();
+		if (config.xo_tune != xo_saved && ph_get_seconds() - xo_save_time >= XO_SAVE_INTERVAL) {
+			if (config_save_xo_tune())
+				xo_saved = config.xo_tune;
+			xo_save_time = ph_get_seconds();
+		}
+	}
+	return 1;
+}
 
 int main(void)
 {
@@ -45,114 +190,106 @@ int main(void)
 	DCOCTL = CALDCO_16MHZ;
 	BCSCTL2 = 0;							// MCLK and SMCLK = DCO = 16MHz
 
+	duty_init();							// TA0 counts SMCLK while awake, times startup until first RX
+	_BIS_SR(GIE);
+
 #ifdef TEST
 	// when compiled in test mode, use different main
 	// disconnect radio when testing to avoid damage!
 	test_main();
 #endif
 
+	// watchdog from here on, reads reset cause before it's cleared below
+	health_init();
+
 	// configure LED1 and turn it off, we'll use that for error and other stuff
 	P1DIR |= LED1;
 	LED1_OFF;
 
-	// setup uart
+	// load configuration from flash, setup uart and command interface
+	config_load();
+	log_init();
 	uart_init();
+	command_init();
 
 	// setup packet handler
 	ph_setup();
 
-	// setup an configure radio
-	radio_setup();
-	radio_configure();
-
-	// verify that radio configuration was successful
-	radio_get_chip_status(0);
-	if (radio_buffer.chip_status.chip_status & RADIO_CMD_ERROR) {	// check for command error
-		while (1) {
-			LED1_TOGGLE;
-			_delay_cycles(8000000);			// blink LED if there was an error
+	// setup an configure radios, a reset that didn't cut power (watchdog, RST pin) leaves them configured
+	uint16_t radio_start = startup_ms();
+	uint8_t warm = !(IFG1 & PORIFG);
+	IFG1 &= ~(WDTIFG | PORIFG | RSTIFG);	// reset flags are sticky
+	uint8_t n;
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		struct radio_s* radio = &radio_devices[n];
+		radio_setup(radio);
+		if (warm && radio_configured(radio)) {
+			command_stats.warm_radios++;	// skip reset, configuration and IRCAL, ph_start restarts RX
+			continue;
+		}
+		// configure radio and verify that configuration was successful
+		uint8_t configured = radio_configure(radio);
+		radio_get_chip_status(radio, 0);
+		if (!configured || (radio->buffer.chip_status.chip_status & RADIO_CMD_ERROR)) {	// check for timeout or command error
+			while (1) {
+				LED1_TOGGLE;
+				_delay_cycles(8000000);		// blink LED if there was an error, until watchdog resets and we try again
+			}
 		}
 	}
 
+	command_stats.radio_ms = startup_ms() - radio_start;
+
 	// start packet receiving
 	ph_start();
+	command_stats.startup_ms = startup_ms();
+	health_start();							// TA1 ticks for supervision
 
-#ifdef DEBUG_MESSAGES
-	uart_send_string("dAISy 0.2 started\r\n");
-#endif
+	if (config.output == COMMAND_OUTPUT_DEBUG)
+		uart_send_string("dAISy 0.2 started\r\n");
 
-	while (1) {
-
-		__low_power_mode_4();	// deep sleep until something worthwhile happens
+	uint8_t chores = 0;						// housekeeping due, set by tick
+	xo_saved = config.xo_tune;
 
-#ifdef DEBUG_MESSAGES
-		uint8_t channel;
-		int16_t rssi;
-		// debug code to monitor signal strength (RSSI)
-		if (ph_get_state() == PH_STATE_PREFETCH) {											// found preamble and start flag
-			// record current channel and signal strength
-			channel = ph_get_radio_channel();												// read current channel
-			rssi = ph_get_radio_rssi();														// read current RSSI
-		}
-#endif
-
-		// retrieve last packet handler error
-		uint8_t error = ph_get_last_error();
-#ifdef DEBUG_MESSAGES
-		// report error if packet handler failed
-		if (error != PH_ERROR_NONE)	{
-			dec_to_str(str_output_buffer, 3, rssi);											// convert to decimal string (reuse radio buffer)
-			str_output_buffer[4] = 0;														// terminate string
-			uart_send_string("sync ");														// send debug message to UART
-			uart_send_byte(channel + 'A');
-			uart_send_string(" RSSI=");
-			uart_send_string(str_output_buffer);
-			uart_send_string("dBm\r\n");
-			uart_send_string("error: ");
-			switch (error) {
-			case PH_ERROR_NOEND:
-				uart_send_string("no end flag");
-				break;
-			case PH_ERROR_STUFFBIT:
-				uart_send_string("invalid stuff bit");
-				break;
-			case PH_ERROR_CRC:
-				uart_send_string("CRC error");
-				break;
-			case PH_ERROR_RSSI_DROP:
-				uart_send_string("RSSI drop");
-				break;
-			}
-			uart_send_string("\r\n");
-		}
-#else
-		// toggle LED if packet handler failed after finding preamble and start flag
-		if (error == PH_ERROR_NOEND || error == PH_ERROR_STUFFBIT || error == PH_ERROR_CRC)
-			LED1_TOGGLE;
-#endif
-
-		// check if a new valid packet arrived
-		uint16_t size = fifo_get_packet();
-		if (size > 0) {								// if so, process packet
-
-#ifdef DEBUG_MESSAGES
-			dec_to_str(str_output_buffer, 3, rssi);											// convert to decimal string (reuse radio buffer)
-			str_output_buffer[4] = 0;														// terminate string
-			uart_send_string("sync ");														// send debug message to UART
-			uart_send_byte(channel + 'A');
-			uart_send_string(" RSSI=");
-			uart_send_string(str_output_buffer);
-			uart_send_string("dBm\r\n");
+	while (1) {
+		uint8_t event = event_take();
+		uint8_t more = 0;					// task has more work, run it again after higher priorities
+
+		PH_MCLK_FULL();						// tasks run at 16MHz, delays and timeouts assume it
+		switch (event) {
+		case EVENT_PACKET:					// packet output, nothing has priority over it
+			more = packet_task();
+			break;
+		case EVENT_SYNC:
+			sync_task();
+			break;
+		case EVENT_CONTINUE:				// LOG REPLAY, SURVEY, .. after tick and housekeeping
+			if (chores && housekeeping())
+				chores = 0;
+			// no break
+		case EVENT_COMMAND:
+			more = command_poll();
+			event = EVENT_CONTINUE;
+			break;
+		case EVENT_TICK:
+			health_poll();					// supervise radios, kick watchdog
+#if DUTY_CYCLE
+			if (duty_poll() && config.output == COMMAND_OUTPUT_DEBUG)
+				command_send_duty();		// report each window in debug output
 #endif
-
-			nmea_process_packet();					// process packet (NMEA message will be sent over UART)
-			fifo_remove_packet();					// remove processed packet from FIFO
+			chores = 1;
+			break;
+		default:							// no event pending
+			if (chores && housekeeping())
+				chores = 0;
+			ph_mclk_hunt();					// lower MCLK until next event or sync
+			duty_switch(DUTY_SLEEP);
+			event_sleep(ph_get_raw_stream());	// UART needs SMCLK to send raw bits
+			duty_switch(DUTY_MAIN);
+			continue;
 		}
-
-		// enter low power mode LPM0 (everything off)
-		// TODO: wait for UART to complete transmission
-
-		// TODO: suspend UART
+		if (more)
+			event_post(event);
 	}
 }
 
@@ -165,7 +302,9 @@ const char test_message_2[] = "100h00PP0@PHFV`Mg5gTH?vNPUIp";
 
 void test_main(void)
 {
-	radio_shutdown();	// put radio into shutdown to avoid damage when writing to radio output pins
+	uint8_t n;
+	for (n = 0; n < RADIO_DEVICES; n++)
+		radio_shutdown(&radio_devices[n]);	// put radio into shutdown to avoid damage when writing to radio output pins
 
 	// testing dec_to_str
 	char test_buf[10];
@@ -231,8 +370,7 @@ void test_error(void)
 
 // handler for unexpected interrupts
 #pragma vector=ADC10_VECTOR,COMPARATORA_VECTOR,NMI_VECTOR,PORT1_VECTOR,	\
-			   TIMER0_A0_VECTOR,TIMER0_A1_VECTOR,TIMER1_A0_VECTOR,TIMER1_A1_VECTOR,		\
-			   USCIAB0RX_VECTOR,USCIAB0TX_VECTOR,WDT_VECTOR
+			   TIMER0_A0_VECTOR,TIMER1_A1_VECTOR,WDT_VECTOR
 __interrupt void ISR_trap(void)
 {
 	// trap CPU & code execution here with an infinite loop
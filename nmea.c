@@ -11,25 +11,32 @@
 
 #include "fifo.h"
 #include "uart.h"
+#include "radio.h"
+#include "duty.h"
+#include "packet_handler.h"
 #include "nmea.h"
 
 void nmea_push_char(char c);
 uint8_t nmea_push_packet(uint8_t packet_size);
+void nmea_send(uint8_t radio_channel, uint16_t packet_size);
+
+const uint8_t* nmea_source = 0;			// payload in memory, 0 to read payload from FIFO
 
 #define NMEA_MAX_AIS_PAYLOAD 42		// number of AIS bytes per NMEA sentence, to keep total NMEA sentence always below 82 characters
 #define NMEA_AIS_BITS (NMEA_MAX_AIS_PAYLOAD * 8)
-#define NMEA_AIS_BITS_ENCODED ((NMEA_AIS_BITS + 5) / 6)
 
-const char nmea_lead[] = "!AIVDM,";		// static start of NMEA sentence
-char nmea_buffer[8+NMEA_AIS_BITS_ENCODED+5+1];  // buffer for dynamic part of NMEA sentence
-                                                // fragment and channel info, AIS payload, stuff-bit and crc, 0-termination
-uint8_t nmea_buffer_index;				// current buffer position
+const char nmea_lead[] = "!AIVDM,";		// static start of NMEA sentence, the rest is sent as it is encoded
 
 #define NMEA_LEAD_CRC	'A' ^ 'I' ^ 'V' ^ 'D' ^ 'M' ^ ','		// CRC for static start of sentence
 uint8_t nmea_crc;						// calculated CRC
 
 uint8_t nmea_message_id = 0;			// sequential message id for multi-sentence message
 
+#ifdef TEST
+const char* nmea_expected = 0;			// if set, encoded characters are compared with it instead of sent
+uint8_t nmea_mismatch;					// an encoded character differed from nmea_expected
+#endif
+
 const char nmea_hex[] = { '0', '1', '2', '3',		// lookup table for hex conversion of CRC
 						  '4', '5', '6', '7',
 						  '8', '9', 'A', 'B',
@@ -43,12 +50,31 @@ void nmea_process_packet(void)
 	if (packet_size == 0 || packet_size < 4)	// check for empty packet
 		return;									// no (valid) packet available in FIFO, nothing to send
 
-	uint8_t radio_channel = fifo_read_byte() + 'A';	// retrieve radio channel (0=A, 1=B)
+	uint8_t radio_channel = fifo_read_byte();	// retrieve radio channel (0=A, 1=B)
+
+	nmea_source = 0;
+	nmea_send(radio_channel, packet_size - 3);	// Ignore channel information and AIS CRC
+}
+
+// transmit AIS payload from memory as NMEA sentence(s), e.g. a logged packet
+void nmea_send_packet(uint8_t radio_channel, const uint8_t* payload, uint8_t size)
+{
+	if (size == 0)
+		return;
+	nmea_source = payload;
+	nmea_send(radio_channel, size);
+	nmea_source = 0;
+}
+
+// encode payload of packet_size bytes from FIFO or nmea_source and send through UART
+void nmea_send(uint8_t radio_channel, uint16_t packet_size)
+{
+	uint8_t activity = duty_switch(DUTY_NMEA);
+	char channel = ph_channel_nmea(radio_channel);
 
 	// calculate number of fragments, NMEA allows 82 characters per sentence
 	//			-> max 62 6-bit characters payload
 	//			-> max 46 AIS bytes (368 bits) per sentence
-	packet_size -= 3;							// Ignore channel information and AIS CRC
 	uint8_t curr_fragment = 1;
 	uint8_t total_fragments = 1;
 	uint16_t packet_bits = packet_size * 8;
@@ -73,8 +99,8 @@ void nmea_process_packet(void)
 
 	// create fragments
 	while (packet_size > 0) {
-		// reset buffer and CRC
-		nmea_buffer_index = 0;
+		// start sentence and CRC
+		uart_send_string(nmea_lead);
 		nmea_crc = NMEA_LEAD_CRC;
 
 		// write fragment information, I assume total fragments always < 10
@@ -89,8 +115,9 @@ void nmea_process_packet(void)
 			nmea_push_char(nmea_message_id + '0');
 		nmea_push_char(',');
 
-		// write channel information
-		nmea_push_char(radio_channel);
+		// write channel information, empty if not on AIS 1 or 2
+		if (channel)
+			nmea_push_char(channel);
 		nmea_push_char(',');
 
 		// encode and write next NMEA_MAX_AIS_PAYLOAD bytes from AIS packet
@@ -112,24 +139,29 @@ void nmea_process_packet(void)
 		nmea_push_char(nmea_hex[final_crc >> 4]);
 		nmea_push_char(nmea_hex[final_crc & 0x0f]);
 
-		// terminate message with 0
-		nmea_push_char(0);
-
-		// send NMEA sentence over UART
-		uart_send_string(nmea_lead);
-		uart_send_string(nmea_buffer);
+		// terminate sentence
 		uart_send_string("\r\n");
 	}
+	duty_switch(activity);
 }
 
-// adds char to buffer and updates CRC
+// sends char of sentence and updates CRC
 inline void nmea_push_char(char c)
 {
 	nmea_crc ^= c;
-	nmea_buffer[nmea_buffer_index++] = c;
+#ifdef TEST
+	if (nmea_expected) {
+		if (*nmea_expected == c)
+			nmea_expected++;
+		else
+			nmea_mismatch = 1;
+		return;
+	}
+#endif
+	uart_send_byte(c);
 }
 
-// encodes and adds AIS packet to buffer, returns # of stuff bits
+// encodes and sends AIS packet, returns # of stuff bits
 uint8_t nmea_push_packet(uint8_t packet_size)
 {
 	uint8_t raw_byte;
@@ -142,7 +174,7 @@ uint8_t nmea_push_packet(uint8_t packet_size)
 	nmea_bit = 6;
 
 	while (packet_size != 0) {
-		raw_byte = fifo_read_byte();
+		raw_byte = nmea_source ? *nmea_source++ : fifo_read_byte();
 		raw_bit = 8;
 
 		while (raw_bit > 0) {
@@ -202,22 +234,15 @@ uint8_t test_nmea_verify_packet(const char* message)
 	packet_size -= 3;	// ignore CRC and readio channel
 	fifo_read_byte();	// discard radio channel
 
-	// encode message into nmea_buffer
-	nmea_buffer_index = 0;
+	// encode packet and compare it with message character by character
+	nmea_expected = message;
+	nmea_mismatch = 0;
 	nmea_push_packet(packet_size);
+	if (*nmea_expected)
+		nmea_mismatch = 1;	// error, message is longer
+	nmea_expected = 0;
 
-	// compare result with message
-	uint8_t i = 0;
-	while (i < nmea_buffer_index && message[i]) {
-		if (message[i] != nmea_buffer[i])
-			return 0;		// error, data not identical
-		i++;
-	}
-
-	if (i != nmea_buffer_index)
-		return 0;			// error, message length not identical
-
-	return 1;	// verification successful, no errors found
+	return !nmea_mismatch;	// 1 if verification successful, no errors found
 }
 
 #endif	// TEST
@@ -10,7 +10,9 @@
 #ifndef NMEA_H_
 #define NMEA_H_
 
+// the channel field is A or B if the packet's channel is tuned to AIS 1 or AIS 2, see ph_channel_nmea, otherwise empty
 void nmea_process_packet(void);			// create nmea sentences from current message in FIFO
+void nmea_send_packet(uint8_t radio_channel, const uint8_t* payload, uint8_t size);	// create nmea sentences from AIS payload without CRC
 
 // functions to test NMEA operation
 #ifdef TEST
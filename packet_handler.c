@@ -11,7 +11,10 @@
 
 #include "radio.h"
 #include "fifo.h"
+#include "uart.h"
+#include "event.h"
 #include "packet_handler.h"
+#include "duty.h"
 
 // LED helpers for debugging
 #define LED1	BIT0
@@ -22,14 +25,7 @@
 // sync word for AIS - only used for test
 #define AIS_SYNC_WORD		0x7e
 
-// paramters for package detection
-#define PH_PREAMBLE_LENGTH	8		// minimum number of alternating bits we need for a valid preamble
-#define PH_SYNC_TIMEOUT	16			// number of bits we wait for a preamble to start before changing channel
-//#define PH_RSSI_THRESHOLD -95		// threshold in dBm for valid signal, comment out to ignore signal strength
-
-// pins that packet handler uses to receive data
-#define	PH_DATA_CLK_PIN		RADIO_GPIO_2	// RX data clock
-#define PH_DATA_PIN			RADIO_GPIO_3	// RX data
+// port of DATA_CLK and DATA pins of all radios, see data_clk and data of radio_pins_s
 #define PH_DATA_PORT		RADIO_PORT	  	// data pins are on port 2 (only ports 1 and 2 supported)
 
 // data port dependent defines
@@ -63,328 +59,916 @@ enum PH_SYNC_STATE {
 	PH_SYNC_FLAG				// detecting start flag
 };
 
-volatile uint8_t ph_state = PH_STATE_OFF;
-volatile uint8_t ph_last_error = PH_ERROR_NONE;
-volatile uint8_t ph_radio_channel = 0;
-volatile uint8_t ph_message_type = 0;
-volatile int16_t ph_rssi = 0;
+static volatile uint8_t ph_hop = PH_HOP_AB;	// channels to hop between, bit n for channel n, dealt to radios by ph_start
+
+// default channel table, PLL words as computed by ph_channel_pll, channel A is identical to radio_config.h
+const struct ph_channel_s ph_default_channels[PH_CHANNELS] = {
+	{ { 0x46, 0x51, 0xeb }, 1 },	// 161.975MHz AIS 1, INTE 0x3f FRAC 0x0e51eb
+	{ { 0x46, 0x7a, 0xe1 }, 1 },	// 162.025MHz AIS 2, INTE 0x3f FRAC 0x0e7ae1
+	{ { 0x35, 0xae, 0x14 }, 1 },	// 156.775MHz AIS 75, long range, INTE 0x3d FRAC 0x0dae14
+	{ { 0x35, 0xd7, 0x0a }, 1 }		// 156.825MHz AIS 76, long range, INTE 0x3d FRAC 0x0dd70a
+};
+static const struct ph_channel_s* ph_channels = ph_default_channels;
+static uint8_t ph_preamble_length = PH_PREAMBLE_LENGTH;
+static uint8_t ph_sync_timeout = PH_SYNC_TIMEOUT;
+static int8_t ph_rssi_threshold = PH_RSSI_THRESHOLD;
+static uint8_t ph_rssi_margin = PH_RSSI_MARGIN;
+static uint8_t ph_cca = 0;				// abort packets when radio's CCA pin drops, fixed or adaptive threshold set
+
+// noise floor, tracked while waiting for a sync
+#define PH_NOISE_SAMPLE_BIT		8		// RSSI sample this many bits after reset, radio has settled after hop
+#define PH_RSSI_CONTROL			0x00	// MODEM_RSSI_CONTROL without latch, FRR A (LATCHED_RSSI) follows current RSSI
+#define PH_NOISE_MAX_PREAMBLE	4		// no sample if that many preamble bits were already detected
+#define PH_NOISE_STEP_DOWN		8		// tracking steps per sample in 1/16 of RSSI register unit (0.5dB),
+#define PH_NOISE_STEP_UP		1		// estimate settles where 1/9 of samples are lower, packets don't drag it up
+#define PH_THRESHOLD_HYSTERESIS	2		// RSSI register units the threshold moves before radio is updated
+static uint16_t ph_noise[PH_CHANNELS];	// low percentile of idle RSSI per channel, RSSI register value * 16, 0 = no sample yet
+static uint8_t ph_get_threshold(uint8_t channel);
+
+// signal of packets, sampled by ISR while receiving, kept for the last few packets committed to FIFO
+#define PH_QUALITY_NOISE_FLOOR	-110	// dBm, reference for quality until noise floor of channel is tracked
+#define PH_PACKET_INFOS			2		// must be 2^x, more packets waiting in FIFO have no info
+struct ph_rssi_s {
+	uint8_t slot;						// packet index in FIFO
+	uint8_t sync;						// RSSI register values, sync 0 = not sampled
+	uint8_t mean;
+	uint8_t min;
+	uint8_t samples;					// 1 + bits after start flag / PH_RSSI_SAMPLE_BITS
+	uint8_t modem_status;				// FRR C at sync
+};
+static struct ph_rssi_s ph_rssi[PH_PACKET_INFOS];	// by packet index in FIFO
+
+// packet handler instance of each radio, channels of the hop policy are dealt to radios in turn
+struct ph_radio_s {
+	struct ph_context_s ctx;			// decoder of the radio's DATA pin
+	uint8_t hop;						// channels this radio hops between, 0 = radio is off
+	uint8_t dwell;						// reset periods left on current channel
+	uint8_t threshold;					// RSSI threshold configured in radio, register value
+	uint8_t xo_tune;					// XO_TUNE configured in radio, updated to ph_xo_tune on next hop
+	uint8_t rssi_sync;					// RSSI at sync of packet being received, register value
+	uint8_t modem_status;				// modem status at sync of packet being received
+	uint16_t rssi_sum;					// samples of packet being received
+	uint8_t rssi_samples;
+	uint8_t rssi_min;					// weakest sample of packet being received
+	uint8_t rssi_bits;					// bits since last sample
+	struct ph_activity_s activity;		// supervised by main loop
+};
+static struct ph_radio_s ph_radios[RADIO_DEVICES];
+
+// with more than one radio each decodes into its own FIFO, ph_poll merges packets into fifo_default
+#if (RADIO_DEVICES > 1)
+static struct fifo_s ph_fifo[RADIO_DEVICES];
+static struct ph_rssi_s ph_info[RADIO_DEVICES][PH_PACKET_INFOS];	// by packet index in FIFO of radio
+#define PH_INFO(n)	ph_info[n]
+#else
+#define PH_INFO(n)	ph_rssi
+#endif
+
+// crystal calibration, learns direction of XO_TUNE if a step makes the offset worse
+// radios share the reference, AFC offsets of all radios calibrate one XO_TUNE
+static uint8_t ph_xo_tune = RADIO_XO_TUNE_DEFAULT;
+static volatile uint8_t ph_xo_calibrate = 0;
+static int8_t ph_xo_direction = -1;		// XO_TUNE step for positive offset, higher capacitance lowers frequency
+static volatile int32_t ph_xo_sum;		// AFC offsets of packets since last step, added by ISR
+static volatile uint8_t ph_xo_count;	// ISR stops adding at PH_XO_PACKETS, ph_xo_step then owns ph_xo_sum
+static int16_t ph_xo_stepped = -1;		// mean offset in Hz before last step, -1 if last period didn't step
+
+// time base, counts DATA_CLK cycles at AIS bit rate
+#define PH_BIT_RATE		9600
+static volatile uint16_t ph_clock_bits;	// bits in current second
+static volatile uint32_t ph_seconds;	// seconds of reception since start
+
+// raw bit stream
+static volatile uint8_t ph_raw_enabled = 0;
+static uint8_t ph_raw_byte;				// raw bits not sent yet
+static uint8_t ph_raw_count;			// number of bits in ph_raw_byte
+static uint8_t ph_raw_overflow;			// bytes were dropped, send mark before next byte
 
 // setup packet handler
 void ph_setup(void)
 {
-	// configure data pins as inputs
-	PH_DATA_SEL &= ~(PH_DATA_CLK_PIN | PH_DATA_PIN);
-	PH_DATA_DIR &= ~(PH_DATA_CLK_PIN | PH_DATA_PIN);
+	uint8_t n;
+
 	fifo_reset();
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		struct ph_radio_s* r = &ph_radios[n];
+		const struct radio_pins_s* pins = radio_devices[n].pins;
+
+		// configure data pins as inputs
+		PH_DATA_SEL &= ~(pins->data_clk | pins->data);
+		PH_DATA_DIR &= ~(pins->data_clk | pins->data);
+#if (RADIO_DEVICES > 1)
+		fifo_ctx_reset(&ph_fifo[n]);
+		ph_context_init(&r->ctx, &ph_fifo[n], 0);
+#else
+		ph_context_init(&r->ctx, &fifo_default, 0);
+#endif
+		r->ctx.radio = &radio_devices[n];
+		r->ctx.state = PH_STATE_OFF;
+	}
 }
 
-// start packet handler operation, including ISR
-void ph_start(void)
+#if !defined(TEST) || defined(RADIO_MOCK)
+// set PLL of radio to frequency of channel, radio tunes with next radio_start_rx
+static void ph_tune(struct radio_s* radio, uint8_t channel)
 {
+	uint8_t pll[4];
 
-#ifndef TEST
-	#ifdef PH_RSSI_THRESHOLD
-	// set radio RSSI threshold
-	radio_set_property(0x20, 0x4a, RADIO_DBM_TO_RSSI(PH_RSSI_THRESHOLD));
-	#endif
-
-	// start radio, wait until it's spun up
-	radio_start_rx(ph_radio_channel, 0, 0, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE);
-	radio_wait_for_CTS();
+	ph_channel_words(&ph_channels[channel], pll);
+	radio_set_frequency(radio, pll);
+}
 #endif
 
-	// reset packet handler state machine
-	ph_last_error = PH_ERROR_NONE;
-	ph_radio_channel = 0;
-	ph_state = PH_STATE_RESET;
+// start receiving on the first channel of a radio, a radio without channels stays off
+static void ph_start_radio(uint8_t n)
+{
+	struct ph_radio_s* r = &ph_radios[n];
+	uint8_t channel = 0;
 
-	// enable interrupt on positive edge of pin wired to DATA_CLK (GPIO2 as configured in radio_config.h)
-	PH_DATA_IES &= ~PH_DATA_CLK_PIN;
-	PH_DATA_IE |= PH_DATA_CLK_PIN;
-	_BIS_SR(GIE);      			// enable interrupts
+	if (!r->hop)
+		return;
+	while (!(r->hop & (1 << channel)))		// start on first channel of hop policy
+		channel++;
+	r->ctx.radio_channel = channel;
+	r->dwell = ph_channels[channel].dwell;
 
-	// ISR is now running and will operate radio, don't call radio library until ph ISR is stopped.
-}
+#if !defined(TEST) || defined(RADIO_MOCK)
+	// set radio RSSI threshold
+	if (ph_cca) {
+		r->threshold = ph_get_threshold(channel);
+		radio_set_property(r->ctx.radio, 0x20, 0x4a, r->threshold);
+	}
 
-// interrupt handler for receiving raw modem data via DATA/DATA_CLK pins
-#pragma vector=PH_DATA_PORT_VECTOR
-__interrupt void ph_irq_handler(void)
-{
-	static uint16_t rx_bitstream;				// shift register with incoming data
-	static uint16_t rx_bit_count;				// bit counter for various purposes
-	static uint16_t rx_crc;						// word for AIS payload CRC calculation
-	static uint8_t rx_one_count;				// counter of 1's to identify stuff bits
-	static uint8_t rx_data_byte;				// byte to receive actual package data
-	uint8_t rx_this_bit_NRZI;					// current bit for NRZI decoding
-	static uint8_t rx_prev_bit_NRZI;			// previous bit for NRZI decoding
-	uint8_t rx_bit;								// current decoded bit
-	static uint8_t rx_sync_state;				// state of preamble and start flag detection
-	static uint8_t rx_sync_count;				// length of valid bits in current sync sequence
+	// set crystal load capacitance
+	r->xo_tune = ph_xo_tune;
+	radio_set_property(r->ctx.radio, 0x00, 0x00, r->xo_tune);
 
-	uint8_t wake_up = 0;						// if set, LPM bits will be cleared
+	// RSSI is read through FRR A, radio_config.h latches it once after RX start
+	radio_set_property(r->ctx.radio, 0x20, 0x4c, PH_RSSI_CONTROL);
 
-	LED1_ON;
+	// start radio on frequency of channel, wait until it's spun up
+	ph_tune(r->ctx.radio, channel);
+	radio_start_rx(r->ctx.radio, 0, 0, 0, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE);
+	radio_wait_for_CTS(r->ctx.radio);
+#endif
 
-	if ((PH_DATA_IFG & PH_DATA_CLK_PIN)			// verify this interrupt is from DATA_CLK/GPIO_2 pin
-			&& RADIO_READY) {					// and only process data received while radio ready
+	// reset packet handler state machine
+	r->ctx.last_error = PH_ERROR_NONE;
+	r->ctx.state = PH_STATE_RESET;
 
-		// read data bit and decode NRZI
-		if (PH_DATA_IN & PH_DATA_PIN)						// read encoded data bit from line
-			rx_this_bit_NRZI = 1;
-		else
-			rx_this_bit_NRZI = 0;
+	// enable interrupt on positive edge of pin wired to DATA_CLK (GPIO2 as configured in radio_config.h)
+	PH_DATA_IES &= ~r->ctx.radio->pins->data_clk;
+	PH_DATA_IE |= r->ctx.radio->pins->data_clk;
+}
 
-		rx_bit = !(rx_prev_bit_NRZI ^ rx_this_bit_NRZI); 	// NRZI decoding: change = 0-bit, no change = 1-bit, i.e. 00,11=>1, 01,10=>0, i.e. NOT(A XOR B)
-		rx_prev_bit_NRZI = rx_this_bit_NRZI;				// store encoded bit for next round of decoding
+// start packet handler operation, including ISR
+void ph_start(void)
+{
+	uint8_t channel;
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++)
+		ph_radios[n].hop = 0;
+	n = 0;
+	for (channel = 0; channel < PH_CHANNELS; channel++) {	// deal channels of hop policy to radios in turn
+		if (ph_hop & (1 << channel)) {
+			ph_radios[n].hop |= 1 << channel;
+			if (++n == RADIO_DEVICES)
+				n = 0;
+		}
+	}
 
-		// add decoded bit to bit-stream (receiving LSB first)
-		rx_bitstream >>= 1;
-		if (rx_bit)
-			rx_bitstream |= 0x8000;
+	for (n = 0; n < RADIO_DEVICES; n++)
+		ph_start_radio(n);
+	_BIS_SR(GIE);      			// enable interrupts
 
-		// packet handler state machine
-		switch (ph_state) {
+	// ISR is now running and will operate radio, don't call radio library until ph ISR is stopped.
+}
 
-	// STATE: OFF
-		case PH_STATE_OFF:									// state: off, do nothing
-			break;
+// reset decoder state of a bit stream
+void ph_context_init(struct ph_context_s* ctx, struct fifo_s* fifo, uint8_t channel)
+{
+	ctx->fifo = fifo;
+	ctx->radio = 0;
+	ctx->state = PH_STATE_RESET;
+	ctx->last_error = PH_ERROR_NONE;
+	ctx->radio_channel = channel;
+	ctx->message_type = 0;
+	ctx->rx_bitstream = 0;
+	ctx->rx_bit_count = 0;
+	ctx->rx_crc = 0;
+	ctx->rx_one_count = 0;
+	ctx->rx_data_byte = 0;
+	ctx->rx_prev_bit_NRZI = 0;
+	ctx->rx_sync_state = PH_SYNC_RESET;
+	ctx->rx_sync_count = 0;
+}
 
-	// STATE: RESET
-		case PH_STATE_RESET:								// state: reset, prepare state machine for next packet
-			rx_bitstream &= 8000;							// reset bit-stream (but don't throw away incoming bit)
-			rx_bit_count = 0;								// reset bit counter
-			fifo_new_packet();								// reset fifo packet
-			fifo_write_byte(ph_radio_channel);				// indicate channel for this packet
-			ph_state = PH_STATE_WAIT_FOR_SYNC;				// next state: wait for training sequence
-			rx_sync_state = PH_SYNC_RESET;
+// decode one raw bit: NRZI, preamble and start flag detection, de-stuffing and CRC
+uint8_t ph_process_bit(struct ph_context_s* ctx, uint8_t rx_this_bit_NRZI)
+{
+	uint8_t rx_bit;								// current decoded bit
+	uint8_t events = 0;
+
+	rx_bit = !(ctx->rx_prev_bit_NRZI ^ rx_this_bit_NRZI);	// NRZI decoding: change = 0-bit, no change = 1-bit, i.e. 00,11=>1, 01,10=>0, i.e. NOT(A XOR B)
+	ctx->rx_prev_bit_NRZI = rx_this_bit_NRZI;				// store encoded bit for next round of decoding
+
+	// add decoded bit to bit-stream (receiving LSB first)
+	ctx->rx_bitstream >>= 1;
+	if (rx_bit)
+		ctx->rx_bitstream |= 0x8000;
+
+	// packet handler state machine
+	switch (ctx->state) {
+
+// STATE: OFF
+	case PH_STATE_OFF:									// state: off, do nothing
+		break;
+
+// STATE: RESET
+	case PH_STATE_RESET:								// state: reset, prepare state machine for next packet
+		ctx->rx_bitstream &= 8000;							// reset bit-stream (but don't throw away incoming bit)
+		ctx->rx_bit_count = 0;								// reset bit counter
+		fifo_ctx_new_packet(ctx->fifo);								// reset fifo packet
+		fifo_ctx_write_byte(ctx->fifo, ctx->radio_channel);				// indicate channel for this packet
+		ctx->state = PH_STATE_WAIT_FOR_SYNC;				// next state: wait for training sequence
+		ctx->rx_sync_state = PH_SYNC_RESET;
+		break;
+
+// STATE: WAIT FOR PREAMBLE AND START FLAG
+	case PH_STATE_WAIT_FOR_SYNC:						// state: waiting for preamble and start flag
+		ctx->rx_bit_count++;									// count processed bits since reset
+
+  // START OF SYNC STATE MACHINE
+		switch (ctx->rx_sync_state) {
+
+	// SYNC STATE: RESET
+		case PH_SYNC_RESET:								// sub-state: (re)start sync process
+			if (ctx->rx_bit_count > ph_sync_timeout)			// if we exceeded sync time out
+				ctx->state = PH_STATE_RESET;				// reset state machine, will trigger channel hop
+			else {										// else
+				ctx->rx_sync_count = 0;						// start new preamble
+				if (rx_bit)
+					ctx->rx_sync_state = PH_SYNC_1;			// we started with a 1
+				else
+					ctx->rx_sync_state = PH_SYNC_0;			// we started with a 0
+			}
 			break;
 
-	// STATE: WAIT FOR PREAMBLE AND START FLAG
-		case PH_STATE_WAIT_FOR_SYNC:						// state: waiting for preamble and start flag
-			rx_bit_count++;									// count processed bits since reset
-
-	  // START OF SYNC STATE MACHINE
-			switch (rx_sync_state) {
-
-		// SYNC STATE: RESET
-			case PH_SYNC_RESET:								// sub-state: (re)start sync process
-				if (rx_bit_count > PH_SYNC_TIMEOUT)			// if we exceeded sync time out
-					ph_state = PH_STATE_RESET;				// reset state machine, will trigger channel hop
-				else {										// else
-					rx_sync_count = 0;						// start new preamble
-					if (rx_bit)
-						rx_sync_state = PH_SYNC_1;			// we started with a 1
-					else
-						rx_sync_state = PH_SYNC_0;			// we started with a 0
-				}
-				break;
-
-		  // SYNC STATE: 0-BIT
-			case PH_SYNC_0:									// sub-state: last bit was a 0
-				if (rx_bit) {								// if we get a 1
-					rx_sync_count++;							// valid preamble bit
-					rx_sync_state = PH_SYNC_1;					// next state
-				} else {									// if we get another 0
-					if (rx_sync_count > PH_PREAMBLE_LENGTH)	{	// if we have a sufficient preamble length
-						rx_sync_count = 7;							// treat this as part of start flag, we already have 1 out of 8 bits (0.......)
-						rx_sync_state = PH_SYNC_FLAG;				// next state flag detection
-					}
-					else										// if not
-						rx_sync_state = PH_SYNC_RESET;				// invalid preamble bit, restart preamble detection
-				}
-				break;
-
-		  // SYNC STATE: 1-BIT
-			case PH_SYNC_1:									// sub-state: last bit was a 1
-				if (!rx_bit) {								// if we get a 0
-					rx_sync_count++;							// valid preamble bit
-					rx_sync_state = PH_SYNC_0;					// next state
-				} else {									// if we get another 1
-					if (rx_sync_count > PH_PREAMBLE_LENGTH)	{	// if we have a sufficient preamble length
-						rx_sync_count = 5;							// treat this as part of start flag, we already have 3 out of 8 bits (011.....)
-						rx_sync_state = PH_SYNC_FLAG;				// next state flag detection
-					}
-					else										// if not
-						rx_sync_state = PH_SYNC_RESET;				// treat this as invalid preamble bit
+	  // SYNC STATE: 0-BIT
+		case PH_SYNC_0:									// sub-state: last bit was a 0
+			if (rx_bit) {								// if we get a 1
+				ctx->rx_sync_count++;							// valid preamble bit
+				ctx->rx_sync_state = PH_SYNC_1;					// next state
+			} else {									// if we get another 0
+				if (ctx->rx_sync_count > ph_preamble_length)	{	// if we have a sufficient preamble length
+					ctx->rx_sync_count = 7;							// treat this as part of start flag, we already have 1 out of 8 bits (0.......)
+					ctx->rx_sync_state = PH_SYNC_FLAG;				// next state flag detection
 				}
-				break;
+				else										// if not
+					ctx->rx_sync_state = PH_SYNC_RESET;				// invalid preamble bit, restart preamble detection
+			}
+			break;
 
-		  // SYNC STATE: START FLAG
-			case PH_SYNC_FLAG:								// sub-state: start flag detection
-				rx_sync_count--;							// count down bits
-#ifndef TEST
-#ifdef PH_RSSI_THRESHOLD
-				if (!RADIO_SIGNAL) {						// if we don't have a stable signal
-					ph_state = PH_STATE_RESET;					// abort sync and reset state machine
-					break;
+	  // SYNC STATE: 1-BIT
+		case PH_SYNC_1:									// sub-state: last bit was a 1
+			if (!rx_bit) {								// if we get a 0
+				ctx->rx_sync_count++;							// valid preamble bit
+				ctx->rx_sync_state = PH_SYNC_0;					// next state
+			} else {									// if we get another 1
+				if (ctx->rx_sync_count > ph_preamble_length)	{	// if we have a sufficient preamble length
+					ctx->rx_sync_count = 5;							// treat this as part of start flag, we already have 3 out of 8 bits (011.....)
+					ctx->rx_sync_state = PH_SYNC_FLAG;				// next state flag detection
 				}
-#endif
-#endif
-				if (rx_sync_count != 0) {					// if this is not the last bit of start flag
-					if (!rx_bit)								// we expect a 1, 0 is an error
-						rx_sync_state = PH_SYNC_RESET;			// restart preamble detection
-				} else {									// if this is the last bit of start flag
-					if (!rx_bit) {								// we expect a 0
-#ifndef TEST
-						radio_frr_read('A', 1);						// read fetched RSSI from FRR
-						ph_rssi = RADIO_RSSI_TO_DBM(radio_buffer.data[0]);	// convert RSSI into dBm
-#endif
-						rx_bit_count = 0;							// reset bit counter
-						ph_state = PH_STATE_PREFETCH;				// next state: start receiving packet
-						wake_up = 1;								// main thread might want to do something on sync detect
-					} else										// 1 is an error
-						rx_sync_state = PH_SYNC_RESET;				// restart preamble detection
-				}
-				break;
+				else										// if not
+					ctx->rx_sync_state = PH_SYNC_RESET;				// treat this as invalid preamble bit
 			}
-		// END OF SYNC STATE MACHINE - preamble and start flag detected
 			break;
 
-	// STATE: PREFETCH FIRST PACKET BYTE
-		case PH_STATE_PREFETCH:								// state: pre-fill receive buffer with 8 bits
-			rx_bit_count++;									// increase bit counter
-#ifndef TEST
-#ifdef PH_RSSI_THRESHOLD
-			if (!RADIO_SIGNAL) {							// if we don't have a stable signal
-				ph_last_error = PH_ERROR_RSSI_DROP;				// report error
-				ph_state = PH_STATE_RESET;						// abort package
+	  // SYNC STATE: START FLAG
+		case PH_SYNC_FLAG:								// sub-state: start flag detection
+			ctx->rx_sync_count--;							// count down bits
+#if !defined(TEST) || defined(RADIO_MOCK)
+			if (ph_cca && ctx->radio && !RADIO_SIGNAL(ctx->radio)) {				// if we don't have a stable signal
+				ctx->state = PH_STATE_RESET;					// abort sync and reset state machine
 				break;
 			}
 #endif
-#endif
-			if (rx_bit_count == 8) {						// after 8 bits arrived
-				rx_bit_count = 0;							// reset bit counter
-				rx_one_count = 0;							// reset counter for stuff bits
-				rx_data_byte = 0;							// reset buffer for data byte
-				rx_crc = 0xffff;							// init CRC calculation
-				ph_state = PH_STATE_RECEIVE_PACKET;			// next state: receive and process packet
-				ph_message_type = rx_bitstream >> 10;		// store AIS message type for debugging
-				break;
+			if (ctx->rx_sync_count != 0) {					// if this is not the last bit of start flag
+				if (!rx_bit)								// we expect a 1, 0 is an error
+					ctx->rx_sync_state = PH_SYNC_RESET;			// restart preamble detection
+			} else {									// if this is the last bit of start flag
+				if (!rx_bit) {								// we expect a 0
+					ctx->rx_bit_count = 0;							// reset bit counter
+					ctx->state = PH_STATE_PREFETCH;				// next state: start receiving packet
+					events |= PH_EVENT_SYNC;					// caller might want to read RSSI and wake up main thread
+				} else										// 1 is an error
+					ctx->rx_sync_state = PH_SYNC_RESET;				// restart preamble detection
 			}
+			break;
+		}
+	// END OF SYNC STATE MACHINE - preamble and start flag detected
+		break;
+
+// STATE: PREFETCH FIRST PACKET BYTE
+	case PH_STATE_PREFETCH:								// state: pre-fill receive buffer with 8 bits
+		ctx->rx_bit_count++;									// increase bit counter
+#if !defined(TEST) || defined(RADIO_MOCK)
+		if (ph_cca && ctx->radio && !RADIO_SIGNAL(ctx->radio)) {					// if we don't have a stable signal
+			ctx->last_error = PH_ERROR_RSSI_DROP;				// report error
+			ctx->state = PH_STATE_RESET;						// abort package
+			break;
+		}
+#endif
+		if (ctx->rx_bit_count == 8) {						// after 8 bits arrived
+			ctx->rx_bit_count = 0;							// reset bit counter
+			ctx->rx_one_count = 0;							// reset counter for stuff bits
+			ctx->rx_data_byte = 0;							// reset buffer for data byte
+			ctx->rx_crc = 0xffff;							// init CRC calculation
+			ctx->state = PH_STATE_RECEIVE_PACKET;			// next state: receive and process packet
+			ctx->message_type = ctx->rx_bitstream >> 10;		// store AIS message type for debugging
+			break;
+		}
 
-			break;											// do nothing for the first 8 bits to fill buffer
+		break;											// do nothing for the first 8 bits to fill buffer
 
-	// STATE: RECEIVE PACKET
-		case PH_STATE_RECEIVE_PACKET:						// state: receiving packet data
-#ifndef TEST
-#ifdef PH_RSSI_THRESHOLD
-			if (!RADIO_SIGNAL) {							// if we don't have a stable signal
-				ph_last_error = PH_ERROR_RSSI_DROP;				// report error
-				ph_state = PH_STATE_RESET;						// abort package
-				break;
-			}
-#endif
+// STATE: RECEIVE PACKET
+	case PH_STATE_RECEIVE_PACKET:						// state: receiving packet data
+#if !defined(TEST) || defined(RADIO_MOCK)
+		if (ph_cca && ctx->radio && !RADIO_SIGNAL(ctx->radio)) {					// if we don't have a stable signal
+			ctx->last_error = PH_ERROR_RSSI_DROP;				// report error
+			ctx->state = PH_STATE_RESET;						// abort package
+			break;
+		}
 #endif
-			rx_bit = rx_bitstream & 0x80;					// extract data bit for processing
-
-			if (rx_one_count == 5) {						// if we expect a stuff-bit..
-				if (rx_bit) {								// if stuff bit is not zero the packet is invalid
-					ph_last_error = PH_ERROR_STUFFBIT;		// report invalid stuff-bit error
-					ph_state = PH_STATE_RESET;				// reset state machine
-				} else
-					rx_one_count = 0;						// else ignore bit and reset stuff-bit counter
-				break;
-			}
+		rx_bit = ctx->rx_bitstream & 0x80;					// extract data bit for processing
 
-			rx_data_byte = rx_data_byte >> 1 | rx_bit;		// shift bit into current data byte
-
-			if (rx_bit) {									// if current bit is a 1
-				rx_one_count++;								// count 1's to identify stuff bit
-				rx_bit = 1;									// avoid shifting for CRC
+		if (ctx->rx_one_count == 5) {						// if we expect a stuff-bit..
+			if (rx_bit) {								// if stuff bit is not zero the packet is invalid
+				ctx->last_error = PH_ERROR_STUFFBIT;		// report invalid stuff-bit error
+				ctx->state = PH_STATE_RESET;				// reset state machine
 			} else
-				rx_one_count = 0;							// or reset stuff-bit counter
+				ctx->rx_one_count = 0;						// else ignore bit and reset stuff-bit counter
+			break;
+		}
 
-			if (rx_bit ^ (rx_crc & 0x0001))					// CCITT CRC calculation (according to Dr. Dobbs)
-				rx_crc = (rx_crc >> 1) ^ 0x8408;
-			else
-				rx_crc >>= 1;
+		ctx->rx_data_byte = ctx->rx_data_byte >> 1 | rx_bit;		// shift bit into current data byte
 
-			if ((rx_bit_count & 0x07)==0x07) {				// every 8th bit.. (counter started at 0)
-				fifo_write_byte(rx_data_byte);				// add buffered byte to FIFO
-				rx_data_byte = 0;							// reset buffer
-			}
+		if (rx_bit) {									// if current bit is a 1
+			ctx->rx_one_count++;								// count 1's to identify stuff bit
+			rx_bit = 1;									// avoid shifting for CRC
+		} else
+			ctx->rx_one_count = 0;							// or reset stuff-bit counter
 
-			rx_bit_count++;									// count valid, de-stuffed data bits
+		if (rx_bit ^ (ctx->rx_crc & 0x0001))					// CCITT CRC calculation (according to Dr. Dobbs)
+			ctx->rx_crc = (ctx->rx_crc >> 1) ^ 0x8408;
+		else
+			ctx->rx_crc >>= 1;
 
-			if ((rx_bitstream & 0xff00) == 0x7e00) {		// if we found the end flag 0x7e we're done
-				if (rx_crc != 0xf0b8)						// if CRC verification failed
-					ph_last_error = PH_ERROR_CRC;			// report CRC error
-				else {
-					fifo_commit_packet();					// else commit packet in FIFO
-				}
-				ph_state = PH_STATE_RESET;					// reset state machine
-				break;
-			}
+		if ((ctx->rx_bit_count & 0x07)==0x07) {				// every 8th bit.. (counter started at 0)
+			fifo_ctx_write_byte(ctx->fifo, ctx->rx_data_byte);				// add buffered byte to FIFO
+			ctx->rx_data_byte = 0;							// reset buffer
+		}
 
-			if (rx_bit_count > 1020) {						// if packet is too long, it's probably invalid
-				ph_last_error = PH_ERROR_NOEND;				// report error
-				ph_state = PH_STATE_RESET;					// reset state machine
-				break;
+		ctx->rx_bit_count++;									// count valid, de-stuffed data bits
+
+		if ((ctx->rx_bitstream & 0xff00) == 0x7e00) {		// if we found the end flag 0x7e we're done
+			if (ctx->rx_crc != 0xf0b8)						// if CRC verification failed
+				ctx->last_error = PH_ERROR_CRC;			// report CRC error
+			else {
+				fifo_ctx_commit_packet(ctx->fifo);					// else commit packet in FIFO
+				events |= PH_EVENT_PACKET;
 			}
+			ctx->state = PH_STATE_RESET;					// reset state machine
+			break;
+		}
 
+		if (ctx->rx_bit_count > 1020) {						// if packet is too long, it's probably invalid
+			ctx->last_error = PH_ERROR_NOEND;				// report error
+			ctx->state = PH_STATE_RESET;					// reset state machine
 			break;
 		}
+
+		break;
+	}
 // END OF PACKET HANDLER STATE MACHINE
 
-		if (ph_state == PH_STATE_RESET) {					// if next state is reset
-			ph_radio_channel ^= 1;							// toggle radio channel between 0 and 1
-#ifndef TEST
-			radio_start_rx(ph_radio_channel, 0, 0, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE); // initiate channel hop
+	if (ctx->state == PH_STATE_RESET)				// if next state is reset
+		events |= PH_EVENT_RESET;					// caller might hop channel and wake up main thread
+
+	return events;
+}
+
+// percentile tracker, moves a small step towards each sample, down faster than up
+static void ph_track_noise(uint8_t channel, uint8_t rssi)
+{
+	uint16_t sample = (uint16_t) rssi << 4;
+	uint16_t noise = ph_noise[channel];
+
+	if (noise == 0)
+		noise = sample;								// first sample
+	else if (sample > noise)
+		noise += PH_NOISE_STEP_UP;
+	else if (sample + PH_NOISE_STEP_DOWN < noise)
+		noise -= PH_NOISE_STEP_DOWN;
+	else
+		noise = sample;
+	ph_noise[channel] = noise ? noise : 1;
+}
+
+// RSSI threshold for channel as radio register value, margin above noise floor but not below fixed threshold
+static uint8_t ph_get_threshold(uint8_t channel)
+{
+	uint16_t threshold = 0;
+
+	if (ph_rssi_margin && ph_noise[channel])
+		threshold = (ph_noise[channel] >> 4) + (ph_rssi_margin << 1);
+	if (ph_rssi_threshold && threshold < RADIO_DBM_TO_RSSI(ph_rssi_threshold))
+		threshold = RADIO_DBM_TO_RSSI(ph_rssi_threshold);
+	return threshold > 0xff ? 0xff : threshold;
+}
+
+// average collected AFC offsets and step XO_TUNE towards zero offset
+uint8_t ph_xo_step(void)
+{
+	int16_t offset, error;
+	uint8_t tune = ph_xo_tune;
+
+	if (ph_xo_count < PH_XO_PACKETS)
+		return 0;
+
+	offset = RADIO_AFC_TO_HZ(ph_xo_sum / PH_XO_PACKETS);
+	error = offset < 0 ? -offset : offset;
+	ph_xo_sum = 0;
+	ph_xo_count = 0;								// ISR adds again
+
+	if (ph_xo_stepped >= 0 && error > ph_xo_stepped) {		// last step made it worse, go back and the other way
+		ph_xo_direction = -ph_xo_direction;
+		tune += 2 * (offset > 0 ? ph_xo_direction : -ph_xo_direction);
+		ph_xo_stepped = -1;
+	} else if (error > PH_XO_HYSTERESIS) {
+		tune += offset > 0 ? ph_xo_direction : -ph_xo_direction;
+		ph_xo_stepped = error;
+	} else
+		ph_xo_stepped = -1;
+
+	if (tune == ph_xo_tune || tune > RADIO_XO_TUNE_MAX || tune + PH_XO_RANGE < RADIO_XO_TUNE_DEFAULT
+			|| tune > RADIO_XO_TUNE_DEFAULT + PH_XO_RANGE)
+		return 0;										// no step or out of range, includes wrap around of uint8_t
+	ph_xo_tune = tune;							// radios are updated on next hop
+	return 1;
+}
+
+// queue raw bits and mark, neither waits for UART, bytes are dropped if it can't keep up
+static void ph_raw_queue(uint8_t data)
+{
+	if (ph_raw_overflow) {
+		if (!uart_queue_byte(PH_RAW_MARK_OVERFLOW))
+			return;
+		ph_raw_overflow = 0;
+	}
+	if (!uart_queue_byte(data))
+		ph_raw_overflow = 1;
+}
+
+static void ph_raw_flush(uint8_t mark)
+{
+	if (ph_raw_count)									// partial or complete data byte
+		ph_raw_queue(ph_raw_byte);
+	if (mark)
+		ph_raw_queue(mark);
+	ph_raw_byte = 0;
+	ph_raw_count = 0;
+}
+
+// start/stop raw bit stream, the UART must be fast enough for 9600 bps in 7 bit groups, i.e. 19200 baud or more
+void ph_set_raw_stream(uint8_t enable)
+{
+	_BIC_SR(GIE);								// don't let ISR hop while starting
+	ph_raw_count = 0;
+	ph_raw_overflow = 0;
+	if (enable && !ph_raw_enabled)
+		ph_raw_flush(PH_RAW_MARK_HOP | (ph_radios[0].ctx.radio_channel << 3));
+	ph_raw_enabled = enable;
+	_BIS_SR(GIE);
+}
+
+uint8_t ph_get_raw_stream(void)
+{
+	return ph_raw_enabled;
+}
+
+// interrupt handler for receiving raw modem data via DATA/DATA_CLK pins
+#pragma vector=PH_DATA_PORT_VECTOR
+__interrupt void ph_irq_handler(void)
+{
+	DUTY_ISR_START();
+	uint8_t wake_up = 0;						// if set, LPM bits will be cleared
+	uint8_t n;
+
+	LED1_ON;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		struct ph_radio_s* r = &ph_radios[n];
+		struct radio_s* radio = r->ctx.radio;
+
+		if (!(PH_DATA_IFG & radio->pins->data_clk))	// verify this interrupt is from DATA_CLK/GPIO_2 pin of radio
+			continue;
+		PH_DATA_IFG &= ~radio->pins->data_clk;
+		if (r->ctx.state == PH_STATE_OFF || !RADIO_READY(radio))	// only process data received while radio ready
+			continue;
+		r->activity.clocks++;
+
+		if (n == 0 && ++ph_clock_bits == PH_BIT_RATE) {	// keep time, first radio always receives
+			ph_clock_bits = 0;
+			ph_seconds++;
+		}
+
+		// read data bit and run it through decoder
+		uint8_t bit = (PH_DATA_IN & radio->pins->data) ? 1 : 0;
+		uint8_t events = ph_process_bit(&r->ctx, bit);
+
+		if (n == 0 && ph_raw_enabled) {						// stream raw bit of first radio
+			ph_raw_byte = (ph_raw_byte << 1) | bit;
+			if (++ph_raw_count == PH_RAW_BITS)
+				ph_raw_flush(0);
+		}
+
+#if !defined(TEST) || defined(RADIO_MOCK)
+		// FRR A is current RSSI with latch off, FRR B the radio state, FRR C the modem status
+		if (r->ctx.state == PH_STATE_WAIT_FOR_SYNC			// sample noise while nothing is received
+				&& r->ctx.rx_bit_count == PH_NOISE_SAMPLE_BIT && r->ctx.rx_sync_count < PH_NOISE_MAX_PREAMBLE) {
+			radio_frr_read(radio, 'A', 1);					// one SPI transfer, no command
+			ph_track_noise(r->ctx.radio_channel, radio->buffer.data[0]);
+		} else if (r->ctx.state >= PH_STATE_PREFETCH && !(events & PH_EVENT_SYNC)
+				&& ++r->rssi_bits == PH_RSSI_SAMPLE_BITS) {	// sample signal while receiving, one read every few bits
+			radio_frr_read(radio, 'A', 1);
+			r->rssi_sum += radio->buffer.data[0];
+			r->rssi_samples++;
+			if (radio->buffer.data[0] < r->rssi_min)
+				r->rssi_min = radio->buffer.data[0];
+			r->rssi_bits = 0;
+		}
 #endif
-			wake_up = 1;									// wake up main thread for packet processing and error reporting
+
+		if (events & PH_EVENT_SYNC) {						// on sync detect
+#if !defined(TEST) || defined(RADIO_MOCK)
+			radio_frr_read(radio, 'A', 3);					// RSSI, state and modem status in one burst, no command
+			r->rssi_sync = radio->buffer.data[0];			// first sample of packet
+			r->modem_status = radio->buffer.data[2];
+			r->rssi_min = r->rssi_sync;
+			r->rssi_sum = r->rssi_sync;
+			r->rssi_samples = 1;
+			r->rssi_bits = 0;
+#endif
+			r->activity.syncs++;
+			PH_MCLK_FULL();									// rest of packet at full speed
+			EVENT_POST(EVENT_SYNC);							// main thread might want to do something on sync detect
+			wake_up = 1;
 		}
+
+#if !defined(TEST) || defined(RADIO_MOCK)
+		if (events & PH_EVENT_PACKET) {						// store signal with packet
+			uint8_t slot = (r->ctx.fifo->packet_in - 1) & (FIFO_PACKETS - 1);
+			struct ph_rssi_s* rssi = &PH_INFO(n)[slot & (PH_PACKET_INFOS - 1)];
+			rssi->slot = slot;
+			rssi->sync = r->rssi_sync;
+			rssi->mean = r->rssi_sum / r->rssi_samples;
+			rssi->min = r->rssi_min;
+			rssi->samples = r->rssi_samples;
+			rssi->modem_status = r->modem_status;
+			if (ph_xo_calibrate && ph_xo_count < PH_XO_PACKETS) {	// AFC has no FRR, read it before the hop below
+				radio_get_modem_status(radio, 0xff);		// leave interrupts pending
+				ph_xo_sum += (int16_t) ((radio->buffer.modem_status.afc_freq_offset_msb << 8) | radio->buffer.modem_status.afc_freq_offset_lsb);
+				ph_xo_count++;
+			}
+		}
+#endif
+
+		if (events & PH_EVENT_RESET) {						// if next state is reset
+			uint8_t channel = r->ctx.radio_channel;
+			if (!(r->hop & (1 << channel)) || --r->dwell == 0) {	// dwell time is up, next channel of hop policy
+				do {
+					channel = (channel + 1) & (PH_CHANNELS - 1);
+				} while (!(r->hop & (1 << channel)));
+				r->dwell = ph_channels[channel].dwell;
+			}
+#if !defined(TEST) || defined(RADIO_MOCK)
+			if (r->xo_tune != ph_xo_tune) {					// new crystal calibration, PLL settles with hop
+				r->xo_tune = ph_xo_tune;
+				radio_set_property(radio, 0x00, 0x00, r->xo_tune);
+			}
+			if (ph_rssi_margin) {							// follow noise floor of channel to listen on
+				uint8_t threshold = ph_get_threshold(channel);
+				if (threshold >= r->threshold + PH_THRESHOLD_HYSTERESIS || threshold + PH_THRESHOLD_HYSTERESIS <= r->threshold) {
+					r->threshold = threshold;
+					radio_set_property(radio, 0x20, 0x4a, threshold);
+				}
+			}
+#endif
+			if (channel != r->ctx.radio_channel) {
+				r->ctx.radio_channel = channel;
+				if (n == 0 && ph_raw_enabled)
+					ph_raw_flush(PH_RAW_MARK_HOP | (channel << 3) | ph_raw_count);	// bits from now on are from other channel
+#if !defined(TEST) || defined(RADIO_MOCK)
+				ph_tune(radio, channel);
+				radio_start_rx(radio, 0, 0, 0, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE); // initiate channel hop
+#endif
+			}
+			EVENT_POST(EVENT_PACKET);						// wake up main thread for packet processing and error reporting
+			wake_up = 1;
+		} else if (PH_DATA_IFG & radio->pins->data_clk)
+			r->activity.late++;								// next bit is due, bits get lost if this keeps up
 	}
 
 	LED1_OFF;
 
 	if (wake_up)
 		__low_power_mode_off_on_exit();
+	DUTY_ISR_END();
+}
 
-	PH_DATA_IFG = 0;							// clear all pin interrupt flags
+// no radio is receiving a packet, call with interrupts disabled
+static uint8_t ph_hunting(void)
+{
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		if (ph_radios[n].ctx.state > PH_STATE_WAIT_FOR_SYNC)
+			return 0;
+	}
+	return 1;
+}
+
+void ph_mclk_hunt(void)
+{
+	if (ph_raw_enabled)
+		return;										// raw stream keeps full speed
+	_BIC_SR(GIE);									// a sync after checking would be decoded at low speed
+	if (ph_hunting())
+		BCSCTL2 = (BCSCTL2 & ~DIVM_3) | PH_MCLK_HUNT;
+	_BIS_SR(GIE);
 }
 
 // stop receiving and processing packets
 void ph_stop(void)
 {
-	PH_DATA_IE &= ~PH_DATA_CLK_PIN;				// disable interrupt on pin wired to GPIO2
-	ph_state = PH_STATE_OFF;					// turn off packet handler state machine
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		PH_DATA_IE &= ~radio_devices[n].pins->data_clk;	// disable interrupt on pin wired to GPIO2
+		ph_radios[n].ctx.state = PH_STATE_OFF;			// turn off packet handler state machine
+	}
 
 	// ISR is no longer invoked, it's now save to do radio operations
 
-	radio_change_state(RADIO_STATE_READY);		// transition radio from RX to READY
+	for (n = 0; n < RADIO_DEVICES; n++)
+		radio_change_state(&radio_devices[n], RADIO_STATE_READY);	// transition radio from RX to READY
+}
+
+void ph_set_tuning(uint8_t preamble_length, uint8_t sync_timeout, int8_t rssi_threshold, uint8_t rssi_margin)
+{
+	ph_preamble_length = preamble_length;
+	ph_sync_timeout = sync_timeout;
+	ph_rssi_threshold = rssi_threshold;
+	ph_rssi_margin = rssi_margin;
+	ph_cca = rssi_threshold || rssi_margin;
+}
+
+void ph_set_xo_tune(uint8_t xo_tune, uint8_t calibrate)
+{
+	ph_xo_tune = xo_tune;
+	ph_xo_calibrate = 0;							// ISR doesn't add while offsets are reset
+	ph_xo_sum = 0;
+	ph_xo_count = 0;
+	ph_xo_stepped = -1;
+	ph_xo_calibrate = calibrate;
+}
+
+uint8_t ph_get_xo_tune(void)
+{
+	return ph_xo_tune;
+}
+
+void ph_set_hop(uint8_t hop)
+{
+	ph_hop = hop ? hop & ((1 << PH_CHANNELS) - 1) : PH_HOP_AB;
+}
+
+void ph_set_channels(const struct ph_channel_s* channels)
+{
+	ph_channels = channels;
+}
+
+// PLL words of frequency, N = f / 2.5MHz in fixed point with 19 fraction bits, INTE = N - 1 keeps FRAC in 2^19..2^20-1
+uint8_t ph_channel_pll(struct ph_channel_s* channel, uint32_t khz)
+{
+	uint32_t n;
+	uint8_t inte;
+
+	if (khz < RADIO_BAND_MIN_KHZ || khz > RADIO_BAND_MAX_KHZ)
+		return 0;
+	n = ((khz / RADIO_PLL_KHZ) << 19) + ((khz % RADIO_PLL_KHZ) << 19) / RADIO_PLL_KHZ;	// remainder << 19 fits 32 bits
+	inte = (n >> 19) - 1;
+	n -= (uint32_t) inte << 19;
+	channel->pll[0] = ((inte - PH_PLL_INTE_MIN) << 3) | ((n >> 16) & 0x07);
+	channel->pll[1] = n >> 8;
+	channel->pll[2] = n;
+	return 1;
+}
+
+uint32_t ph_channel_khz(const struct ph_channel_s* channel)
+{
+	uint8_t pll[4];
+	uint32_t frac;
+
+	ph_channel_words(channel, pll);
+	frac = ((uint32_t) pll[1] << 16) | ((uint16_t) pll[2] << 8) | pll[3];
+	return (uint32_t) pll[0] * RADIO_PLL_KHZ + ((frac * RADIO_PLL_KHZ + (1UL << 18)) >> 19);	// rounded
+}
+
+void ph_channel_words(const struct ph_channel_s* channel, uint8_t* pll)
+{
+	pll[0] = (channel->pll[0] >> 3) + PH_PLL_INTE_MIN;
+	pll[1] = 0x08 | (channel->pll[0] & 0x07);		// FRAC bit 19 is always set
+	pll[2] = channel->pll[1];
+	pll[3] = channel->pll[2];
+}
+
+// AIVDM only knows AIS 1 and 2, long range and other channels leave the field empty
+char ph_channel_nmea(uint8_t channel)
+{
+	const uint8_t* pll = ph_channels[channel & (PH_CHANNELS - 1)].pll;
+	uint8_t n;
+
+	for (n = 0; n < 2; n++)
+		if (pll[0] == ph_default_channels[n].pll[0] && pll[1] == ph_default_channels[n].pll[1]
+				&& pll[2] == ph_default_channels[n].pll[2])
+			return 'A' + n;
+	return 0;
+}
+
+uint8_t ph_get_hop(void)
+{
+	return ph_hop;
+}
+
+// radio furthest into receiving a packet, the first radio if none is
+static struct ph_radio_s* ph_get_radio(void)
+{
+	struct ph_radio_s* r = &ph_radios[0];
+#if (RADIO_DEVICES > 1)
+	uint8_t n;
+
+	for (n = 1; n < RADIO_DEVICES; n++)
+		if (ph_radios[n].ctx.state > r->ctx.state)
+			r = &ph_radios[n];
+#endif
+	return r;
 }
 
 // get current state of packet handler state machine
 uint8_t ph_get_state(void)
 {
-	return ph_state;
+	return ph_get_radio()->ctx.state;
 }
 
-// get last error reported by packet handler
+// get last error reported by packet handler, errors of other radios are reported by next calls
 uint8_t ph_get_last_error(void)
 {
-	uint8_t error = ph_last_error;
-	ph_last_error = PH_ERROR_NONE;			// clear error
-	return error;
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		uint8_t error = ph_radios[n].ctx.last_error;
+		if (error != PH_ERROR_NONE) {
+			ph_radios[n].ctx.last_error = PH_ERROR_NONE;	// clear error
+			return error;
+		}
+	}
+	return PH_ERROR_NONE;
 }
 
 uint8_t ph_get_radio_channel(void)
 {
-	return ph_radio_channel;
+	return ph_get_radio()->ctx.radio_channel;
 }
 
 int16_t ph_get_radio_rssi(void)
 {
-	return ph_rssi;
+	uint8_t rssi = ph_get_radio()->rssi_sync;
+
+	return rssi ? RADIO_RSSI_TO_DBM(rssi) : 0;		// 0 until first sync
+}
+
+int16_t ph_get_noise_floor(uint8_t channel)
+{
+	uint16_t noise = ph_noise[channel & (PH_CHANNELS - 1)];
+
+	if (noise == 0)
+		return 0;
+	return RADIO_RSSI_TO_DBM(noise >> 4);
+}
+
+// signal of packet at FIFO read position
+uint8_t ph_get_packet_info(struct ph_packet_info_s* info)
+{
+	uint8_t slot = fifo_default.packet_out;
+	const struct ph_rssi_s* rssi = &ph_rssi[slot & (PH_PACKET_INFOS - 1)];
+	uint8_t channel = fifo_default.buffer[fifo_default.packets[slot]];	// channel is first byte of packet
+	int16_t noise, quality;
+
+	if (rssi->sync == 0 || rssi->slot != slot) {	// not sampled, e.g. in test mode, or overwritten by later packets
+		info->rssi = info->rssi_mean = info->rssi_min = 0;
+		info->samples = info->quality = info->modem_status = 0;
+		return 0;
+	}
+
+	info->rssi = RADIO_RSSI_TO_DBM(rssi->sync);
+	info->rssi_mean = RADIO_RSSI_TO_DBM(rssi->mean);
+	info->rssi_min = RADIO_RSSI_TO_DBM(rssi->min);
+	info->samples = rssi->samples;
+	info->modem_status = rssi->modem_status;
+
+	noise = ph_get_noise_floor(channel);
+	if (noise == 0)
+		noise = PH_QUALITY_NOISE_FLOOR;
+	quality = info->rssi_min - noise;				// margin of weakest sample, trusted more the more bits were sampled
+	info->quality = quality < 0 ? 0 : quality * rssi->samples / (rssi->samples + 1);
+	return 1;
 }
 
 uint8_t ph_get_message_type(void)
 {
-	return ph_message_type;
+	return ph_get_radio()->ctx.message_type;
+}
+
+// merge packets of all radios into fifo_default in order of completion per radio, returns number of packets
+uint8_t ph_poll(void)
+{
+	uint8_t count = 0;
+#if (RADIO_DEVICES > 1)
+	uint8_t n;
+
+	for (n = 0; n < RADIO_DEVICES; n++) {
+		struct fifo_s* fifo = &ph_fifo[n];
+		uint16_t size;
+
+		while ((size = fifo_ctx_get_packet(fifo)) != 0) {
+			uint8_t slot = fifo->packet_out;
+			struct ph_rssi_s* rssi = &ph_info[n][slot & (PH_PACKET_INFOS - 1)];
+			uint8_t packet = fifo_default.packet_in;
+
+			fifo_new_packet();
+			while (size--)
+				fifo_write_byte(fifo_ctx_read_byte(fifo));
+			if (rssi->sync != 0 && rssi->slot == slot) {	// signal of packet, unless overwritten by later packets
+				ph_rssi[packet & (PH_PACKET_INFOS - 1)] = *rssi;
+				ph_rssi[packet & (PH_PACKET_INFOS - 1)].slot = packet;
+			} else
+				ph_rssi[packet & (PH_PACKET_INFOS - 1)].sync = 0;
+			fifo_commit_packet();
+			fifo_ctx_remove_packet(fifo);
+			count++;
+		}
+	}
+#endif
+	return count;
+}
+
+uint8_t ph_get_activity(uint8_t radio, struct ph_activity_s* activity)
+{
+	*activity = ph_radios[radio].activity;			// words are read atomically, counters are independent
+	return ph_radios[radio].ctx.state != PH_STATE_OFF;
+}
+
+uint32_t ph_get_seconds(void)
+{
+	uint32_t seconds;
+
+	do {
+		seconds = ph_seconds;						// ISR might update while reading 2 words
+	} while (seconds != ph_seconds);
+	return seconds;
+}
+
+uint32_t ph_get_bits(void)
+{
+	uint32_t seconds;
+	uint16_t bits;
+
+	do {
+		seconds = ph_seconds;
+		bits = ph_clock_bits;
+	} while (seconds != ph_seconds);				// ISR started next second in between
+	return seconds * PH_BIT_RATE + bits;
 }
 
 #ifdef TEST
 
+// self-test drives the data pins of the first radio, see RADIO_PINS_0
+#define	PH_DATA_CLK_PIN		RADIO_GPIO_2	// RX data clock
+#define PH_DATA_PIN			RADIO_GPIO_3	// RX data
+
 // configure packet handler for self-test
 void test_ph_setup(void)
 {
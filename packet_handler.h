@@ -9,10 +9,11 @@
 #ifndef PACKET_HANDLER_H_
 #define PACKET_HANDLER_H_
 
-// functions to manage packet handler operation
+// functions to manage packet handler operation, one packet handler instance per radio of radio_devices
 void ph_setup(void);				// setup packet handler, e.g. configuring input pins
 void ph_start(void);				// start receiving packages
 void ph_stop(void);					// stop receiving packages
+uint8_t ph_poll(void);				// with more than one radio move received packets into fifo_default, call before reading it
 
 // packet handler states
 enum PH_STATE {
@@ -29,14 +30,135 @@ enum PH_ERROR {
 	PH_ERROR_STUFFBIT,		// invalid stuff-bit
 	PH_ERROR_NOEND,			// no end flag after more than 1020 bits, message too long
 	PH_ERROR_CRC,			// CRC error
-	PH_ERROR_RSSI_DROP		// signal strength fell below threshold
+	PH_ERROR_RSSI_DROP,		// signal strength fell below threshold
+	PH_ERRORS				// number of error codes
 };
 
+// decoder state of one raw bit stream, processed by ph_process_bit()
+struct fifo_s;
+struct radio_s;
+struct ph_context_s {
+	struct fifo_s* fifo;					// FIFO receiving packets: channel, payload and CRC
+	struct radio_s* radio;					// radio whose CCA pin aborts packets, 0 = no radio
+	volatile uint8_t state;					// PH_STATE_x
+	volatile uint8_t last_error;			// PH_ERROR_x
+	volatile uint8_t radio_channel;			// channel stored with packet, index into channel table, 0=A, 1=B, ..
+	volatile uint8_t message_type;			// AIS message type of last packet
+	uint16_t rx_bitstream;					// shift register with incoming data
+	uint16_t rx_bit_count;					// bit counter for various purposes
+	uint16_t rx_crc;						// word for AIS payload CRC calculation
+	uint8_t rx_one_count;					// counter of 1's to identify stuff bits
+	uint8_t rx_data_byte;					// byte to receive actual package data
+	uint8_t rx_prev_bit_NRZI;				// previous bit for NRZI decoding
+	uint8_t rx_sync_state;					// state of preamble and start flag detection
+	uint8_t rx_sync_count;					// length of valid bits in current sync sequence
+};
+
+// events returned by ph_process_bit
+#define PH_EVENT_SYNC		0x01			// preamble and start flag detected, e.g. read RSSI now
+#define PH_EVENT_RESET		0x02			// state machine resets with next bit, e.g. hop channel now
+#define PH_EVENT_PACKET		0x04			// valid packet committed to FIFO, comes with PH_EVENT_RESET
+
+void ph_context_init(struct ph_context_s* ctx, struct fifo_s* fifo, uint8_t channel);	// reset decoder state, FIFO is not reset
+uint8_t ph_process_bit(struct ph_context_s* ctx, uint8_t bit_NRZI);	// decode one raw (NRZI) bit, returns PH_EVENT_x flags
+
+// raw bit stream: DATA pin levels sampled by ph_irq_handler, packed into bytes and queued to UART
+#define PH_RAW_BITS				7		// raw bits per data byte, oldest bit in bit 6, bit 7 is 0
+#define PH_RAW_MARK_HOP			0x80	// mark, | channel << 3 | bits in preceding data byte (0=byte was complete)
+#define PH_RAW_MARK_OVERFLOW	0xc0	// mark, UART couldn't keep up and bytes were lost before this mark
+
+void ph_set_raw_stream(uint8_t enable);	// start/stop streaming, starts with a hop mark of current channel
+uint8_t ph_get_raw_stream(void);
+
+// paramters for package detection, defaults of ph_set_tuning
+#define PH_PREAMBLE_LENGTH	8		// minimum number of alternating bits we need for a valid preamble
+#define PH_SYNC_TIMEOUT	16			// number of bits we wait for a preamble to start before changing channel
+#define PH_RSSI_THRESHOLD	0		// threshold in dBm for valid signal, e.g. -95, 0 to ignore signal strength
+#define PH_RSSI_MARGIN		0		// adaptive threshold in dB above noise floor of channel, e.g. 8, 0 for fixed threshold only
+
+// RSSI thresholds are configured in the radio by ph_start, the other parameters apply immediately
+// the noise floor of each channel is tracked while waiting for a sync, with a margin the threshold follows it,
+// a fixed threshold then is the lowest threshold used
+void ph_set_tuning(uint8_t preamble_length, uint8_t sync_timeout, int8_t rssi_threshold, uint8_t rssi_margin);
+
+// crystal calibration, XO_TUNE steps towards zero mean AFC offset of received packets, e.g. as temperature changes
+// the value is configured in the radio by ph_start, with calibration the ISR reads the AFC offset at the end of each
+// packet until PH_XO_PACKETS are collected, ph_xo_step averages them and changes it as needed, the ISR configures it
+// on the next hop, all radios use the same value
+// calibration needs a radio configuration with AFC enabled, radio_config.h is generated with AFC_en 0 and its radio
+// reports an offset of 0, i.e. XO_TUNE never steps
+#define PH_XO_PACKETS		16		// packets averaged per calibration step
+#define PH_XO_HYSTERESIS	300		// mean AFC offset in Hz that starts a step, about 2 steps of XO_TUNE
+#define PH_XO_RANGE			32		// XO_TUNE stays within this many steps of RADIO_XO_TUNE_DEFAULT
+
+void ph_set_xo_tune(uint8_t xo_tune, uint8_t calibrate);	// set GLOBAL_XO_TUNE, calibrate automatically if set
+uint8_t ph_get_xo_tune(void);		// current value, changes with calibration
+uint8_t ph_xo_step(void);			// step XO_TUNE once PH_XO_PACKETS offsets were collected, returns 1 if it changed
+
+// channel table, entry n is channel 'A' + n in packets and NMEA sentences, frequencies are set as PLL words
+// so the radio tunes to any frequency in its band without regenerating radio_config.h
+// PLL words are packed into 3 bytes: INTE spans 55..69 within the band and bit 19 of FRAC is always set
+#define PH_CHANNELS		4			// power of 2
+#define PH_PLL_INTE_MIN	(RADIO_BAND_MIN_KHZ / RADIO_PLL_KHZ - 1)	// FREQ_CONTROL_INTE at lower band edge
+struct ph_channel_s {
+	uint8_t pll[3];					// (INTE - PH_PLL_INTE_MIN) << 3 | FRAC bits 18..16, FRAC_1, FRAC_0, see ph_channel_pll
+	uint8_t dwell;					// reset periods (sync timeout or packet) to stay on channel when hopping, 1..255
+};
+
+extern const struct ph_channel_s ph_default_channels[PH_CHANNELS];	// AIS 1 and 2 (161.975, 162.025MHz), long range AIS 75 and 76 (156.775, 156.825MHz)
+void ph_set_channels(const struct ph_channel_s* channels);	// table of PH_CHANNELS entries, kept by reference, takes effect on next start
+uint8_t ph_channel_pll(struct ph_channel_s* channel, uint32_t khz);	// compute PLL words of frequency in kHz, returns 0 if outside radio's band
+uint32_t ph_channel_khz(const struct ph_channel_s* channel);		// frequency of PLL words in kHz
+void ph_channel_words(const struct ph_channel_s* channel, uint8_t* pll);	// unpack FREQ_CONTROL_INTE, _FRAC_2, _FRAC_1, _FRAC_0 for radio_set_frequency
+char ph_channel_nmea(uint8_t channel);	// NMEA channel of table entry, 'A' on 161.975MHz, 'B' on 162.025MHz, 0 on other frequencies
+
+// channel hop policy, applied when the state machine resets
+// with more than one radio ph_start deals the channels to radios in turn, e.g. AB receives A and B at the same time
+#define PH_HOP_AB		0x03		// hop between channel A and B (default)
+
+void ph_set_hop(uint8_t hop);		// set channels to hop between, bit n for channel 'A' + n, a single bit stays on that channel, takes effect on next start
+uint8_t ph_get_hop(void);
+
+// with more than one radio these report the radio furthest into receiving a packet
 uint8_t ph_get_state(void);			// get current state of packet handler
 uint8_t ph_get_last_error(void);	// get last packet handler error, will clear error
 uint8_t ph_get_radio_channel(void);	// get current radio channel
 int16_t ph_get_radio_rssi(void);	// get RSSI in dBm at last sync
 uint8_t ph_get_message_type(void);	// get last AIS message type
+int16_t ph_get_noise_floor(uint8_t channel);	// noise floor of channel in dBm, 0 if not tracked yet
+
+// signal of a received packet, RSSI sampled at sync and every PH_RSSI_SAMPLE_BITS bits after the start flag
+// through FRR A, modem status through FRR C at sync
+// quality is the weakest sample above the noise floor, scaled by samples / (samples + 1) as a packet with fewer
+// bits after the start flag had fewer chances to show a fade, e.g. 6/7 of the margin for a position report
+#define PH_RSSI_SAMPLE_BITS	32
+struct ph_packet_info_s {
+	int16_t rssi;						// RSSI in dBm at sync
+	int16_t rssi_mean;					// mean of all samples in dBm
+	int16_t rssi_min;					// weakest sample in dBm, shows fading during the packet
+	uint8_t samples;					// number of samples, 1 + bits after start flag / PH_RSSI_SAMPLE_BITS
+	uint8_t quality;					// weakest sample above noise floor in dB, see above, 0 if not sampled
+	uint8_t modem_status;				// modem status at sync, e.g. RADIO_RSSI_JUMP
+};
+
+uint8_t ph_get_packet_info(struct ph_packet_info_s* info);	// info of packet at FIFO read position, returns 0 if not available
+uint32_t ph_get_seconds(void);		// seconds of reception since start, counted in received bits
+uint32_t ph_get_bits(void);			// bits received by first radio since start
+
+// activity of a radio for supervision, counters wrap
+struct ph_activity_s {
+	uint16_t clocks;					// DATA_CLK cycles processed
+	uint16_t syncs;						// syncs detected
+	uint16_t late;						// bits whose processing took until next DATA_CLK edge, outside of hops
+};
+
+uint8_t ph_get_activity(uint8_t radio, struct ph_activity_s* activity);	// counters of radio of radio_devices, returns 0 if it isn't receiving
+
+// MCLK is divided while all radios hunt for sync, SMCLK stays at DCO 16MHz so UART, SPI, flash and timers don't change,
+// the effect on supply current has not been measured
+#define PH_MCLK_HUNT	DIVM_2			// MCLK 4MHz, 416 cycles per bit
+#define PH_MCLK_FULL()	(BCSCTL2 &= ~DIVM_3)	// MCLK 16MHz
+void ph_mclk_hunt(void);				// divide MCLK if no radio receives a packet, ISR returns to full MCLK on sync
 
 // functions to test packet handler operation, DISCONNECT MODEM BEFORE TESTING!
 #ifdef TEST
@@ -10,12 +10,11 @@
 #include <inttypes.h>
 
 #include "radio.h"
-#include "radio_config.h"
+#include "radio_config_compact.h"
 #include "spi.h"
 
-#define	SPI_NSEL	BIT4						// chip select on pin 1.4
-#define SPI_ON		P1OUT &= ~SPI_NSEL;			// turn SPI on (NSEL=0)
-#define SPI_OFF		P1OUT |= SPI_NSEL;			// turn SPI off (NSEL=1)
+#define SPI_ON		*radio->pins->nsel_out &= ~radio->pins->nsel;	// turn SPI on (NSEL=0)
+#define SPI_OFF		*radio->pins->nsel_out |= radio->pins->nsel;	// turn SPI off (NSEL=1)
 
 #define CMD_NOP						0x00
 #define CMD_PART_INFO				0x01
@@ -41,149 +40,255 @@
 #define CMD_FRR_A_READ				0x50
 #define CMD_READ_RX_FIFO			0x77
 
-// radio configuration as generated by WDS and stored in radio_config.h
-const uint8_t radio_configuration[] = RADIO_CONFIGURATION_DATA_ARRAY;
+// radio configuration as generated by WDS in radio_config.h, redundant property writes removed by host/radio_config_gen
+const uint8_t radio_configuration[] = RADIO_CONFIGURATION_COMPACT_ARRAY;
 
 // radio image rejection calibration sequence (as per datasheet)
 const uint8_t radio_ircal_sequence_coarse[] = { 0x56, 0x10, 0xCA, 0xF0 };
 const uint8_t radio_ircal_sequence_fine[] = { 0x13, 0x10, 0xCA, 0xF0 };
 
-union radio_buffer_u radio_buffer;
-
-static void send_command(uint8_t cmd, const uint8_t *send_buffer, uint8_t send_length, uint8_t response_length);
-static int receive_result(uint8_t length);
+// radios and their wiring
+static const struct radio_pins_s radio_pins[RADIO_DEVICES] = {
+	RADIO_PINS_0,
+#if (RADIO_DEVICES > 1)
+	RADIO_PINS_1
+#endif
+};
+
+struct radio_s radio_devices[RADIO_DEVICES] = {
+	{ &radio_pins[0] },
+#if (RADIO_DEVICES > 1)
+	{ &radio_pins[1] }
+#endif
+};
+
+static void send_command(struct radio_s* radio, uint8_t cmd, const uint8_t *send_buffer, uint8_t send_length, uint8_t response_length);
+static int receive_result(struct radio_s* radio, uint8_t length);
+
+// wait until radio is ready for next command (CTS), returns 0 and counts a timeout if it isn't within RADIO_CTS_TIMEOUT
+static uint8_t wait_for_cts(struct radio_s* radio)
+{
+	uint16_t ms = RADIO_CTS_TIMEOUT;
+	uint16_t us = 1000;
+
+	while (!RADIO_READY(radio)) {
+		_delay_cycles(12);							// about 1us per check at 16MHz, 4us in hops while MCLK is divided
+		if (--us == 0) {
+			if (--ms == 0) {
+				radio->cts_timeouts++;
+				return 0;
+			}
+			us = 1000;
+		}
+	}
+	return 1;
+}
 
 // configure I/O pins used for radio
-void radio_setup(void)
+void radio_setup(struct radio_s* radio)
 {
+	const struct radio_pins_s* pins = radio->pins;
+
 	// initialize SPI pins
-	P1SEL &= ~SPI_NSEL;								// NSEL pin as I/O
-	P1DIR |= SPI_NSEL;								// set NSEL pin to output
+	*pins->nsel_sel &= ~pins->nsel;					// NSEL pin as I/O
+	*pins->nsel_dir |= pins->nsel;					// set NSEL pin to output
 	SPI_OFF;										// turn off chip select
 
 	spi_init();
 
 	// initialize CTS pin as input
-	RADIO_PSEL &= ~(RADIO_CTS);						// CTS pin is I/O
-	RADIO_PDIR &= ~(RADIO_CTS);						// CTS pin is input
+	*pins->sel &= ~pins->cts;						// CTS pin is I/O
+	*pins->dir &= ~pins->cts;						// CTS pin is input
 
 	// initialize shutdown pin as output
-	RADIO_PSEL &= ~RADIO_SDN;						// shutdown pin is I/O
-	RADIO_PDIR |= RADIO_SDN;						// shutdown pin is output
+	*pins->sel &= ~pins->sdn;						// shutdown pin is I/O
+	*pins->out &= ~pins->sdn;						// SDN low, a radio running since before a reset keeps running
+	*pins->dir |= pins->sdn;						// shutdown pin is output
 
 	return;
 }
 
 // shut down radio, call radio_configure to restart
-void radio_shutdown(void)
+void radio_shutdown(struct radio_s* radio)
 {
+	const struct radio_pins_s* pins = radio->pins;
+
 	// initialize shutdown pin
-	RADIO_PSEL &= ~RADIO_SDN;							// shutdown pin is I/O
-	RADIO_PDIR |= RADIO_SDN;								// shutdown pin is output
+	*pins->sel &= ~pins->sdn;						// shutdown pin is I/O
+	*pins->dir |= pins->sdn;						// shutdown pin is output
 
 	// SDN high = turn off radio
-	RADIO_POUT |= RADIO_SDN;
+	*pins->out |= pins->sdn;
 }
 
-// reset radio and load configuration data
-void radio_configure(void)
+// reset radio and load configuration data, returns 0 if radio stopped responding
+uint8_t radio_configure(struct radio_s* radio)
 {
 	// reset radio: SDN=1, wait >1us, SDN=0
-	RADIO_POUT |= RADIO_SDN;
+	*radio->pins->out |= radio->pins->sdn;
 	_delay_cycles(1000);
-	RADIO_POUT &= ~RADIO_SDN;
+	*radio->pins->out &= ~radio->pins->sdn;
 
-	while (!RADIO_READY);						// wait for chip to wake up
+	if (!wait_for_cts(radio))					// wait for chip to wake up
+		return 0;
 
 	// transfer radio configuration
 	const uint8_t *cfg = radio_configuration;
 	while (*cfg)	{							// configuration array stops with 0
 		char count = (*cfg++) - 1;				// 1st byte: number of bytes, incl. command
 		char cmd = *cfg++;						// 2nd byte: command
-		send_command(cmd, cfg, count, 0);		// send bytes to chip
+		send_command(radio, cmd, cfg, count, 0);	// send bytes to chip
 		cfg += count;							// point at next line
-		while (!RADIO_READY);					// wait for chip to complete operation
+		if (!wait_for_cts(radio))				// wait for chip to complete operation
+			return 0;
 	}
 
-	return;
+	return 1;
+}
+
+// check if radio still runs with its configuration, e.g. after an MCU reset that didn't cut power
+// it must be a powered up Si4362 and the properties written after IRCAL must hold their values,
+// except those changed while receiving, the frequency (FREQ_CONTROL), the RSSI threshold and RSSI latch
+uint8_t radio_configured(struct radio_s* radio)
+{
+	const uint8_t *cfg = radio_configuration;
+	const uint8_t *properties = cfg;
+	uint8_t i;
+
+	if (!RADIO_READY(radio))					// shut down, or busy with a command interrupted by the reset
+		return 0;
+
+	radio_part_info(radio);
+	if (radio->buffer.part_info.part_msb != 0x43 || radio->buffer.part_info.part_lsb != 0x62)
+		return 0;
+	radio_func_info(radio);
+	if (radio->buffer.func_info.func != 1)		// in boot mode, not powered up
+		return 0;
+
+	while (*cfg) {								// find properties after last command other than SET_PROPERTY
+		if (cfg[1] != CMD_SET_PROPERTY)
+			properties = cfg + *cfg + 1;
+		cfg += *cfg + 1;
+	}
+	for (cfg = properties; *cfg; cfg += *cfg + 1) {
+		uint8_t group = cfg[2];
+		uint8_t count = cfg[3];
+		uint8_t start = cfg[4];
+		if (group == 0x40)						// FREQ_CONTROL, set on every hop
+			continue;
+		radio_get_property(radio, group, count, start);
+		for (i = 0; i < count; i++) {
+			uint8_t property = start + i;
+			if (group == 0x20 && (property == 0x4a || property == 0x4c))	// MODEM_RSSI_THRESH, MODEM_RSSI_CONTROL
+				continue;
+			if (radio->buffer.data[i] != cfg[5 + i])
+				return 0;
+		}
+	}
+
+	radio_get_chip_status(radio, 0);			// clear errors of commands interrupted by the reset
+	return 1;
+}
+
+// read up to 12 consecutive properties of a group, result in radio->buffer.data
+void radio_get_property(struct radio_s* radio, uint8_t prop_group, uint8_t count, uint8_t prop_num)
+{
+	radio->buffer.data[0] = prop_group;
+	radio->buffer.data[1] = count;
+	radio->buffer.data[2] = prop_num;
+	send_command(radio, CMD_GET_PROPERTY, radio->buffer.data, 3, count);
 }
 
 // directly set individual radio property
-void radio_set_property(uint8_t prop_group,	uint8_t prop_num, uint8_t value)
+void radio_set_property(struct radio_s* radio, uint8_t prop_group,	uint8_t prop_num, uint8_t value)
 {
-	radio_buffer.data[0] = prop_group;
-	radio_buffer.data[1] = 1;
-	radio_buffer.data[2] = prop_num;
-	radio_buffer.data[3] = value;
-	send_command(CMD_SET_PROPERTY, radio_buffer.data, 4, 0);
+	radio->buffer.data[0] = prop_group;
+	radio->buffer.data[1] = 1;
+	radio->buffer.data[2] = prop_num;
+	radio->buffer.data[3] = value;
+	send_command(radio, CMD_SET_PROPERTY, radio->buffer.data, 4, 0);
 	return;
 }
 
+// set PLL frequency, FREQ_CONTROL_INTE to _FRAC_0 in one command
+void radio_set_frequency(struct radio_s* radio, const uint8_t* pll)
+{
+	radio->buffer.data[0] = 0x40;
+	radio->buffer.data[1] = 4;
+	radio->buffer.data[2] = 0x00;
+	radio->buffer.data[3] = pll[0];
+	radio->buffer.data[4] = pll[1];
+	radio->buffer.data[5] = pll[2];
+	radio->buffer.data[6] = pll[3];
+	send_command(radio, CMD_SET_PROPERTY, radio->buffer.data, 7, 0);
+}
+
 // invoke radio image rejection self-calibration
-void radio_calibrate_ir(void)
+void radio_calibrate_ir(struct radio_s* radio)
 {
 	// send calibration sequence as per datasheet - doing it wrong, read AN790
 	// note: looking at si446x_ircal.c in provided examples, CMD_IRCAL has 3 undocumented return values CAL_STATE, RSSI, DIR_CH
 	// note2: don't use this method, rely on WDS to generate proper calibration sequence
-	radio_start_rx(0,0,0,0,0,0);
-	send_command(CMD_IRCAL, radio_ircal_sequence_coarse, sizeof(radio_ircal_sequence_coarse), 0);
-	send_command(CMD_IRCAL, radio_ircal_sequence_fine, sizeof(radio_ircal_sequence_fine), 0);
-	while (!RADIO_READY);						// wait for calibration to complete
+	radio_start_rx(radio, 0,0,0,0,0,0);
+	send_command(radio, CMD_IRCAL, radio_ircal_sequence_coarse, sizeof(radio_ircal_sequence_coarse), 0);
+	send_command(radio, CMD_IRCAL, radio_ircal_sequence_fine, sizeof(radio_ircal_sequence_fine), 0);
+	wait_for_cts(radio);						// wait for calibration to complete
 }
 
 // retrieve radio device information (e.g. chip model)
-void radio_part_info(void)
+void radio_part_info(struct radio_s* radio)
 {
-	send_command(CMD_PART_INFO, 0, 0, sizeof(radio_buffer.part_info));
+	send_command(radio, CMD_PART_INFO, 0, 0, sizeof(radio->buffer.part_info));
 }
 
 // retrieve radio function revision information
-void radio_func_info(void)
+void radio_func_info(struct radio_s* radio)
 {
-	send_command(CMD_FUNC_INFO, 0, 0, sizeof(radio_buffer.func_info));
+	send_command(radio, CMD_FUNC_INFO, 0, 0, sizeof(radio->buffer.func_info));
 }
 
 // retrieve radio FIFO information
-void radio_fifo_info(uint8_t reset_fifo)
+void radio_fifo_info(struct radio_s* radio, uint8_t reset_fifo)
 {
-	radio_buffer.data[0] = reset_fifo;
-	send_command(CMD_FIFO_INFO, radio_buffer.data, 1, sizeof(radio_buffer.fifo_info));
+	radio->buffer.data[0] = reset_fifo;
+	send_command(radio, CMD_FIFO_INFO, radio->buffer.data, 1, sizeof(radio->buffer.fifo_info));
 }
 
 // retrieve radio interrupt status information
-void radio_get_int_status(uint8_t ph_clr_pending, uint8_t modem_clr_pending, uint8_t chip_clr_pending)
+void radio_get_int_status(struct radio_s* radio, uint8_t ph_clr_pending, uint8_t modem_clr_pending, uint8_t chip_clr_pending)
 {
-	radio_buffer.data[0] = ph_clr_pending;
-	radio_buffer.data[1] = modem_clr_pending;
-	radio_buffer.data[2] = chip_clr_pending;
-	send_command(CMD_GET_INT_STATUS, radio_buffer.data, 3, sizeof(radio_buffer.int_status));
+	radio->buffer.data[0] = ph_clr_pending;
+	radio->buffer.data[1] = modem_clr_pending;
+	radio->buffer.data[2] = chip_clr_pending;
+	send_command(radio, CMD_GET_INT_STATUS, radio->buffer.data, 3, sizeof(radio->buffer.int_status));
 }
 
 // retrieve radio packet handler status information
-void radio_get_ph_status(uint8_t clr_pending)
+void radio_get_ph_status(struct radio_s* radio, uint8_t clr_pending)
 {
-	radio_buffer.data[0] = clr_pending;
-	send_command(CMD_GET_PH_STATUS, radio_buffer.data, 1, sizeof(radio_buffer.ph_status));
+	radio->buffer.data[0] = clr_pending;
+	send_command(radio, CMD_GET_PH_STATUS, radio->buffer.data, 1, sizeof(radio->buffer.ph_status));
 }
 
 // retrieve radio chip status information
-void radio_get_chip_status(uint8_t clr_pending)
+void radio_get_chip_status(struct radio_s* radio, uint8_t clr_pending)
 {
-	radio_buffer.data[0] = clr_pending;
-	send_command(CMD_GET_CHIP_STATUS, radio_buffer.data, 1, sizeof(radio_buffer.chip_status));
+	radio->buffer.data[0] = clr_pending;
+	send_command(radio, CMD_GET_CHIP_STATUS, radio->buffer.data, 1, sizeof(radio->buffer.chip_status));
 }
 
 // retrieve radio modem status information
-void radio_get_modem_status(uint8_t clr_pending)
+void radio_get_modem_status(struct radio_s* radio, uint8_t clr_pending)
 {
-	radio_buffer.data[0] = clr_pending;
-	send_command(CMD_GET_MODEM_STATUS, radio_buffer.data, 1, sizeof(radio_buffer.modem_status));
+	radio->buffer.data[0] = clr_pending;
+	send_command(radio, CMD_GET_MODEM_STATUS, radio->buffer.data, 1, sizeof(radio->buffer.modem_status));
 }
 
-// read fast read registers, results in radio_buffer.data[0..3], frr = start register 'A'..'D', count = # of values
-void radio_frr_read(uint8_t frr, uint8_t count)
+// read fast read registers, results in radio->buffer.data[0..3], frr = start register 'A'..'D', count = # of values
+void radio_frr_read(struct radio_s* radio, uint8_t frr, uint8_t count)
 {
-	while (!RADIO_READY);					// always wait for radio to be ready (CTS) before sending next command
+	if (!wait_for_cts(radio))				// always wait for radio to be ready (CTS) before sending next command
+		return;
 
 	// implemented directly as FRR access has no CTS handshake
 	SPI_ON;
@@ -192,7 +297,7 @@ void radio_frr_read(uint8_t frr, uint8_t count)
 
 	uint8_t i = 0;
 	while (i < count) {
-		radio_buffer.data[i] = spi_transfer(0);		// receive bytes
+		radio->buffer.data[i] = spi_transfer(0);	// receive bytes
 		i++;
 	}
 
@@ -200,52 +305,53 @@ void radio_frr_read(uint8_t frr, uint8_t count)
 }
 
 // put radio in receive state
-void radio_start_rx(uint8_t channel, uint8_t start_condition, uint16_t rx_length, uint8_t rx_timeout_state,	uint8_t rx_valid_state,	uint8_t rx_invalid_state)
+void radio_start_rx(struct radio_s* radio, uint8_t channel, uint8_t start_condition, uint16_t rx_length, uint8_t rx_timeout_state,	uint8_t rx_valid_state,	uint8_t rx_invalid_state)
 {
-	radio_buffer.data[0] = channel;
-	radio_buffer.data[1] = start_condition;
-	radio_buffer.data[2] = rx_length >> 8;
-	radio_buffer.data[3] = rx_length & 0xff;
-	radio_buffer.data[4] = rx_timeout_state;
-	radio_buffer.data[5] = rx_valid_state;
-	radio_buffer.data[6] = rx_invalid_state;
-	send_command(CMD_START_RX, radio_buffer.data, 7, 0);
+	radio->buffer.data[0] = channel;
+	radio->buffer.data[1] = start_condition;
+	radio->buffer.data[2] = rx_length >> 8;
+	radio->buffer.data[3] = rx_length & 0xff;
+	radio->buffer.data[4] = rx_timeout_state;
+	radio->buffer.data[5] = rx_valid_state;
+	radio->buffer.data[6] = rx_invalid_state;
+	send_command(radio, CMD_START_RX, radio->buffer.data, 7, 0);
 }
 
 // wait for radio to complete previous command
-void radio_wait_for_CTS(void)
+void radio_wait_for_CTS(struct radio_s* radio)
 {
-	while (!RADIO_READY);				// wait for radio to be ready before returning
+	wait_for_cts(radio);				// wait for radio to be ready before returning
 }
 
 // read radio state
-void radio_request_device_state(void)
+void radio_request_device_state(struct radio_s* radio)
 {
-	send_command(CMD_REQUEST_DEVICE_STATE, 0, 0, sizeof(radio_buffer.device_state));
+	send_command(radio, CMD_REQUEST_DEVICE_STATE, 0, 0, sizeof(radio->buffer.device_state));
 }
 
 // change radio state, e.g. from receive to ready
-void radio_change_state(uint8_t next_state)
+void radio_change_state(struct radio_s* radio, uint8_t next_state)
 {
-	radio_buffer.data[0] = next_state;
-	send_command(CMD_CHANGE_STATE, radio_buffer.data, 1, 0);
+	radio->buffer.data[0] = next_state;
+	send_command(radio, CMD_CHANGE_STATE, radio->buffer.data, 1, 0);
 }
 
 // read various radio status and information registers
-void radio_debug(void)
+void radio_debug(struct radio_s* radio)
 {
-	radio_get_int_status(0, 0, 0);
-	radio_get_chip_status(0);
-	radio_get_modem_status(0);
-	radio_part_info();
-	radio_func_info();
-	radio_request_device_state();
+	radio_get_int_status(radio, 0, 0, 0);
+	radio_get_chip_status(radio, 0);
+	radio_get_modem_status(radio, 0);
+	radio_part_info(radio);
+	radio_func_info(radio);
+	radio_request_device_state(radio);
 }
 
 // send command, including optional parameters if sendBuffer != 0
-void send_command(uint8_t cmd, const uint8_t *send_buffer, uint8_t send_length, uint8_t response_length)
+void send_command(struct radio_s* radio, uint8_t cmd, const uint8_t *send_buffer, uint8_t send_length, uint8_t response_length)
 {
-	while (!RADIO_READY);					// always wait for radio to be ready (CTS) before sending next command
+	if (!wait_for_cts(radio))				// always wait for radio to be ready (CTS) before sending next command
+		return;
 
 	SPI_ON;
 
@@ -262,14 +368,21 @@ void send_command(uint8_t cmd, const uint8_t *send_buffer, uint8_t send_length,
 	SPI_OFF;
 
 	if (response_length) {
-		while (!RADIO_READY);				// wait for radio to be ready before retrieving response
-		while (receive_result(response_length) == 0);	// wait for valid response
+		uint8_t attempts = RADIO_RESPONSE_ATTEMPTS;
+		if (!wait_for_cts(radio))			// wait for radio to be ready before retrieving response
+			return;
+		while (receive_result(radio, response_length) == 0) {	// wait for valid response
+			if (--attempts == 0) {
+				radio->cts_timeouts++;
+				return;
+			}
+		}
 	}
 	return;
 }
 
 // read result: write 44h, read CTS byte, if 0xff read result bytes, else loop (cycle NSEL)
-int receive_result(uint8_t length)
+int receive_result(struct radio_s* radio, uint8_t length)
 {
 	SPI_ON;
 
@@ -281,7 +394,7 @@ int receive_result(uint8_t length)
 
 	uint8_t i = 0;							// data ready, read result into buffer
 	while (i < length) {
-		radio_buffer.data[i] = spi_transfer(0);		// receive byte
+		radio->buffer.data[i] = spi_transfer(0);	// receive byte
 		i++;
 	}
 
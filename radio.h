@@ -29,39 +29,95 @@
 #endif
 
 #define RADIO_CTS			RADIO_GPIO_1	// when low, chip is busy/not ready
+#define RADIO_CCA			RADIO_NIRQ		// when high, signal strength exceeds RSSI threshold
+
+// radios on the SPI bus, each with its own chip select and GPIOs, see radio_devices
+#ifndef RADIO_DEVICES
+#define RADIO_DEVICES		1
+#endif
+
+struct radio_s;
+
+// wiring of one radio, DATA_CLK and DATA of all radios are on the port of the packet handler, see RADIO_PINS_x
+struct radio_pins_s {
+	volatile uint8_t* nsel_out;			// port of chip select
+	volatile uint8_t* nsel_sel;
+	volatile uint8_t* nsel_dir;
+	volatile uint8_t* in;				// port of CTS, SDN and CCA
+	volatile uint8_t* out;
+	volatile uint8_t* sel;
+	volatile uint8_t* dir;
+	uint8_t nsel;						// chip select, low while SPI transfers to this radio
+	uint8_t cts;						// GPIO_1, low while busy
+	uint8_t sdn;						// shutdown
+	uint8_t cca;						// NIRQ, high when RSSI exceeds threshold
+	uint8_t data_clk;					// GPIO_2, RX data clock
+	uint8_t data;						// GPIO_3, RX data
+};
+
+// radio 0 as defined above, chip select on P1.4
+#define RADIO_PINS_0	{ &P1OUT, &P1SEL, &P1DIR, &RADIO_PIN, &RADIO_POUT, &RADIO_PSEL, &RADIO_PDIR, \
+							BIT4, RADIO_CTS, RADIO_SDN, RADIO_CCA, RADIO_GPIO_2, RADIO_GPIO_3 }
+
+// radio 1 needs a 28 pin device: chip select on P1.3, GPIO_1, SDN and NIRQ on P3.1, P3.4 and P3.5,
+// GPIO_2 and GPIO_3 on P2.6 and P2.7 instead of a crystal, shares SPI with radio 0
+#define RADIO_PINS_1	{ &P1OUT, &P1SEL, &P1DIR, &P3IN, &P3OUT, &P3SEL, &P3DIR, \
+							BIT3, BIT1, BIT4, BIT5, BIT6, BIT7 }
+
+#if (RADIO_DEVICES > 2)
+#error "Radio library only supports 2 radios."
+#endif
+
+#define RADIO_CTS_TIMEOUT		500			// ms to wait for CTS before giving up on a command, IRCAL takes about 250ms
+#define RADIO_RESPONSE_ATTEMPTS	255			// reads of command buffer until response is ready
+
 #ifndef TEST
-#define RADIO_READY	(RADIO_PIN & RADIO_CTS)
+#define RADIO_READY(radio)	(*(radio)->pins->in & (radio)->pins->cts)
 #else
-#define RADIO_READY (1)
+#define RADIO_READY(radio)	(1)
 #endif
 
-#define RADIO_CCA			RADIO_NIRQ		// when high, signal strength exceeds RSSI threshold
-#ifndef TEST
-#define RADIO_SIGNAL (RADIO_PIN & RADIO_CCA)
+#if !defined(TEST) || defined(RADIO_MOCK)	// host tools emulate the CCA pin
+#define RADIO_SIGNAL(radio)	(*(radio)->pins->in & (radio)->pins->cca)
 #else
-#define RADIO_SIGNAL (1)
+#define RADIO_SIGNAL(radio)	(1)
 #endif
 
 // convert RSSI to dBm: RSSI / 2 - RSSI_COMP - 70 and vice versa
 #define RADIO_RSSI_TO_DBM(val) (((int) val >> 1) - 0x40 - 70)
 #define RADIO_DBM_TO_RSSI(val) ((val + 70 + 0x40) << 1)
 
+// convert AFC frequency offset to Hz and vice versa, PLL resolution 2 * 30MHz / (24 * 2^19) in band 142-175MHz
+#define RADIO_AFC_TO_HZ(val) ((int32_t) (val) * 477 / 100)
+#define RADIO_HZ_TO_AFC(val) ((int32_t) (val) * 100 / 477)
+
+// PLL of band 142-175MHz configured in radio_config.h: (INTE + FRAC / 2^19) * 2 * 30MHz / 24, FRAC 2^19..2^20-1
+#define RADIO_PLL_KHZ			2500		// frequency per INTE step
+#define RADIO_BAND_MIN_KHZ		142000
+#define RADIO_BAND_MAX_KHZ		175000
+
+// crystal load capacitance, GLOBAL_XO_TUNE in radio_config.h, 0..127, higher values lower the frequency
+#define RADIO_XO_TUNE_DEFAULT	0x52
+#define RADIO_XO_TUNE_MAX		0x7f
+
 // functions to start up / reset chip
-void radio_setup(void);								// set up MSP430 pins and SPI for interfacing w/ radio
-void radio_configure(void);							// configure radio using radio_config_Si4362.h
-void radio_calibrate_ir(void);						// run image rejection self-calibration (takes approx. 250ms)
+void radio_setup(struct radio_s* radio);					// set up MSP430 pins and SPI for interfacing w/ radio
+uint8_t radio_configure(struct radio_s* radio);				// reset radio and configure it using radio_config_compact.h, returns 0 on CTS timeout
+uint8_t radio_configured(struct radio_s* radio);			// returns 1 if radio still runs with its configuration, e.g. after an MCU reset
+void radio_calibrate_ir(struct radio_s* radio);				// run image rejection self-calibration (takes approx. 250ms)
 
-void radio_shutdown(void);							// turn off radio
+void radio_shutdown(struct radio_s* radio);					// turn off radio
 
-void radio_wait_for_CTS(void);						// waits until radio completed previous command, e.g. to wait for RX to start
+void radio_wait_for_CTS(struct radio_s* radio);				// waits until radio completed previous command, e.g. to wait for RX to start, at most RADIO_CTS_TIMEOUT
 
 // helpers
-void radio_debug(void);								// debug code, reading chip status, version etc.
+void radio_debug(struct radio_s* radio);					// debug code, reading chip status, version etc.
 
 // wrappers for chip functionality, see EZRadioPRO API Documentation for detailed information
 // http://www.silabs.com/products/wireless/ezradiopro/pages/si4362.aspx
 
 void radio_start_rx(								// switch modem to RX state
+					struct radio_s* radio,				// radio to operate
 					uint8_t channel, 					// channel, 0 = configured base frequency
 					uint8_t start_condition,			// start condition, 0 = start immediatly, 1 = wait for WUT to expire
 					uint16_t rx_length,					// ??? number of bytes or number of packets?
@@ -70,40 +126,58 @@ void radio_start_rx(								// switch modem to RX state
 					uint8_t rx_invalid_state);			// next state when invalid packet is received (CRC error)
 
 void radio_change_state(							// change state of radio, e.g. to READY from RX
+					struct radio_s* radio,				// radio to operate
 					uint8_t next_state);				// target state
 
-void radio_fifo_info(								// read FIFO information, like pending bytes, result in radio_buffer.fifo_info
+void radio_fifo_info(								// read FIFO information, like pending bytes, result in radio->buffer.fifo_info
+					struct radio_s* radio,				// radio to operate
 					uint8_t reset_reset_fifo);			// if 2, RX FIFO will be reset
 
-void radio_part_info(void);							// read part information, like part number (4362), result in radio_buffer.part_info
-void radio_func_info(void);							// read firmware information, like firmware version, result in radio_buffer.func_info
+void radio_part_info(struct radio_s* radio);				// read part information, like part number (4362), result in radio->buffer.part_info
+void radio_func_info(struct radio_s* radio);				// read firmware information, like firmware version, result in radio->buffer.func_info
 
-void radio_get_int_status(							// read interrupt status, result in radio_buffer.int_status
+void radio_get_int_status(							// read interrupt status, result in radio->buffer.int_status
+					struct radio_s* radio,				// radio to operate
 					uint8_t ph_clr_pending,				// 0 = clear pending packet handler interrupts, set bits leave respective int pending
 					uint8_t modem_clr_pending,			// 0 = clear pending modem interrupts, set bits leave respective int pending
 					uint8_t chip_clr_pending);			// 0 = clear pending chip interrupts, set bits leave respective int pending
 
-void radio_get_ph_status(							// read packet handler status, result in radio_buffer.ph_status
+void radio_get_ph_status(							// read packet handler status, result in radio->buffer.ph_status
+					struct radio_s* radio,				// radio to operate
 					uint8_t clr_pending);				// 0 = clear pending interrupts, set bits leave respective int pending
 
-void radio_get_chip_status(							// read chip status, including command errors, result in radio_buffer.chip_status
+void radio_get_chip_status(							// read chip status, including command errors, result in radio->buffer.chip_status
+					struct radio_s* radio,				// radio to operate
 					uint8_t clr_pending);				// 0 = clear pending interrupts, set bits leave respective int pending
 
-void radio_get_modem_status(						// read modem status, including RSSI, result in radio_buffer.modem_status
+void radio_get_modem_status(						// read modem status, including RSSI, result in radio->buffer.modem_status
+					struct radio_s* radio,				// radio to operate
 					uint8_t clr_pending);				// 0 = clear pending interrupts, set bits leave respective int pending
 
-void radio_request_device_state(void);				// read current device state, result in radio_buffer.device_state
+void radio_request_device_state(struct radio_s* radio);		// read current device state, result in radio->buffer.device_state
 
-void radio_frr_read(								// read fast read registers, results in radio_buffer.data[0..3]
+void radio_frr_read(								// read fast read registers, results in radio->buffer.data[0..3]
+					struct radio_s* radio,				// radio to operate
 					uint8_t frr,					// start register 'A', 'B', 'C' or 'D'
 					uint8_t count);					// number of registers to read (1-4)
 
 void radio_set_property(							// directly set individual radio property
+					struct radio_s* radio,				// radio to operate
 					uint8_t prop_group,				// property group, e.g. 0x20 for MODEM
 					uint8_t prop_num,				// property number, e.g. 0x4a for RSSI threshold
 					uint8_t value);					// property value, e.g. RADIO_DBM_TO_RSSI(-80)
 
-// data structures of various responses, access via radio_buffer.* after calling respective radio_get_* function
+void radio_get_property(							// read properties, result in radio->buffer.data[0..count-1]
+					struct radio_s* radio,				// radio to operate
+					uint8_t prop_group,				// property group, e.g. 0x20 for MODEM
+					uint8_t count,					// number of consecutive properties (1-12)
+					uint8_t prop_num);				// first property number
+
+void radio_set_frequency(							// set FREQ_CONTROL_INTE and _FRAC, radio tunes with next radio_start_rx
+					struct radio_s* radio,				// radio to operate
+					const uint8_t* pll);			// INTE, FRAC_2, FRAC_1, FRAC_0
+
+// data structures of various responses, access via radio->buffer.* after calling respective radio_get_* function
 
 struct part_info_s {
 	uint8_t	chiprev;				// chip mask revision
@@ -173,7 +247,7 @@ struct device_state_s {
 };
 
 union radio_buffer_u {
-	uint8_t data[64];							// data buffer, 64 bytes = FIFO length, when not using FIFO could be as low as 8 bytes
+	uint8_t data[12];							// data buffer, radio FIFO isn't used in direct mode, longest command or response fits
 	struct part_info_s			part_info;		// basic information about the device
 	struct func_info_s			func_info;		// function revision information of the device
 	struct fifo_info_s			fifo_info;		// transmit and receive FIFO counts
@@ -185,8 +259,14 @@ union radio_buffer_u {
 	struct device_state_s		device_state;	// current device state
 };
 
-//
-extern union radio_buffer_u radio_buffer;
+// handle of one radio, responses of the radio_* functions are in radio->buffer
+struct radio_s {
+	const struct radio_pins_s* pins;
+	union radio_buffer_u buffer;
+	uint8_t cts_timeouts;						// commands given up after RADIO_CTS_TIMEOUT since start, wraps
+};
+
+extern struct radio_s radio_devices[RADIO_DEVICES];	// radio 0 is wired as defined above
 
 // states of radio, as used in radio_change_state and radio_request_device_state
 #define RADIO_STATE_NO_CHANGE		0
@@ -0,0 +1,53 @@
+/*
+ * Compact radio configuration stream, generated by host/radio_config_gen from radio_config.h
+ *
+ * Same property values as RADIO_CONFIGURATION_DATA_ARRAY at every command other than SET_PROPERTY,
+ * with redundant writes removed and contiguous properties merged. WDS array: 42 commands, 408 bytes.
+ * Regenerate whenever radio_config.h changes: ./radio_config_gen -g > radio_config_compact.h
+ */
+
+#ifndef RADIO_CONFIG_COMPACT_H_
+#define RADIO_CONFIG_COMPACT_H_
+
+#define RADIO_CONFIGURATION_COMPACT_ARRAY { \
+	0x07, 0x02, 0x01, 0x00, 0x01, 0xC9, 0xC3, 0x80,	/* POWER_UP */ \
+	0x08, 0x13, 0x1A, 0x00, 0x11, 0x14, 0x1B, 0x00, 0x00,	/* GPIO_PIN_CFG */ \
+	0x05, 0x11, 0x00, 0x01, 0x00, 0x52,	/* group 0x00, 0x00..0x00 */ \
+	0x05, 0x11, 0x00, 0x01, 0x03, 0x60,	/* group 0x00, 0x03..0x03 */ \
+	0x10, 0x11, 0x20, 0x0C, 0x00, 0x0B, 0x00, 0x07, 0x01, 0x38, 0x80, 0x05, 0xC9, 0xC3, 0x80, 0x00, 0x00,	/* group 0x20, 0x00..0x0B */ \
+	0x05, 0x11, 0x20, 0x01, 0x0C, 0x69,	/* group 0x20, 0x0C..0x0C */ \
+	0x0B, 0x11, 0x20, 0x07, 0x19, 0x00, 0x08, 0x02, 0x80, 0x00, 0xF0, 0x10,	/* group 0x20, 0x19..0x1F */ \
+	0x0D, 0x11, 0x20, 0x09, 0x22, 0x00, 0x4E, 0x06, 0x8D, 0xB9, 0x00, 0x00, 0x02, 0xC0,	/* group 0x20, 0x22..0x2A */ \
+	0x0B, 0x11, 0x20, 0x07, 0x2C, 0x00, 0x12, 0x00, 0x34, 0x01, 0x5F, 0xA0,	/* group 0x20, 0x2C..0x32 */ \
+	0x05, 0x11, 0x20, 0x01, 0x35, 0xE2,	/* group 0x20, 0x35..0x35 */ \
+	0x0D, 0x11, 0x20, 0x09, 0x38, 0x11, 0x11, 0x11, 0x00, 0x1A, 0x20, 0x00, 0x00, 0x28,	/* group 0x20, 0x38..0x40 */ \
+	0x0C, 0x11, 0x20, 0x08, 0x42, 0xA4, 0x03, 0xD6, 0x03, 0x00, 0x7B, 0x01, 0x80,	/* group 0x20, 0x42..0x49 */ \
+	0x05, 0x11, 0x20, 0x01, 0x4E, 0x22,	/* group 0x20, 0x4E..0x4E */ \
+	0x05, 0x11, 0x20, 0x01, 0x51, 0x0D,	/* group 0x20, 0x51..0x51 */ \
+	0x10, 0x11, 0x21, 0x0C, 0x00, 0x7E, 0x64, 0x1B, 0xBA, 0x58, 0x0B, 0xDD, 0xCE, 0xD6, 0xE6, 0xF6, 0x00,	/* group 0x21, 0x00..0x0B */ \
+	0x10, 0x11, 0x21, 0x0C, 0x0C, 0x03, 0x03, 0x15, 0xF0, 0x3F, 0x00, 0x7E, 0x64, 0x1B, 0xBA, 0x58, 0x0B,	/* group 0x21, 0x0C..0x17 */ \
+	0x10, 0x11, 0x21, 0x0C, 0x18, 0xDD, 0xCE, 0xD6, 0xE6, 0xF6, 0x00, 0x03, 0x03, 0x15, 0xF0, 0x3F, 0x00,	/* group 0x21, 0x18..0x23 */ \
+	0x0B, 0x11, 0x23, 0x07, 0x00, 0x2C, 0x0E, 0x0B, 0x04, 0x0C, 0x73, 0x03,	/* group 0x23, 0x00..0x06 */ \
+	0x0C, 0x11, 0x40, 0x08, 0x00, 0x3B, 0x0B, 0x00, 0x00, 0x28, 0xF6, 0x20, 0xFA,	/* group 0x40, 0x00..0x07 */ \
+	0x08, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	/* START_RX */ \
+	0x05, 0x17, 0x56, 0x10, 0xCA, 0xF0,	/* IRCAL */ \
+	0x05, 0x17, 0x13, 0x10, 0xCA, 0xF0,	/* IRCAL */ \
+	0x05, 0x11, 0x01, 0x01, 0x00, 0x00,	/* group 0x01, 0x00..0x00 */ \
+	0x08, 0x11, 0x02, 0x04, 0x00, 0x0A, 0x09, 0x05, 0x00,	/* group 0x02, 0x00..0x03 */ \
+	0x05, 0x11, 0x10, 0x01, 0x01, 0x14,	/* group 0x10, 0x01..0x01 */ \
+	0x05, 0x11, 0x12, 0x01, 0x06, 0x40,	/* group 0x12, 0x06..0x06 */ \
+	0x0E, 0x11, 0x20, 0x0A, 0x03, 0x05, 0xDC, 0x00, 0x05, 0xC9, 0xC3, 0x80, 0x00, 0x01, 0xF7,	/* group 0x20, 0x03..0x0C */ \
+	0x0B, 0x11, 0x20, 0x07, 0x19, 0x80, 0x08, 0x02, 0x80, 0x00, 0x70, 0x20,	/* group 0x20, 0x19..0x1F */ \
+	0x0C, 0x11, 0x20, 0x08, 0x23, 0x62, 0x05, 0x3E, 0x2D, 0x02, 0x9D, 0x00, 0xC2,	/* group 0x20, 0x23..0x2A */ \
+	0x0B, 0x11, 0x20, 0x07, 0x2C, 0x54, 0x36, 0x81, 0x01, 0x02, 0x4E, 0x80,	/* group 0x20, 0x2C..0x32 */ \
+	0x06, 0x11, 0x20, 0x02, 0x39, 0x15, 0x15,	/* group 0x20, 0x39..0x3A */ \
+	0x0F, 0x11, 0x20, 0x0B, 0x42, 0x84, 0x03, 0xD6, 0x8F, 0x00, 0x62, 0x01, 0x80, 0x80, 0x0C, 0x03,	/* group 0x20, 0x42..0x4C */ \
+	0x05, 0x11, 0x20, 0x01, 0x4E, 0x40,	/* group 0x20, 0x4E..0x4E */ \
+	0x10, 0x11, 0x21, 0x0C, 0x00, 0xFF, 0xC4, 0x30, 0x7F, 0xF5, 0xB5, 0xB8, 0xDE, 0x05, 0x17, 0x16, 0x0C,	/* group 0x21, 0x00..0x0B */ \
+	0x10, 0x11, 0x21, 0x0C, 0x0D, 0x00, 0x15, 0xFF, 0x00, 0x00, 0xFF, 0xC4, 0x30, 0x7F, 0xF5, 0xB5, 0xB8,	/* group 0x21, 0x0D..0x18 */ \
+	0x0E, 0x11, 0x21, 0x0A, 0x19, 0xDE, 0x05, 0x17, 0x16, 0x0C, 0x03, 0x00, 0x15, 0xFF, 0x00,	/* group 0x21, 0x19..0x22 */ \
+	0x08, 0x11, 0x40, 0x04, 0x00, 0x3F, 0x0E, 0x51, 0xEB,	/* group 0x40, 0x00..0x03 */ \
+	0x00 \
+}
+
+#endif /* RADIO_CONFIG_COMPACT_H_ */
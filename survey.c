@@ -0,0 +1,103 @@
+/*
+ * Spectrum and channel occupancy survey, steps the first radio across a band and samples RSSI
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ */
+
+#include <msp430.h>
+#include <inttypes.h>
+
+#include "radio.h"
+#include "fifo.h"
+#include "packet_handler.h"
+#include "survey.h"
+
+#define SURVEY_CYCLES_PER_US	16		// MCLK 16MHz
+#define SURVEY_READ_CYCLES		100		// FRR read over SPI, part of the sample period
+
+static uint32_t survey_khz;				// next frequency to measure
+static uint32_t survey_end;				// last frequency of band
+static uint16_t survey_step;			// step size in kHz, 0 if no survey is running
+static uint8_t survey_busy;				// busy threshold as RSSI register value
+
+uint8_t survey_start(uint32_t start_khz, uint32_t end_khz, uint16_t step_khz, int8_t busy_dbm)
+{
+	struct ph_channel_s channel;
+
+	if (step_khz == 0 || end_khz < start_khz || !ph_channel_pll(&channel, start_khz) || !ph_channel_pll(&channel, end_khz))
+		return 0;
+
+	survey_khz = start_khz;
+	survey_end = end_khz;
+	survey_step = step_khz;
+	survey_busy = RADIO_DBM_TO_RSSI(busy_dbm);
+
+	radio_set_property(&radio_devices[0], 0x20, 0x4c, 0x00);	// MODEM_RSSI_CONTROL, no latch, RSSI follows signal
+	return 1;
+}
+
+uint8_t survey_next(struct survey_step_s* step)
+{
+	struct radio_s* radio = &radio_devices[0];
+	struct ph_channel_s channel;
+	uint8_t pll[4];
+	uint16_t sum = 0;
+	uint8_t min = 0xff;
+	uint8_t max = 0;
+	uint8_t busy = 0;
+	uint8_t i;
+
+	if (!survey_step)
+		return 0;
+	if (survey_khz > survey_end) {
+		radio_set_property(radio, 0x20, 0x4c, SURVEY_RSSI_CONTROL);	// back to latch at RX start
+		survey_step = 0;
+		return 0;
+	}
+
+	// tune, frequency is within band as start and end were checked
+	ph_channel_pll(&channel, survey_khz);
+	ph_channel_words(&channel, pll);
+	radio_set_frequency(radio, pll);
+	radio_start_rx(radio, 0, 0, 0, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE, RADIO_STATE_NO_CHANGE);
+	radio_wait_for_CTS(radio);
+	_delay_cycles(SURVEY_SETTLE_US * SURVEY_CYCLES_PER_US);
+
+	step->khz = survey_khz;
+	for (i = 0; i < SURVEY_BINS; i++)
+		step->hist[i] = 0;
+
+	for (i = 0; i < SURVEY_SAMPLES; i++) {
+		uint8_t rssi;
+		int16_t bin;
+
+		radio_frr_read(radio, 'A', 1);			// FRR A is LATCHED_RSSI
+		rssi = radio->buffer.data[0];
+		sum += rssi;
+		if (rssi < min)
+			min = rssi;
+		if (rssi > max)
+			max = rssi;
+		if (rssi >= survey_busy)
+			busy++;
+
+		bin = (RADIO_RSSI_TO_DBM(rssi) - SURVEY_BIN_DBM) / SURVEY_BIN_DB;
+		if (bin < 0)
+			bin = 0;
+		else if (bin >= SURVEY_BINS)
+			bin = SURVEY_BINS - 1;
+		step->hist[bin]++;
+
+		_delay_cycles(SURVEY_SAMPLE_US * SURVEY_CYCLES_PER_US - SURVEY_READ_CYCLES);
+	}
+
+	step->min = RADIO_RSSI_TO_DBM(min);
+	step->mean = RADIO_RSSI_TO_DBM((sum + SURVEY_SAMPLES / 2) / SURVEY_SAMPLES);
+	step->max = RADIO_RSSI_TO_DBM(max);
+	step->busy = (uint16_t) busy * 100 / SURVEY_SAMPLES;
+
+	survey_khz += survey_step;
+	return 1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Spectrum and channel occupancy survey, steps the first radio across a band and samples RSSI
+ * Author: Adrian Studer
+ * License: CC BY-NC-SA Creative Commons Attribution-NonCommercial-ShareAlike
+ * 			http://creativecommons.org/licenses/by-nc-sa/4.0/
+ * 			Please contact the author if you want to use this work in a commercial product
+ *
+ * The packet handler must be stopped while surveying. Each call of survey_next tunes the radio to the
+ * next frequency, waits for PLL and RSSI to settle and reads SURVEY_SAMPLES RSSI values through fast
+ * response register A at a fixed rate. For the survey, RSSI latching (MODEM_RSSI_CONTROL) is turned off so
+ * the latched RSSI register follows the current RSSI, survey_next restores it when the sweep is done.
+ * 156 to 163MHz in 25kHz steps (281 frequencies) takes about 2.5s plus the time to send the report.
+ */
+
+#ifndef SURVEY_H_
+#define SURVEY_H_
+
+#define SURVEY_START_KHZ	156000		// default band, marine VHF
+#define SURVEY_END_KHZ		163000
+#define SURVEY_STEP_KHZ		25
+#define SURVEY_SAMPLES		32			// RSSI samples per frequency
+#define SURVEY_SAMPLE_US	250			// sample period in us, RSSI is averaged over 4 bits (417us)
+#define SURVEY_SETTLE_US	500			// PLL and RSSI settle time after tuning
+#define SURVEY_BINS			8			// histogram bins of SURVEY_BIN_DB, first starts at SURVEY_BIN_DBM
+#define SURVEY_BIN_DBM		-120		// samples below are counted in first bin, above last in last bin
+#define SURVEY_BIN_DB		10
+#define SURVEY_BUSY_DBM		-100		// default busy threshold if no RSSI threshold is configured
+
+#define SURVEY_RSSI_CONTROL	0x03		// MODEM_RSSI_CONTROL of radio_config.h, latch after RX start
+
+// RSSI statistics of one frequency
+struct survey_step_s {
+	uint32_t khz;						// frequency in kHz
+	int8_t min;							// lowest, mean and highest RSSI in dBm
+	int8_t mean;
+	int8_t max;
+	uint8_t busy;						// samples at or above busy threshold in percent
+	uint8_t hist[SURVEY_BINS];			// samples per bin
+};
+
+uint8_t survey_start(uint32_t start_khz, uint32_t end_khz, uint16_t step_khz, int8_t busy_dbm);	// returns 0 if band is invalid
+uint8_t survey_next(struct survey_step_s* step);	// measure next frequency, returns 0 at end of sweep
+
+#endif /* SURVEY_H_ */
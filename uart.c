@@ -1,30 +1,52 @@
 /*
- * Simple UART library for MSP430 USCI A0 - so far TX only
+ * Simple UART library for MSP430 USCI A0, interrupt driven RX
  * Author: Adrian Studer
  */
 
 #include <msp430.h>
 #include <inttypes.h>
 #include "uart.h"
+#include "event.h"
+#include "duty.h"
 
-#define UART_BAUD	9600	// baud rate, use 9600 for MSP430G2 LaunchPad, better safe than sorry
+#define UART_BAUD	9600	// baud rate at start, use 9600 for MSP430G2 LaunchPad, better safe than sorry
+#define UART_SWITCH_TIMEOUT	31250	// 1024 SMCLK cycles (64us) host has to acknowledge new baud rate, 2s
 
 #define UART_RX		BIT1	// RX pin 1.1
 #define UART_TX		BIT2	// TX pin 1.2
 
-// timing configuration according to table 15.4 in TI MSP430x2xx Family Guide (SLAU144J)
-#if (UART_BAUD == 9600)
-#define UART_PRESCALER 1666
-#define UART_MODULATOR 6
-#elif (UART_BAUD == 19200)
-#define UART_PRESCALER 833
-#define UART_MODULATOR 2
-#elif (UART_BAUD == 38400)
-#define UART_PRESCALER 416
-#define UART_MODULATOR 6
-#else
-#error "This UART library only supports 9600, 19200 or 38400 baud"
-#endif
+// timing configuration according to table 15.4 in TI MSP430x2xx Family Guide (SLAU144J), SMCLK 16MHz, UCOS16=0
+// prescaler is 16MHz/baud rounded down, modulator the remaining fraction in 1/8 bit, picked for lowest error
+// note that the backchannel UART of the MSP430G2 LaunchPad only does 9600 baud
+struct uart_timing_s {
+	uint32_t baud;
+	uint16_t prescaler;
+	uint8_t modulator;
+};
+
+static const struct uart_timing_s uart_timing[] = {
+	{ 9600, 1666, 6 },
+	{ 19200, 833, 2 },
+	{ 38400, 416, 6 },
+	{ 57600, 277, 7 },
+	{ 115200, 138, 7 }
+};
+
+#define UART_TIMINGS	(sizeof(uart_timing) / sizeof(struct uart_timing_s))
+
+static uint8_t uart_timing_index = 0;			// current baud rate
+static uint8_t uart_switch_previous = 0xff;		// timing index to fall back to while waiting for acknowledge
+static uint16_t uart_switch_start;				// duty_now / 1024 when switch started
+
+// ring buffer for interrupt driven TX
+static uint8_t uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile uint8_t uart_tx_in = 0;			// written by producer
+static volatile uint8_t uart_tx_out = 0;		// written by TX interrupt
+
+// line collected by RX interrupt, bytes are dropped until main released the previous line
+static char uart_rx_line[UART_LINE_SIZE];
+static volatile uint8_t uart_rx_length = 0;		// characters in uart_rx_line, UART_LINE_SIZE if too long
+static volatile uint8_t uart_rx_ready = 0;		// line is complete, written by RX interrupt and uart_release_line
 
 void uart_init(void)
 {
@@ -36,9 +58,6 @@ void uart_init(void)
 	// initialize USCI A0 registers
 	UCA0CTL0 = 0;									// 8N1 vanilla serial
 	UCA0CTL1 |= UCSSEL_2;							// clock source SMCLK (keep USCI in reset state)
-	UCA0BR0 = UART_PRESCALER & 0xff;				// configure clock generation according to selected baud rate
-	UCA0BR1 = UART_PRESCALER >> 8;
-	UCA0MCTL = UART_MODULATOR << 1;
 
 	// initialize UART pins on port 1
 	P1DIR |= UART_TX;								// set TX pin as output
@@ -46,23 +65,204 @@ void uart_init(void)
 	P1SEL |= UART_RX | UART_TX;						// connect pins to USCI (secondary peripheral)
 	P1SEL2 |= UART_RX | UART_TX;					// connect pins to USCI (secondary peripheral)
 
+	uart_tx_in = uart_tx_out = 0;
+	uart_release_line();
+	uart_set_baud(UART_BAUD);						// configure clock generation and enable USCI A0
+}
+
+uint8_t uart_set_baud(uint32_t baud)
+{
+	uint8_t i;
+
+	for (i = 0; i < UART_TIMINGS; i++) {
+		if (uart_timing[i].baud == baud)
+			break;
+	}
+	if (i == UART_TIMINGS)
+		return 0;
+
+	UCA0CTL1 |= UCSWRST;							// put USCI A0 into reset state, disables interrupts
+	UCA0BR0 = uart_timing[i].prescaler & 0xff;		// configure clock generation according to selected baud rate
+	UCA0BR1 = uart_timing[i].prescaler >> 8;
+	UCA0MCTL = uart_timing[i].modulator << 1;
 	UCA0CTL1 &= ~UCSWRST;							// enable USCI A0
+	IE2 |= UCA0RXIE;								// receive in any LPM, USCI wakes SMCLK on start bit
+	if (uart_tx_in != uart_tx_out)
+		IE2 |= UCA0TXIE;							// continue interrupt driven TX
+	uart_timing_index = i;
+	return 1;
+}
+
+uint32_t uart_get_baud(void)
+{
+	return uart_timing[uart_timing_index].baud;
+}
+
+uint32_t uart_get_baud_option(uint8_t index)
+{
+	if (index >= UART_TIMINGS)
+		return 0;
+	return uart_timing[index].baud;
+}
+
+// deviation of current rate from nominal, the bit takes prescaler + modulator / 8 SMCLK cycles
+int16_t uart_get_baud_error(void)
+{
+	const struct uart_timing_s* timing = &uart_timing[uart_timing_index];
+	int32_t actual = timing->baud * (8UL * timing->prescaler + timing->modulator);	// 128 million at nominal rate
+
+	return (128000000L - actual) * 15625 / (actual / 64);	// ppm, 15625 * 64 = 1000000 keeps product in 32 bits
+}
+
+void uart_mute(uint8_t mute)
+{
+	if (mute) {
+		P1OUT |= UART_TX;							// TX pin idles high as I/O
+		P1SEL &= ~UART_TX;
+		P1SEL2 &= ~UART_TX;
+	} else {
+		P1SEL |= UART_TX;							// connect TX pin to USCI again
+		P1SEL2 |= UART_TX;
+	}
+}
+
+uint8_t uart_switch_baud(uint32_t baud)
+{
+	uint8_t previous = uart_timing_index;
+
+	uart_flush();									// complete any message at old rate
+	if (!uart_set_baud(baud))
+		return 0;
+
+	IE2 &= ~UCA0RXIE;								// poll for acknowledge, bypassing RX line
+	while (IFG2 & UCA0RXIFG)						// discard bytes received at old rate
+		UCA0RXBUF;
+	uart_release_line();
+	uart_switch_previous = previous;
+	uart_switch_start = duty_now() >> 10;
+	return 1;
+}
+
+uint8_t uart_switch_poll(void)
+{
+	if (uart_switch_previous == 0xff)
+		return UART_SWITCH_KEPT;
+	if (IFG2 & UCA0RXIFG) {							// host sent something
+		uint8_t error = UCA0STAT & UCRXERR;			// framing error if host is still at old rate
+		UCA0RXBUF;									// clear flag and error bits
+		if (!error) {
+			uart_switch_previous = 0xff;
+			IE2 |= UCA0RXIE;
+			return UART_SWITCH_KEPT;
+		}
+	}
+	if ((uint16_t) ((duty_now() >> 10) - uart_switch_start) < UART_SWITCH_TIMEOUT)
+		return UART_SWITCH_WAIT;
+
+	uart_set_baud(uart_timing[uart_switch_previous].baud);	// no acknowledge, fall back, enables RX interrupt
+	uart_switch_previous = 0xff;
+	return UART_SWITCH_FELL_BACK;
+}
+
+void uart_flush(void)
+{
+	uint8_t activity = duty_switch(DUTY_UART);
+	while (uart_tx_in != uart_tx_out);				// wait for TX interrupt to empty buffer
+	while (UCA0STAT & UCBUSY);						// wait for last byte to leave shift register
+	duty_switch(activity);
+}
+
+// write byte to TXBUF if nothing is queued and UART is ready, returns 0 if not
+// checked and written with interrupts off, an ISR queuing a byte in between would interleave with it
+static uint8_t uart_send_now(uint8_t data)
+{
+	uint16_t gie = __get_SR_register() & GIE;
+	uint8_t sent = 0;
+
+	_BIC_SR(GIE);
+	if (uart_tx_in == uart_tx_out && (IFG2 & UCA0TXIFG)) {
+		UCA0TXBUF = data;
+		sent = 1;
+	}
+	_BIS_SR(gie);
+	return sent;
 }
 
 void uart_send_string(const char* buffer)
 {
+	uint8_t activity = duty_switch(DUTY_UART);		// waiting is most of the time
 	uint16_t i = 0;
 	while (buffer[i])
 	{
-		while (!(IFG2 & UCA0TXIFG));					// wait for UART to be ready for TX
-		UCA0TXBUF = buffer[i];
+		while (!uart_send_now(buffer[i]));			// wait for queued bytes and UART to be ready for TX
 		i++;
 	}
+	duty_switch(activity);
 }
 
 void uart_send_byte(uint8_t data)
 {
-	while (!(IFG2 & UCA0TXIFG));					// wait for UART to be ready for TX
-	UCA0TXBUF = data;
+	if (!uart_send_now(data)) {						// NMEA sends byte by byte, only waiting is charged
+		uint8_t activity = duty_switch(DUTY_UART);
+		while (!uart_send_now(data));				// wait for queued bytes and UART to be ready for TX
+		duty_switch(activity);
+	}
+}
+
+uint8_t uart_queue_byte(uint8_t data)
+{
+	uint8_t next = (uart_tx_in + 1) & (UART_TX_BUFFER_SIZE - 1);
+
+	if (next == uart_tx_out)						// buffer full
+		return 0;
+	uart_tx_buffer[uart_tx_in] = data;
+	uart_tx_in = next;
+	IE2 |= UCA0TXIE;								// TX interrupt fires as soon as TXBUF is empty
+	return 1;
+}
+
+char* uart_get_line(void)
+{
+	return uart_rx_ready ? uart_rx_line : 0;
 }
 
+void uart_release_line(void)
+{
+	uart_rx_length = 0;
+	uart_rx_ready = 0;								// RX interrupt starts next line
+}
+
+// add received byte to line, wake up main at end of line
+#pragma vector=USCIAB0RX_VECTOR
+__interrupt void uart_rx_isr(void)
+{
+	uint8_t error = UCA0STAT & UCRXERR;				// e.g. framing error if host uses other baud rate
+	uint8_t data = UCA0RXBUF;						// clears flag and error bits
+
+	if (error || uart_rx_ready)						// drop byte while main has the line
+		return;
+	if (data == '\r' || data == '\n') {
+		if (uart_rx_length == 0)
+			return;									// empty line, e.g. LF after CR
+		if (uart_rx_length == UART_LINE_SIZE)
+			uart_rx_length = 0;						// too long, passed on empty
+		uart_rx_line[uart_rx_length] = 0;
+		uart_rx_ready = 1;
+		EVENT_POST(EVENT_COMMAND);
+		__low_power_mode_off_on_exit();				// main has a line
+	} else if (uart_rx_length < UART_LINE_SIZE - 1)
+		uart_rx_line[uart_rx_length++] = data;
+	else
+		uart_rx_length = UART_LINE_SIZE;			// ignore rest of line
+}
+
+// send next queued byte
+#pragma vector=USCIAB0TX_VECTOR
+__interrupt void uart_tx_isr(void)
+{
+	if (uart_tx_in != uart_tx_out) {
+		UCA0TXBUF = uart_tx_buffer[uart_tx_out];
+		uart_tx_out = (uart_tx_out + 1) & (UART_TX_BUFFER_SIZE - 1);
+	} else
+		IE2 &= ~UCA0TXIE;							// nothing left, TXIFG stays set for polled TX
+}
@@ -1,13 +1,39 @@
 /*
- * Simple UART library for MSP430 USCI A0 - so far TX only
+ * Simple UART library for MSP430 USCI A0, interrupt driven RX
  * Author: Adrian Studer
  */
 
 #ifndef UART_H_
 #define UART_H_
 
+#define UART_TX_BUFFER_SIZE	4			// bytes queued for interrupt driven TX, power of 2, raw stream needs few
+#define UART_LINE_SIZE		28			// longest line received including termination
+
 void uart_init(void);							// setup UART peripheral
 void uart_send_string(const char* buffer);		// send 0-terminated buffer
 void uart_send_byte(uint8_t data);				// send a single byte
+uint8_t uart_set_baud(uint32_t baud);			// change baud rate, returns 0 if not supported
+uint32_t uart_get_baud(void);					// current baud rate
+uint32_t uart_get_baud_option(uint8_t index);	// supported baud rates, ascending from 9600, 0 after last
+int16_t uart_get_baud_error(void);				// deviation of current baud rate from nominal in ppm
+void uart_mute(uint8_t mute);					// disconnect TX pin while USCI keeps sending, e.g. to time other baud rates
+uint8_t uart_switch_baud(uint32_t baud);		// change baud rate, keep it only if host sends a byte at new rate, returns 0 if not supported
+uint8_t uart_switch_poll(void);					// call after uart_switch_baud until it returns other than UART_SWITCH_WAIT
+
+// results of uart_switch_poll
+#define UART_SWITCH_WAIT		0				// waiting for host, RX is off meanwhile
+#define UART_SWITCH_KEPT		1				// host acknowledged, new rate stays
+#define UART_SWITCH_FELL_BACK	2				// no acknowledge within 2s, previous rate restored
+
+void uart_flush(void);							// wait until all queued bytes are sent
+
+// line based RX, the RX interrupt collects a line and wakes up main on its end (CR or LF),
+// bytes received until main releases the line are dropped, a line too long is passed on empty
+char* uart_get_line(void);						// complete 0-terminated line, 0 if none yet
+void uart_release_line(void);					// receive next line
+
+// non-blocking TX for interrupt service routines, single producer only, returns 0 if buffer is full
+// uart_send_string and uart_send_byte write a byte only once the queue is empty, with interrupts off
+uint8_t uart_queue_byte(uint8_t data);
 
 #endif /* UART_H_ */